@@ -0,0 +1,253 @@
+// Benchmarks the mDNS packet parser on a workstation.
+//
+// Usage: mdns_benchmark [-r repeats] capture.pcap...
+//
+// The mDNS packets in each capture are read with a PcapTransport, then
+// replayed through MDns::loop() repeats times using a LoopbackTransport so
+// file reads are not timed. Timings include copying each packet into the
+// LoopbackTransport, the same as lwIP copying it into a WiFiUDP.
+// For each capture the packets/second, ns/record and MB/s are reported.
+// Then, as in examples/benchmark, every record of every capture is decoded in
+// isolation: the name with RecordView::name() and the whole record with
+// RecordView::toQuery() or toAnswer(). Time per decode and peak stack depth
+// are reported for each record type. Stack depths are only meaningful without
+// MDNS_SANITIZE, since AddressSanitizer moves stack arrays elsewhere.
+
+#include <Arduino.h>
+#include <mdns.h>
+#include <mdns_transport.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Replays per capture unless -r is given.
+#define DEFAULT_REPEATS 2000
+
+// How much stack below the record callback is painted to measure stack depth.
+#define STACK_PROBE_SIZE 16384
+
+// Record types reported on.
+#define TYPE_SLOTS 8
+static const unsigned int slot_types[TYPE_SLOTS] = {
+  MDNS_TYPE_A, MDNS_TYPE_PTR, MDNS_TYPE_HINFO, MDNS_TYPE_TXT,
+  MDNS_TYPE_AAAA, MDNS_TYPE_SRV, 0, 0
+};
+static const char* slot_names[TYPE_SLOTS] = {
+  "A", "PTR", "HINFO", "TXT", "AAAA", "SRV", "other", "query"
+};
+
+typedef struct TypeStats {
+  unsigned long count;
+  double name_ns;
+  double decode_ns;
+  unsigned int name_stack;
+  unsigned int decode_stack;
+} TypeStats;
+static TypeStats type_stats[TYPE_SLOTS];
+
+// Times each record is decoded by recordCallback().
+static unsigned int record_repeats = 1;
+
+typedef struct CapturedPacket {
+  std::vector<byte> data;
+  IPAddress source;
+  uint16_t port;
+} CapturedPacket;
+
+// Counts records seen by MDns::loop().
+static unsigned long record_count = 0;
+
+static void queryCallback(const mdns::Query* query) {
+  record_count++;
+}
+
+static void answerCallback(const mdns::Answer* answer) {
+  record_count++;
+}
+
+// Fill the unused stack below the caller with a known pattern.
+static void __attribute__((noinline)) paintStack() {
+  volatile byte probe[STACK_PROBE_SIZE];
+  for (unsigned int i = 0; i < STACK_PROBE_SIZE; i++) {
+    probe[i] = 0xA5;
+  }
+}
+
+// How much of the stack painted by paintStack() has since been overwritten.
+// Must be called from the same function as paintStack() so both probe arrays
+// land on the same addresses.
+static unsigned int __attribute__((noinline)) stackUsed() {
+  volatile byte probe[STACK_PROBE_SIZE];
+  unsigned int i = 0;
+  while (i < STACK_PROBE_SIZE && probe[i] == 0xA5) {
+    i++;
+  }
+  return STACK_PROBE_SIZE - i;
+}
+
+static unsigned int typeSlot(const mdns::RecordView* view) {
+  if (view->isQuery()) {
+    return TYPE_SLOTS - 1;
+  }
+  for (unsigned int i = 0; i < TYPE_SLOTS - 2; i++) {
+    if (slot_types[i] == view->rrtype()) {
+      return i;
+    }
+  }
+  return TYPE_SLOTS - 2;
+}
+
+static double nsSince(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Decode every record in isolation.
+static void recordCallback(const mdns::RecordView* view) {
+  TypeStats* stats = &type_stats[typeSlot(view)];
+  char name_buffer[MAX_MDNS_NAME_LEN];
+  mdns::Query query;
+  mdns::Answer answer;
+
+  stats->count++;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < record_repeats; i++) {
+    view->name(name_buffer, MAX_MDNS_NAME_LEN);
+  }
+  stats->name_ns += nsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < record_repeats; i++) {
+    if (view->isQuery()) {
+      view->toQuery(&query);
+    } else {
+      view->toAnswer(&answer);
+    }
+  }
+  stats->decode_ns += nsSince(start);
+
+  paintStack();
+  view->name(name_buffer, MAX_MDNS_NAME_LEN);
+  unsigned int used = stackUsed();
+  if (used > stats->name_stack) {
+    stats->name_stack = used;
+  }
+
+  paintStack();
+  if (view->isQuery()) {
+    view->toQuery(&query);
+  } else {
+    view->toAnswer(&answer);
+  }
+  used = stackUsed();
+  if (used > stats->decode_stack) {
+    stats->decode_stack = used;
+  }
+}
+
+// Read every mDNS packet in filename. Returns false if it can't be opened.
+static bool ReadCapture(const char* filename, std::vector<CapturedPacket>* p_packets) {
+  mdns::PcapTransport capture(filename);
+  if (!capture.begin()) {
+    return false;
+  }
+  int len;
+  while ((len = capture.parsePacket()) > 0) {
+    CapturedPacket packet;
+    packet.data.resize(len);
+    capture.read(packet.data.data(), len);
+    packet.source = capture.remoteIP();
+    packet.port = capture.remotePort();
+    p_packets->push_back(packet);
+  }
+  return true;
+}
+
+static bool Benchmark(const char* filename, const unsigned int repeats) {
+  std::vector<CapturedPacket> packets;
+  if (!ReadCapture(filename, &packets)) {
+    fprintf(stderr, "Can't read %s\n", filename);
+    return false;
+  }
+  size_t bytes = 0;
+  for (size_t p = 0; p < packets.size(); p++) {
+    bytes += packets[p].data.size();
+  }
+
+  static byte transport_buffer[MDNS_HOST_MAX_DATAGRAM + 8];
+  static byte packet_buffer[MDNS_HOST_MAX_DATAGRAM];
+  mdns::LoopbackTransport transport(transport_buffer, sizeof(transport_buffer));
+  mdns::MDns mdns(&transport, NULL, queryCallback, answerCallback,
+                  packet_buffer, sizeof(packet_buffer));
+
+  record_count = 0;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < repeats; i++) {
+    for (size_t p = 0; p < packets.size(); p++) {
+      transport.inject(packets[p].data.data(), packets[p].data.size(),
+                       packets[p].source, packets[p].port);
+      mdns.loop();
+    }
+  }
+  const double elapsed_ns = nsSince(start);
+
+  const char* name = strrchr(filename, '/') ? strrchr(filename, '/') + 1 : filename;
+  const double packet_total = (double)packets.size() * repeats;
+  printf("%-32s %7zu %7zu %8lu %11.0f %10.1f %8.1f\n", name, packets.size(), bytes,
+         record_count / repeats,
+         packet_total ? packet_total * 1e9 / elapsed_ns : 0,
+         record_count ? elapsed_ns / record_count : 0,
+         elapsed_ns ? (double)bytes * repeats * 1e3 / elapsed_ns : 0);
+
+  // Add every record to the per type statistics.
+  mdns::MDns isolated_mdns(&transport, NULL, NULL, NULL, packet_buffer, sizeof(packet_buffer));
+  isolated_mdns.setRecordCallback(recordCallback);
+  record_repeats = repeats;
+  for (size_t p = 0; p < packets.size(); p++) {
+    transport.inject(packets[p].data.data(), packets[p].data.size(),
+                     packets[p].source, packets[p].port);
+    isolated_mdns.loop();
+  }
+  return true;
+}
+
+static void PrintTypeStats(const unsigned int repeats) {
+  printf("\nRecords decoded in isolation:\n");
+  printf("%-8s %7s %9s %10s %11s %13s\n", "type", "count", "name ns", "record ns",
+         "name stack", "record stack");
+  for (unsigned int i = 0; i < TYPE_SLOTS; i++) {
+    const TypeStats* stats = &type_stats[i];
+    if (stats->count == 0) {
+      continue;
+    }
+    printf("%-8s %7lu %9.1f %10.1f %11u %13u\n", slot_names[i], stats->count,
+           stats->name_ns / ((double)stats->count * repeats),
+           stats->decode_ns / ((double)stats->count * repeats),
+           stats->name_stack, stats->decode_stack);
+  }
+}
+
+int main(int argc, char** argv) {
+  unsigned int repeats = DEFAULT_REPEATS;
+  int first_file = 1;
+  if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+    repeats = atoi(argv[2]);
+    first_file = 3;
+  }
+  if (first_file >= argc || repeats == 0) {
+    fprintf(stderr, "Usage: %s [-r repeats] capture.pcap...\n", argv[0]);
+    return 2;
+  }
+
+  printf("%-32s %7s %7s %8s %11s %10s %8s\n", "capture", "packets", "bytes", "records",
+         "packets/s", "ns/record", "MB/s");
+  bool success = true;
+  for (int i = first_file; i < argc; i++) {
+    success = Benchmark(argv[i], repeats) && success;
+  }
+  PrintTypeStats(repeats);
+  return success ? 0 : 1;
+}
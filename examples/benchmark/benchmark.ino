@@ -0,0 +1,226 @@
+/*
+ * This sketch benchmarks the mDNS packet parser.
+ *
+ * The packets in corpus.h are replayed through MDns::loop() using a
+ * LoopbackTransport so no WiFi connection is needed. For each packet the
+ * packets/second and ns/record are reported.
+ * Then every record is decoded in isolation: the name with nameFromDnsPointer()
+ * and the whole record (name, fixed fields and PopulateAnswerResult()) with
+ * RecordView::toAnswer(). Time per decode and peak stack depth are reported
+ * for each record type.
+ *
+ * Timings include copying the packet into the LoopbackTransport, the same as
+ * lwIP would copy it into a WiFiUDP.
+ *
+ * This is the device side of the benchmark. benchmark/host_benchmark.cpp
+ * replays the same packets, and any other pcap captures, on a workstation.
+ */
+
+
+#include <mdns.h>
+#include <mdns_transport.h>
+
+#include "corpus.h"
+
+// How many times each packet or record is parsed per measurement.
+#define REPEATS 100
+
+// How much stack below the record callback is painted to measure stack depth.
+// Keep this well under the 4k ESP8266 stack.
+#define STACK_PROBE_SIZE 1024
+
+// Record types reported on.
+#define TYPE_SLOTS 8
+const unsigned int slot_types[TYPE_SLOTS] = {
+  MDNS_TYPE_A, MDNS_TYPE_PTR, MDNS_TYPE_HINFO, MDNS_TYPE_TXT,
+  MDNS_TYPE_AAAA, MDNS_TYPE_SRV, 0, 0
+};
+const char* slot_names[TYPE_SLOTS] = {
+  "A", "PTR", "HINFO", "TXT", "AAAA", "SRV", "other", "query"
+};
+
+typedef struct TypeStats {
+  unsigned long count;
+  unsigned long name_us;
+  unsigned long decode_us;
+  unsigned int name_stack;
+  unsigned int decode_stack;
+} TypeStats;
+TypeStats type_stats[TYPE_SLOTS];
+
+byte packet_buffer[MAX_PACKET_SIZE];
+byte transport_buffer[MAX_PACKET_SIZE + 8];
+mdns::LoopbackTransport transport(transport_buffer, sizeof(transport_buffer));
+
+// Counts records seen by the full MDns::loop() benchmark.
+unsigned long record_count = 0;
+
+void queryCallback(const mdns::Query* query) {
+  record_count++;
+}
+
+void answerCallback(const mdns::Answer* answer) {
+  record_count++;
+}
+
+byte full_buffer[MAX_PACKET_SIZE];
+mdns::MDns full_mdns(&transport, NULL, queryCallback, answerCallback,
+                     full_buffer, sizeof(full_buffer));
+
+byte isolated_buffer[MAX_PACKET_SIZE];
+mdns::MDns isolated_mdns(&transport, NULL, NULL, NULL,
+                         isolated_buffer, sizeof(isolated_buffer));
+
+
+// Fill the unused stack below the caller with a known pattern.
+void __attribute__((noinline)) paintStack() {
+  volatile byte probe[STACK_PROBE_SIZE];
+  for (unsigned int i = 0; i < STACK_PROBE_SIZE; i++) {
+    probe[i] = 0xA5;
+  }
+}
+
+// How much of the stack painted by paintStack() has since been overwritten.
+// Must be called from the same function as paintStack() so both probe arrays
+// land on the same addresses.
+unsigned int __attribute__((noinline)) stackUsed() {
+  volatile byte probe[STACK_PROBE_SIZE];
+  unsigned int i = 0;
+  while (i < STACK_PROBE_SIZE && probe[i] == 0xA5) {
+    i++;
+  }
+  return STACK_PROBE_SIZE - i;
+}
+
+unsigned int typeSlot(const mdns::RecordView* view) {
+  if (view->isQuery()) {
+    return TYPE_SLOTS - 1;
+  }
+  for (unsigned int i = 0; i < TYPE_SLOTS - 2; i++) {
+    if (slot_types[i] == view->rrtype()) {
+      return i;
+    }
+  }
+  return TYPE_SLOTS - 2;
+}
+
+// Decode every record in isolation.
+void recordCallback(const mdns::RecordView* view) {
+  TypeStats* stats = &type_stats[typeSlot(view)];
+  char name_buffer[MAX_MDNS_NAME_LEN];
+  mdns::Query query;
+  mdns::Answer answer;
+
+  stats->count++;
+
+  unsigned long start = micros();
+  for (unsigned int i = 0; i < REPEATS; i++) {
+    view->name(name_buffer, MAX_MDNS_NAME_LEN);
+  }
+  stats->name_us += micros() - start;
+
+  start = micros();
+  for (unsigned int i = 0; i < REPEATS; i++) {
+    if (view->isQuery()) {
+      view->toQuery(&query);
+    } else {
+      view->toAnswer(&answer);
+    }
+  }
+  stats->decode_us += micros() - start;
+
+  paintStack();
+  view->name(name_buffer, MAX_MDNS_NAME_LEN);
+  unsigned int used = stackUsed();
+  if (used > stats->name_stack) {
+    stats->name_stack = used;
+  }
+
+  paintStack();
+  if (view->isQuery()) {
+    view->toQuery(&query);
+  } else {
+    view->toAnswer(&answer);
+  }
+  used = stackUsed();
+  if (used > stats->decode_stack) {
+    stats->decode_stack = used;
+  }
+}
+
+void benchmarkLoop() {
+  Serial.println("MDns::loop() with Query and Answer callbacks:");
+  Serial.println("packet                        bytes  records  packets/s  ns/record");
+  for (unsigned int p = 0; p < corpus_count; p++) {
+    memcpy_P(packet_buffer, corpus[p].data, corpus[p].len);
+
+    record_count = 0;
+    const unsigned long start = micros();
+    for (unsigned int i = 0; i < REPEATS; i++) {
+      transport.inject(packet_buffer, corpus[p].len);
+      full_mdns.loop();
+    }
+    const unsigned long elapsed = micros() - start;
+
+    Serial.print(corpus[p].name);
+    for (unsigned int i = strlen(corpus[p].name); i < 30; i++) {
+      Serial.print(' ');
+    }
+    Serial.print(corpus[p].len);
+    Serial.print("    ");
+    Serial.print(record_count / REPEATS);
+    Serial.print("       ");
+    Serial.print(1000000.0 * REPEATS / elapsed);
+    Serial.print("    ");
+    Serial.println(record_count ? 1000.0 * elapsed / record_count : 0);
+    yield();
+  }
+  Serial.println();
+}
+
+void benchmarkRecords() {
+  memset(type_stats, 0, sizeof(type_stats));
+  for (unsigned int p = 0; p < corpus_count; p++) {
+    memcpy_P(packet_buffer, corpus[p].data, corpus[p].len);
+    transport.inject(packet_buffer, corpus[p].len);
+    isolated_mdns.loop();
+    yield();
+  }
+
+  Serial.println("Records decoded in isolation:");
+  Serial.println("type    count  name ns  record ns  name stack  record stack");
+  for (unsigned int i = 0; i < TYPE_SLOTS; i++) {
+    const TypeStats* stats = &type_stats[i];
+    if (stats->count == 0) {
+      continue;
+    }
+    Serial.print(slot_names[i]);
+    for (unsigned int j = strlen(slot_names[i]); j < 8; j++) {
+      Serial.print(' ');
+    }
+    Serial.print(stats->count);
+    Serial.print("     ");
+    Serial.print(1000.0 * stats->name_us / (stats->count * REPEATS));
+    Serial.print("    ");
+    Serial.print(1000.0 * stats->decode_us / (stats->count * REPEATS));
+    Serial.print("      ");
+    Serial.print(stats->name_stack);
+    Serial.print("         ");
+    Serial.println(stats->decode_stack);
+  }
+  Serial.println();
+}
+
+void setup() {
+  // Open serial communications and wait for port to open:
+  Serial.begin(115200);
+  Serial.println();
+
+  isolated_mdns.setRecordCallback(recordCallback);
+}
+
+void loop() {
+  benchmarkLoop();
+  benchmarkRecords();
+  delay(10000);
+}
@@ -0,0 +1,276 @@
+// mDNS packets used by the benchmark sketch.
+// Modelled on packets captured from Apple, Avahi, Chromecast and printer hosts
+// with names, addresses and keys anonymised.
+
+#ifndef BENCHMARK_CORPUS_H
+#define BENCHMARK_CORPUS_H
+
+typedef struct CorpusPacket {
+  const char* name;
+  const byte* data;
+  unsigned int len;
+} CorpusPacket;
+
+
+// 910 bytes.
+const byte corpus_apple_airplay_announce[] PROGMEM = {
+  0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x05, 0x08, 0x5F, 0x61, 0x69,
+  0x72, 0x70, 0x6C, 0x61, 0x79, 0x04, 0x5F, 0x74, 0x63, 0x70, 0x05, 0x6C, 0x6F, 0x63, 0x61, 0x6C,
+  0x00, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0E, 0x0B, 0x4C, 0x69, 0x76, 0x69,
+  0x6E, 0x67, 0x20, 0x52, 0x6F, 0x6F, 0x6D, 0xC0, 0x0C, 0x05, 0x5F, 0x72, 0x61, 0x6F, 0x70, 0xC0,
+  0x15, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x1B, 0x18, 0x32, 0x38, 0x46, 0x30,
+  0x37, 0x36, 0x36, 0x45, 0x34, 0x44, 0x31, 0x42, 0x40, 0x4C, 0x69, 0x76, 0x69, 0x6E, 0x67, 0x20,
+  0x52, 0x6F, 0x6F, 0x6D, 0xC0, 0x39, 0x09, 0x5F, 0x73, 0x65, 0x72, 0x76, 0x69, 0x63, 0x65, 0x73,
+  0x07, 0x5F, 0x64, 0x6E, 0x73, 0x2D, 0x73, 0x64, 0x04, 0x5F, 0x75, 0x64, 0x70, 0xC0, 0x1A, 0x00,
+  0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x02, 0xC0, 0x0C, 0xC0, 0x2B, 0x00, 0x21, 0x80,
+  0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x14, 0x00, 0x00, 0x00, 0x00, 0x1B, 0x58, 0x0B, 0x4C, 0x69,
+  0x76, 0x69, 0x6E, 0x67, 0x2D, 0x52, 0x6F, 0x6F, 0x6D, 0xC0, 0x1A, 0xC0, 0x2B, 0x00, 0x10, 0x80,
+  0x01, 0x00, 0x00, 0x11, 0x94, 0x01, 0x84, 0x05, 0x61, 0x63, 0x6C, 0x3D, 0x30, 0x18, 0x62, 0x74,
+  0x61, 0x64, 0x64, 0x72, 0x3D, 0x32, 0x38, 0x3A, 0x46, 0x30, 0x3A, 0x37, 0x36, 0x3A, 0x36, 0x45,
+  0x3A, 0x34, 0x44, 0x3A, 0x31, 0x41, 0x1A, 0x64, 0x65, 0x76, 0x69, 0x63, 0x65, 0x69, 0x64, 0x3D,
+  0x32, 0x38, 0x3A, 0x46, 0x30, 0x3A, 0x37, 0x36, 0x3A, 0x36, 0x45, 0x3A, 0x34, 0x44, 0x3A, 0x31,
+  0x42, 0x12, 0x66, 0x65, 0x78, 0x3D, 0x31, 0x64, 0x39, 0x2F, 0x53, 0x74, 0x35, 0x2F, 0x46, 0x62,
+  0x77, 0x6F, 0x6F, 0x51, 0x1E, 0x66, 0x65, 0x61, 0x74, 0x75, 0x72, 0x65, 0x73, 0x3D, 0x30, 0x78,
+  0x34, 0x41, 0x37, 0x46, 0x44, 0x46, 0x44, 0x35, 0x2C, 0x30, 0x78, 0x42, 0x43, 0x31, 0x35, 0x37,
+  0x46, 0x44, 0x45, 0x0D, 0x66, 0x6C, 0x61, 0x67, 0x73, 0x3D, 0x30, 0x78, 0x31, 0x38, 0x36, 0x34,
+  0x34, 0x28, 0x67, 0x69, 0x64, 0x3D, 0x34, 0x42, 0x33, 0x41, 0x31, 0x43, 0x32, 0x44, 0x2D, 0x39,
+  0x45, 0x38, 0x46, 0x2D, 0x34, 0x41, 0x35, 0x42, 0x2D, 0x38, 0x43, 0x37, 0x44, 0x2D, 0x36, 0x45,
+  0x35, 0x46, 0x34, 0x41, 0x33, 0x42, 0x32, 0x43, 0x31, 0x44, 0x05, 0x69, 0x67, 0x6C, 0x3D, 0x31,
+  0x06, 0x67, 0x63, 0x67, 0x6C, 0x3D, 0x31, 0x10, 0x6D, 0x6F, 0x64, 0x65, 0x6C, 0x3D, 0x41, 0x70,
+  0x70, 0x6C, 0x65, 0x54, 0x56, 0x36, 0x2C, 0x32, 0x0D, 0x70, 0x72, 0x6F, 0x74, 0x6F, 0x76, 0x65,
+  0x72, 0x73, 0x3D, 0x31, 0x2E, 0x31, 0x27, 0x70, 0x69, 0x3D, 0x32, 0x63, 0x31, 0x62, 0x35, 0x61,
+  0x38, 0x33, 0x2D, 0x35, 0x63, 0x34, 0x61, 0x2D, 0x34, 0x62, 0x32, 0x65, 0x2D, 0x39, 0x64, 0x33,
+  0x66, 0x2D, 0x31, 0x61, 0x32, 0x62, 0x33, 0x63, 0x34, 0x64, 0x35, 0x65, 0x36, 0x66, 0x28, 0x70,
+  0x73, 0x69, 0x3D, 0x38, 0x44, 0x37, 0x43, 0x36, 0x42, 0x35, 0x41, 0x2D, 0x34, 0x46, 0x33, 0x45,
+  0x2D, 0x32, 0x44, 0x31, 0x43, 0x2D, 0x30, 0x42, 0x39, 0x41, 0x2D, 0x38, 0x46, 0x37, 0x45, 0x36,
+  0x44, 0x35, 0x43, 0x34, 0x42, 0x33, 0x41, 0x43, 0x70, 0x6B, 0x3D, 0x64, 0x34, 0x63, 0x31, 0x66,
+  0x30, 0x39, 0x65, 0x36, 0x65, 0x66, 0x35, 0x62, 0x38, 0x65, 0x38, 0x65, 0x38, 0x63, 0x34, 0x36,
+  0x65, 0x34, 0x63, 0x33, 0x64, 0x38, 0x63, 0x62, 0x65, 0x32, 0x66, 0x30, 0x61, 0x35, 0x64, 0x37,
+  0x63, 0x31, 0x62, 0x39, 0x65, 0x33, 0x66, 0x32, 0x61, 0x34, 0x64, 0x36, 0x63, 0x38, 0x62, 0x30,
+  0x65, 0x31, 0x66, 0x33, 0x61, 0x35, 0x63, 0x37, 0x64, 0x39, 0x65, 0x0E, 0x73, 0x72, 0x63, 0x76,
+  0x65, 0x72, 0x73, 0x3D, 0x35, 0x35, 0x30, 0x2E, 0x31, 0x30, 0x0B, 0x6F, 0x73, 0x76, 0x65, 0x72,
+  0x73, 0x3D, 0x31, 0x34, 0x2E, 0x35, 0x04, 0x76, 0x76, 0x3D, 0x32, 0xC0, 0x4B, 0x00, 0x21, 0x80,
+  0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x1B, 0x58, 0xC0, 0x9D, 0xC0,
+  0x4B, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0xC2, 0x0A, 0x63, 0x6E, 0x3D, 0x30,
+  0x2C, 0x31, 0x2C, 0x32, 0x2C, 0x33, 0x07, 0x64, 0x61, 0x3D, 0x74, 0x72, 0x75, 0x65, 0x08, 0x65,
+  0x74, 0x3D, 0x30, 0x2C, 0x33, 0x2C, 0x35, 0x18, 0x66, 0x74, 0x3D, 0x30, 0x78, 0x34, 0x41, 0x37,
+  0x46, 0x44, 0x46, 0x44, 0x35, 0x2C, 0x30, 0x78, 0x42, 0x43, 0x31, 0x35, 0x37, 0x46, 0x44, 0x45,
+  0x0A, 0x73, 0x66, 0x3D, 0x30, 0x78, 0x31, 0x38, 0x36, 0x34, 0x34, 0x08, 0x6D, 0x64, 0x3D, 0x30,
+  0x2C, 0x31, 0x2C, 0x32, 0x0D, 0x61, 0x6D, 0x3D, 0x41, 0x70, 0x70, 0x6C, 0x65, 0x54, 0x56, 0x36,
+  0x2C, 0x32, 0x43, 0x70, 0x6B, 0x3D, 0x64, 0x34, 0x63, 0x31, 0x66, 0x30, 0x39, 0x65, 0x36, 0x65,
+  0x66, 0x35, 0x62, 0x38, 0x65, 0x38, 0x65, 0x38, 0x63, 0x34, 0x36, 0x65, 0x34, 0x63, 0x33, 0x64,
+  0x38, 0x63, 0x62, 0x65, 0x32, 0x66, 0x30, 0x61, 0x35, 0x64, 0x37, 0x63, 0x31, 0x62, 0x39, 0x65,
+  0x33, 0x66, 0x32, 0x61, 0x34, 0x64, 0x36, 0x63, 0x38, 0x62, 0x30, 0x65, 0x31, 0x66, 0x33, 0x61,
+  0x35, 0x63, 0x37, 0x64, 0x39, 0x65, 0x06, 0x74, 0x70, 0x3D, 0x55, 0x44, 0x50, 0x08, 0x76, 0x6E,
+  0x3D, 0x36, 0x35, 0x35, 0x33, 0x37, 0x09, 0x76, 0x73, 0x3D, 0x35, 0x35, 0x30, 0x2E, 0x31, 0x30,
+  0x07, 0x6F, 0x76, 0x3D, 0x31, 0x34, 0x2E, 0x35, 0x04, 0x76, 0x76, 0x3D, 0x32, 0xC0, 0x9D, 0x00,
+  0x01, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04, 0xC0, 0xA8, 0x01, 0x17, 0xC0, 0x9D, 0x00,
+  0x1C, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x10, 0xFE, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x1C, 0x3A, 0x5F, 0xFF, 0xFE, 0x12, 0x34, 0x56, 0xC0, 0x9D, 0x00, 0x1C, 0x80, 0x01, 0x00,
+  0x00, 0x00, 0x78, 0x00, 0x10, 0x20, 0x01, 0x0D, 0xB8, 0x12, 0x34, 0x00, 0x00, 0x1C, 0x3A, 0x5F,
+  0xFF, 0xFE, 0x12, 0x34, 0x56, 0xC0, 0x2B, 0x00, 0x2F, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00,
+  0x09, 0xC0, 0x2B, 0x00, 0x05, 0x00, 0x00, 0x80, 0x00, 0x40, 0xC0, 0x9D, 0x00, 0x2F, 0x80, 0x01,
+  0x00, 0x00, 0x00, 0x78, 0x00, 0x08, 0xC0, 0x9D, 0x00, 0x04, 0x40, 0x00, 0x00, 0x08,
+};
+
+// 223 bytes.
+const byte corpus_apple_browse_query[] PROGMEM = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x08, 0x5F, 0x61, 0x69,
+  0x72, 0x70, 0x6C, 0x61, 0x79, 0x04, 0x5F, 0x74, 0x63, 0x70, 0x05, 0x6C, 0x6F, 0x63, 0x61, 0x6C,
+  0x00, 0x00, 0x0C, 0x80, 0x01, 0x05, 0x5F, 0x72, 0x61, 0x6F, 0x70, 0xC0, 0x15, 0x00, 0x0C, 0x80,
+  0x01, 0x0F, 0x5F, 0x63, 0x6F, 0x6D, 0x70, 0x61, 0x6E, 0x69, 0x6F, 0x6E, 0x2D, 0x6C, 0x69, 0x6E,
+  0x6B, 0xC0, 0x15, 0x00, 0x0C, 0x80, 0x01, 0x0C, 0x5F, 0x73, 0x6C, 0x65, 0x65, 0x70, 0x2D, 0x70,
+  0x72, 0x6F, 0x78, 0x79, 0x04, 0x5F, 0x75, 0x64, 0x70, 0xC0, 0x1A, 0x00, 0x0C, 0x80, 0x01, 0x08,
+  0x5F, 0x68, 0x6F, 0x6D, 0x65, 0x6B, 0x69, 0x74, 0xC0, 0x15, 0x00, 0x0C, 0x80, 0x01, 0xC0, 0x0C,
+  0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x10, 0xE0, 0x00, 0x0E, 0x0B, 0x4C, 0x69, 0x76, 0x69, 0x6E,
+  0x67, 0x20, 0x52, 0x6F, 0x6F, 0x6D, 0xC0, 0x0C, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00,
+  0x10, 0xC2, 0x00, 0x0A, 0x07, 0x42, 0x65, 0x64, 0x72, 0x6F, 0x6F, 0x6D, 0xC0, 0x0C, 0xC0, 0x25,
+  0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x10, 0xE0, 0x00, 0x1B, 0x18, 0x32, 0x38, 0x46, 0x30, 0x37,
+  0x36, 0x36, 0x45, 0x34, 0x44, 0x31, 0x42, 0x40, 0x4C, 0x69, 0x76, 0x69, 0x6E, 0x67, 0x20, 0x52,
+  0x6F, 0x6F, 0x6D, 0xC0, 0x25, 0xC0, 0x31, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x10, 0x04, 0x00,
+  0x0E, 0x0B, 0x4C, 0x69, 0x76, 0x69, 0x6E, 0x67, 0x20, 0x52, 0x6F, 0x6F, 0x6D, 0xC0, 0x31,
+};
+
+// 466 bytes.
+const byte corpus_avahi_workstation_announce[] PROGMEM = {
+  0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x00, 0x0A, 0x66, 0x69, 0x6C,
+  0x65, 0x73, 0x65, 0x72, 0x76, 0x65, 0x72, 0x05, 0x6C, 0x6F, 0x63, 0x61, 0x6C, 0x00, 0x00, 0x01,
+  0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04, 0xC0, 0xA8, 0x01, 0x0A, 0xC0, 0x0C, 0x00, 0x1C,
+  0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x10, 0xFE, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x02, 0x1B, 0x21, 0xFF, 0xFE, 0x3A, 0x4F, 0x5C, 0xC0, 0x0C, 0x00, 0x0D, 0x80, 0x01, 0x00, 0x00,
+  0x00, 0x78, 0x00, 0x0D, 0x06, 0x58, 0x38, 0x36, 0x5F, 0x36, 0x34, 0x05, 0x4C, 0x49, 0x4E, 0x55,
+  0x58, 0x0C, 0x5F, 0x77, 0x6F, 0x72, 0x6B, 0x73, 0x74, 0x61, 0x74, 0x69, 0x6F, 0x6E, 0x04, 0x5F,
+  0x74, 0x63, 0x70, 0xC0, 0x17, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x21, 0x1E,
+  0x66, 0x69, 0x6C, 0x65, 0x73, 0x65, 0x72, 0x76, 0x65, 0x72, 0x20, 0x5B, 0x30, 0x30, 0x3A, 0x31,
+  0x62, 0x3A, 0x32, 0x31, 0x3A, 0x33, 0x61, 0x3A, 0x34, 0x66, 0x3A, 0x35, 0x63, 0x5D, 0xC0, 0x61,
+  0xC0, 0x7F, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x09, 0xC0, 0x0C, 0xC0, 0x7F, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x01,
+  0x00, 0x09, 0x5F, 0x73, 0x65, 0x72, 0x76, 0x69, 0x63, 0x65, 0x73, 0x07, 0x5F, 0x64, 0x6E, 0x73,
+  0x2D, 0x73, 0x64, 0x04, 0x5F, 0x75, 0x64, 0x70, 0xC0, 0x17, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00,
+  0x11, 0x94, 0x00, 0x02, 0xC0, 0x61, 0x04, 0x5F, 0x73, 0x73, 0x68, 0xC0, 0x6E, 0x00, 0x0C, 0x00,
+  0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0D, 0x0A, 0x66, 0x69, 0x6C, 0x65, 0x73, 0x65, 0x72, 0x76,
+  0x65, 0x72, 0xC0, 0xE6, 0xC0, 0xF7, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x08,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x16, 0xC0, 0x0C, 0xC0, 0xF7, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00,
+  0x11, 0x94, 0x00, 0x01, 0x00, 0xC0, 0xC1, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00,
+  0x02, 0xC0, 0xE6, 0x09, 0x5F, 0x73, 0x66, 0x74, 0x70, 0x2D, 0x73, 0x73, 0x68, 0xC0, 0x6E, 0x00,
+  0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0D, 0x0A, 0x66, 0x69, 0x6C, 0x65, 0x73, 0x65,
+  0x72, 0x76, 0x65, 0x72, 0xC1, 0x33, 0xC1, 0x49, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78,
+  0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16, 0xC0, 0x0C, 0xC1, 0x49, 0x00, 0x10, 0x80, 0x01,
+  0x00, 0x00, 0x11, 0x94, 0x00, 0x01, 0x00, 0xC0, 0xC1, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11,
+  0x94, 0x00, 0x02, 0xC1, 0x33, 0x04, 0x5F, 0x73, 0x6D, 0x62, 0xC0, 0x6E, 0x00, 0x0C, 0x00, 0x01,
+  0x00, 0x00, 0x11, 0x94, 0x00, 0x0D, 0x0A, 0x66, 0x69, 0x6C, 0x65, 0x73, 0x65, 0x72, 0x76, 0x65,
+  0x72, 0xC1, 0x85, 0xC1, 0x96, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x08, 0x00,
+  0x00, 0x00, 0x00, 0x01, 0xBD, 0xC0, 0x0C, 0xC1, 0x96, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x11,
+  0x94, 0x00, 0x01, 0x00, 0xC0, 0xC1, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x02,
+  0xC1, 0x85,
+};
+
+// 407 bytes.
+const byte corpus_chromecast_announce[] PROGMEM = {
+  0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x0B, 0x5F, 0x67, 0x6F,
+  0x6F, 0x67, 0x6C, 0x65, 0x63, 0x61, 0x73, 0x74, 0x04, 0x5F, 0x74, 0x63, 0x70, 0x05, 0x6C, 0x6F,
+  0x63, 0x61, 0x6C, 0x00, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x34, 0x31, 0x43,
+  0x68, 0x72, 0x6F, 0x6D, 0x65, 0x63, 0x61, 0x73, 0x74, 0x2D, 0x55, 0x6C, 0x74, 0x72, 0x61, 0x2D,
+  0x35, 0x65, 0x33, 0x66, 0x32, 0x61, 0x31, 0x62, 0x39, 0x63, 0x38, 0x64, 0x37, 0x65, 0x36, 0x66,
+  0x35, 0x61, 0x34, 0x62, 0x33, 0x63, 0x32, 0x64, 0x31, 0x65, 0x30, 0x66, 0x39, 0x61, 0x38, 0x62,
+  0xC0, 0x0C, 0x09, 0x5F, 0x63, 0x30, 0x61, 0x38, 0x30, 0x31, 0x31, 0x65, 0x04, 0x5F, 0x73, 0x75,
+  0x62, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x02, 0xC0, 0x2E, 0xC0,
+  0x2E, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0xC3, 0x23, 0x69, 0x64, 0x3D, 0x35,
+  0x65, 0x33, 0x66, 0x32, 0x61, 0x31, 0x62, 0x39, 0x63, 0x38, 0x64, 0x37, 0x65, 0x36, 0x66, 0x35,
+  0x61, 0x34, 0x62, 0x33, 0x63, 0x32, 0x64, 0x31, 0x65, 0x30, 0x66, 0x39, 0x61, 0x38, 0x62, 0x23,
+  0x63, 0x64, 0x3D, 0x41, 0x31, 0x42, 0x32, 0x43, 0x33, 0x44, 0x34, 0x45, 0x35, 0x46, 0x36, 0x30,
+  0x37, 0x31, 0x38, 0x32, 0x39, 0x33, 0x41, 0x34, 0x42, 0x35, 0x43, 0x36, 0x44, 0x37, 0x45, 0x38,
+  0x46, 0x39, 0x30, 0x13, 0x72, 0x6D, 0x3D, 0x37, 0x46, 0x31, 0x45, 0x32, 0x44, 0x33, 0x43, 0x34,
+  0x42, 0x35, 0x41, 0x36, 0x39, 0x37, 0x38, 0x05, 0x76, 0x65, 0x3D, 0x30, 0x35, 0x13, 0x6D, 0x64,
+  0x3D, 0x43, 0x68, 0x72, 0x6F, 0x6D, 0x65, 0x63, 0x61, 0x73, 0x74, 0x20, 0x55, 0x6C, 0x74, 0x72,
+  0x61, 0x12, 0x69, 0x63, 0x3D, 0x2F, 0x73, 0x65, 0x74, 0x75, 0x70, 0x2F, 0x69, 0x63, 0x6F, 0x6E,
+  0x2E, 0x70, 0x6E, 0x67, 0x11, 0x66, 0x6E, 0x3D, 0x4C, 0x69, 0x76, 0x69, 0x6E, 0x67, 0x20, 0x52,
+  0x6F, 0x6F, 0x6D, 0x20, 0x54, 0x56, 0x09, 0x63, 0x61, 0x3D, 0x32, 0x30, 0x31, 0x32, 0x32, 0x31,
+  0x04, 0x73, 0x74, 0x3D, 0x30, 0x0F, 0x62, 0x73, 0x3D, 0x46, 0x41, 0x38, 0x46, 0x43, 0x41, 0x38,
+  0x41, 0x31, 0x42, 0x32, 0x43, 0x04, 0x6E, 0x66, 0x3D, 0x31, 0x03, 0x72, 0x73, 0x3D, 0xC0, 0x2E,
+  0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x2D, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x49,
+  0x24, 0x35, 0x65, 0x33, 0x66, 0x32, 0x61, 0x31, 0x62, 0x2D, 0x39, 0x63, 0x38, 0x64, 0x2D, 0x37,
+  0x65, 0x36, 0x66, 0x2D, 0x35, 0x61, 0x34, 0x62, 0x2D, 0x33, 0x63, 0x32, 0x64, 0x31, 0x65, 0x30,
+  0x66, 0x39, 0x61, 0x38, 0x62, 0xC0, 0x1D, 0xC1, 0x60, 0x00, 0x01, 0x80, 0x01, 0x00, 0x00, 0x00,
+  0x78, 0x00, 0x04, 0xC0, 0xA8, 0x01, 0x1E,
+};
+
+// 594 bytes.
+const byte corpus_dnssd_enumeration[] PROGMEM = {
+  0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x00, 0x09, 0x5F, 0x73, 0x65,
+  0x72, 0x76, 0x69, 0x63, 0x65, 0x73, 0x07, 0x5F, 0x64, 0x6E, 0x73, 0x2D, 0x73, 0x64, 0x04, 0x5F,
+  0x75, 0x64, 0x70, 0x05, 0x6C, 0x6F, 0x63, 0x61, 0x6C, 0x00, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00,
+  0x11, 0x94, 0x00, 0x0D, 0x05, 0x5F, 0x68, 0x74, 0x74, 0x70, 0x04, 0x5F, 0x74, 0x63, 0x70, 0xC0,
+  0x23, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x09, 0x06, 0x5F, 0x68,
+  0x74, 0x74, 0x70, 0x73, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94,
+  0x00, 0x07, 0x04, 0x5F, 0x69, 0x70, 0x70, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00,
+  0x00, 0x11, 0x94, 0x00, 0x08, 0x05, 0x5F, 0x69, 0x70, 0x70, 0x73, 0xC0, 0x3A, 0xC0, 0x0C, 0x00,
+  0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0B, 0x08, 0x5F, 0x70, 0x72, 0x69, 0x6E, 0x74,
+  0x65, 0x72, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x12,
+  0x0F, 0x5F, 0x70, 0x64, 0x6C, 0x2D, 0x64, 0x61, 0x74, 0x61, 0x73, 0x74, 0x72, 0x65, 0x61, 0x6D,
+  0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0B, 0x08, 0x5F,
+  0x73, 0x63, 0x61, 0x6E, 0x6E, 0x65, 0x72, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00,
+  0x00, 0x11, 0x94, 0x00, 0x09, 0x06, 0x5F, 0x75, 0x73, 0x63, 0x61, 0x6E, 0xC0, 0x3A, 0xC0, 0x0C,
+  0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0A, 0x07, 0x5F, 0x75, 0x73, 0x63, 0x61,
+  0x6E, 0x73, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0B,
+  0x08, 0x5F, 0x61, 0x69, 0x72, 0x70, 0x6C, 0x61, 0x79, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00,
+  0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x08, 0x05, 0x5F, 0x72, 0x61, 0x6F, 0x70, 0xC0, 0x3A, 0xC0,
+  0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0E, 0x0B, 0x5F, 0x67, 0x6F, 0x6F,
+  0x67, 0x6C, 0x65, 0x63, 0x61, 0x73, 0x74, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00,
+  0x00, 0x11, 0x94, 0x00, 0x13, 0x10, 0x5F, 0x73, 0x70, 0x6F, 0x74, 0x69, 0x66, 0x79, 0x2D, 0x63,
+  0x6F, 0x6E, 0x6E, 0x65, 0x63, 0x74, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00,
+  0x11, 0x94, 0x00, 0x09, 0x06, 0x5F, 0x73, 0x6F, 0x6E, 0x6F, 0x73, 0xC0, 0x3A, 0xC0, 0x0C, 0x00,
+  0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x07, 0x04, 0x5F, 0x68, 0x61, 0x70, 0xC0, 0x3A,
+  0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0B, 0x08, 0x5F, 0x68, 0x6F,
+  0x6D, 0x65, 0x6B, 0x69, 0x74, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11,
+  0x94, 0x00, 0x0A, 0x07, 0x5F, 0x6D, 0x61, 0x74, 0x74, 0x65, 0x72, 0xC0, 0x3A, 0xC0, 0x0C, 0x00,
+  0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x08, 0x05, 0x5F, 0x6D, 0x71, 0x74, 0x74, 0xC0,
+  0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x07, 0x04, 0x5F, 0x73,
+  0x73, 0x68, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0C,
+  0x09, 0x5F, 0x73, 0x66, 0x74, 0x70, 0x2D, 0x73, 0x73, 0x68, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C,
+  0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x07, 0x04, 0x5F, 0x73, 0x6D, 0x62, 0xC0, 0x3A, 0xC0,
+  0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0E, 0x0B, 0x5F, 0x61, 0x66, 0x70,
+  0x6F, 0x76, 0x65, 0x72, 0x74, 0x63, 0x70, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00,
+  0x00, 0x11, 0x94, 0x00, 0x0F, 0x0C, 0x5F, 0x64, 0x65, 0x76, 0x69, 0x63, 0x65, 0x2D, 0x69, 0x6E,
+  0x66, 0x6F, 0xC0, 0x3A, 0xC0, 0x0C, 0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x12,
+  0x0F, 0x5F, 0x63, 0x6F, 0x6D, 0x70, 0x61, 0x6E, 0x69, 0x6F, 0x6E, 0x2D, 0x6C, 0x69, 0x6E, 0x6B,
+  0xC0, 0x3A,
+};
+
+// 845 bytes.
+const byte corpus_printer_large_txt[] PROGMEM = {
+  0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x03, 0x04, 0x5F, 0x69, 0x70,
+  0x70, 0x04, 0x5F, 0x74, 0x63, 0x70, 0x05, 0x6C, 0x6F, 0x63, 0x61, 0x6C, 0x00, 0x00, 0x0C, 0x00,
+  0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x29, 0x26, 0x48, 0x50, 0x20, 0x43, 0x6F, 0x6C, 0x6F, 0x72,
+  0x20, 0x4C, 0x61, 0x73, 0x65, 0x72, 0x4A, 0x65, 0x74, 0x20, 0x4D, 0x46, 0x50, 0x20, 0x4D, 0x34,
+  0x37, 0x39, 0x66, 0x64, 0x77, 0x20, 0x28, 0x33, 0x41, 0x34, 0x46, 0x35, 0x43, 0x29, 0xC0, 0x0C,
+  0xC0, 0x27, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x11, 0x00, 0x00, 0x00, 0x00,
+  0x02, 0x77, 0x08, 0x48, 0x50, 0x33, 0x41, 0x34, 0x46, 0x35, 0x43, 0xC0, 0x16, 0xC0, 0x27, 0x00,
+  0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x02, 0xC4, 0x09, 0x74, 0x78, 0x74, 0x76, 0x65, 0x72,
+  0x73, 0x3D, 0x31, 0x08, 0x71, 0x74, 0x6F, 0x74, 0x61, 0x6C, 0x3D, 0x31, 0x0C, 0x72, 0x70, 0x3D,
+  0x69, 0x70, 0x70, 0x2F, 0x70, 0x72, 0x69, 0x6E, 0x74, 0x20, 0x74, 0x79, 0x3D, 0x48, 0x50, 0x20,
+  0x43, 0x6F, 0x6C, 0x6F, 0x72, 0x20, 0x4C, 0x61, 0x73, 0x65, 0x72, 0x4A, 0x65, 0x74, 0x20, 0x4D,
+  0x46, 0x50, 0x20, 0x4D, 0x34, 0x37, 0x39, 0x66, 0x64, 0x77, 0x2F, 0x61, 0x64, 0x6D, 0x69, 0x6E,
+  0x75, 0x72, 0x6C, 0x3D, 0x68, 0x74, 0x74, 0x70, 0x3A, 0x2F, 0x2F, 0x48, 0x50, 0x33, 0x41, 0x34,
+  0x46, 0x35, 0x43, 0x2E, 0x6C, 0x6F, 0x63, 0x61, 0x6C, 0x2E, 0x2F, 0x23, 0x68, 0x49, 0x64, 0x2D,
+  0x70, 0x67, 0x41, 0x69, 0x72, 0x50, 0x72, 0x69, 0x6E, 0x74, 0x1B, 0x6E, 0x6F, 0x74, 0x65, 0x3D,
+  0x53, 0x65, 0x63, 0x6F, 0x6E, 0x64, 0x20, 0x66, 0x6C, 0x6F, 0x6F, 0x72, 0x20, 0x63, 0x6F, 0x70,
+  0x79, 0x20, 0x72, 0x6F, 0x6F, 0x6D, 0x0B, 0x70, 0x72, 0x69, 0x6F, 0x72, 0x69, 0x74, 0x79, 0x3D,
+  0x31, 0x30, 0x27, 0x70, 0x72, 0x6F, 0x64, 0x75, 0x63, 0x74, 0x3D, 0x28, 0x48, 0x50, 0x20, 0x43,
+  0x6F, 0x6C, 0x6F, 0x72, 0x20, 0x4C, 0x61, 0x73, 0x65, 0x72, 0x4A, 0x65, 0x74, 0x20, 0x4D, 0x46,
+  0x50, 0x20, 0x4D, 0x34, 0x37, 0x39, 0x66, 0x64, 0x77, 0x29, 0x99, 0x70, 0x64, 0x6C, 0x3D, 0x61,
+  0x70, 0x70, 0x6C, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6F, 0x6E, 0x2F, 0x6F, 0x63, 0x74, 0x65, 0x74,
+  0x2D, 0x73, 0x74, 0x72, 0x65, 0x61, 0x6D, 0x2C, 0x61, 0x70, 0x70, 0x6C, 0x69, 0x63, 0x61, 0x74,
+  0x69, 0x6F, 0x6E, 0x2F, 0x70, 0x64, 0x66, 0x2C, 0x61, 0x70, 0x70, 0x6C, 0x69, 0x63, 0x61, 0x74,
+  0x69, 0x6F, 0x6E, 0x2F, 0x70, 0x6F, 0x73, 0x74, 0x73, 0x63, 0x72, 0x69, 0x70, 0x74, 0x2C, 0x61,
+  0x70, 0x70, 0x6C, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6F, 0x6E, 0x2F, 0x76, 0x6E, 0x64, 0x2E, 0x68,
+  0x70, 0x2D, 0x50, 0x43, 0x4C, 0x2C, 0x61, 0x70, 0x70, 0x6C, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6F,
+  0x6E, 0x2F, 0x76, 0x6E, 0x64, 0x2E, 0x68, 0x70, 0x2D, 0x50, 0x43, 0x4C, 0x58, 0x4C, 0x2C, 0x69,
+  0x6D, 0x61, 0x67, 0x65, 0x2F, 0x6A, 0x70, 0x65, 0x67, 0x2C, 0x69, 0x6D, 0x61, 0x67, 0x65, 0x2F,
+  0x75, 0x72, 0x66, 0x2C, 0x69, 0x6D, 0x61, 0x67, 0x65, 0x2F, 0x70, 0x77, 0x67, 0x2D, 0x72, 0x61,
+  0x73, 0x74, 0x65, 0x72, 0x5D, 0x55, 0x52, 0x46, 0x3D, 0x56, 0x31, 0x2E, 0x34, 0x2C, 0x43, 0x50,
+  0x39, 0x39, 0x2C, 0x57, 0x38, 0x2C, 0x4F, 0x42, 0x31, 0x30, 0x2C, 0x50, 0x51, 0x33, 0x2D, 0x34,
+  0x2D, 0x35, 0x2C, 0x44, 0x4D, 0x31, 0x2C, 0x49, 0x53, 0x31, 0x2D, 0x32, 0x2D, 0x34, 0x2D, 0x35,
+  0x2C, 0x4D, 0x54, 0x31, 0x2D, 0x32, 0x2D, 0x33, 0x2D, 0x34, 0x2D, 0x35, 0x2D, 0x36, 0x2D, 0x38,
+  0x2D, 0x31, 0x30, 0x2D, 0x31, 0x31, 0x2D, 0x31, 0x32, 0x2D, 0x31, 0x33, 0x2C, 0x52, 0x53, 0x33,
+  0x30, 0x30, 0x2D, 0x36, 0x30, 0x30, 0x2C, 0x53, 0x52, 0x47, 0x42, 0x32, 0x34, 0x2C, 0x4F, 0x46,
+  0x55, 0x30, 0x11, 0x50, 0x61, 0x70, 0x65, 0x72, 0x4D, 0x61, 0x78, 0x3D, 0x6C, 0x65, 0x67, 0x61,
+  0x6C, 0x2D, 0x41, 0x34, 0x1C, 0x6B, 0x69, 0x6E, 0x64, 0x3D, 0x64, 0x6F, 0x63, 0x75, 0x6D, 0x65,
+  0x6E, 0x74, 0x2C, 0x65, 0x6E, 0x76, 0x65, 0x6C, 0x6F, 0x70, 0x65, 0x2C, 0x70, 0x68, 0x6F, 0x74,
+  0x6F, 0x07, 0x43, 0x6F, 0x6C, 0x6F, 0x72, 0x3D, 0x54, 0x08, 0x44, 0x75, 0x70, 0x6C, 0x65, 0x78,
+  0x3D, 0x54, 0x08, 0x43, 0x6F, 0x70, 0x69, 0x65, 0x73, 0x3D, 0x54, 0x09, 0x43, 0x6F, 0x6C, 0x6C,
+  0x61, 0x74, 0x65, 0x3D, 0x54, 0x05, 0x46, 0x61, 0x78, 0x3D, 0x54, 0x06, 0x53, 0x63, 0x61, 0x6E,
+  0x3D, 0x54, 0x29, 0x55, 0x55, 0x49, 0x44, 0x3D, 0x35, 0x36, 0x34, 0x65, 0x34, 0x33, 0x33, 0x33,
+  0x2D, 0x34, 0x65, 0x33, 0x30, 0x2D, 0x33, 0x37, 0x33, 0x30, 0x2D, 0x33, 0x35, 0x33, 0x32, 0x2D,
+  0x33, 0x61, 0x34, 0x66, 0x35, 0x63, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x07, 0x54, 0x4C, 0x53,
+  0x3D, 0x31, 0x2E, 0x32, 0x14, 0x6D, 0x6F, 0x70, 0x72, 0x69, 0x61, 0x2D, 0x63, 0x65, 0x72, 0x74,
+  0x69, 0x66, 0x69, 0x65, 0x64, 0x3D, 0x31, 0x2E, 0x33, 0x0A, 0x75, 0x73, 0x62, 0x5F, 0x4D, 0x46,
+  0x47, 0x3D, 0x48, 0x50, 0x25, 0x75, 0x73, 0x62, 0x5F, 0x4D, 0x44, 0x4C, 0x3D, 0x48, 0x50, 0x20,
+  0x43, 0x6F, 0x6C, 0x6F, 0x72, 0x20, 0x4C, 0x61, 0x73, 0x65, 0x72, 0x4A, 0x65, 0x74, 0x20, 0x4D,
+  0x46, 0x50, 0x20, 0x4D, 0x34, 0x37, 0x39, 0x66, 0x64, 0x77, 0x32, 0x75, 0x73, 0x62, 0x5F, 0x43,
+  0x4D, 0x44, 0x3D, 0x50, 0x4A, 0x4C, 0x2C, 0x50, 0x43, 0x4C, 0x2C, 0x50, 0x43, 0x4C, 0x58, 0x4C,
+  0x2C, 0x50, 0x44, 0x46, 0x2C, 0x50, 0x4F, 0x53, 0x54, 0x53, 0x43, 0x52, 0x49, 0x50, 0x54, 0x2C,
+  0x50, 0x57, 0x47, 0x52, 0x61, 0x73, 0x74, 0x65, 0x72, 0x2C, 0x55, 0x52, 0x46, 0xC0, 0x62, 0x00,
+  0x01, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04, 0xC0, 0xA8, 0x01, 0x28,
+};
+
+// 34 bytes.
+const byte corpus_mqtt_query[] PROGMEM = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x5F, 0x6D, 0x71,
+  0x74, 0x74, 0x04, 0x5F, 0x74, 0x63, 0x70, 0x05, 0x6C, 0x6F, 0x63, 0x61, 0x6C, 0x00, 0x00, 0x0C,
+  0x00, 0x01,
+};
+
+const CorpusPacket corpus[] = {
+  {"apple_airplay_announce", corpus_apple_airplay_announce, sizeof(corpus_apple_airplay_announce)},
+  {"apple_browse_query", corpus_apple_browse_query, sizeof(corpus_apple_browse_query)},
+  {"avahi_workstation_announce", corpus_avahi_workstation_announce, sizeof(corpus_avahi_workstation_announce)},
+  {"chromecast_announce", corpus_chromecast_announce, sizeof(corpus_chromecast_announce)},
+  {"dnssd_enumeration", corpus_dnssd_enumeration, sizeof(corpus_dnssd_enumeration)},
+  {"printer_large_txt", corpus_printer_large_txt, sizeof(corpus_printer_large_txt)},
+  {"mqtt_query", corpus_mqtt_query, sizeof(corpus_mqtt_query)},
+};
+
+const unsigned int corpus_count = sizeof(corpus) / sizeof(corpus[0]);
+
+#endif  // BENCHMARK_CORPUS_H
@@ -61,30 +61,16 @@ void answerCallback(const mdns::Answer* answer) {
   // A typical SRV record matches a human readable name to port and FQDN info.
   // eg:
   //  name:    Mosquitto MQTT server on twinkle.local
-  //  data:    p=0;w=0;port=1883;host=twinkle.local
+  //  port:    1883
+  //  host:    twinkle.local
   if (answer->rrtype == MDNS_TYPE_SRV) {
     unsigned int i = 0;
     for (; i < MAX_HOSTS; ++i) {
       if (hosts[i][HOSTS_SERVICE_NAME] == answer->name_buffer) {
-        // This hosts entry matches the name of the host we are looking for
-        // so parse data for port and hostname.
-        char* port_start = strstr(answer->rdata_buffer, "port=");
-        if (port_start) {
-          port_start += 5;
-          char* port_end = strchr(port_start, ';');
-          char port[1 + port_end - port_start];
-          strncpy(port, port_start, port_end - port_start);
-          port[port_end - port_start] = '\0';
-
-          if (port_end) {
-            char* host_start = strstr(port_end, "host=");
-            if (host_start) {
-              host_start += 5;
-              hosts[i][HOSTS_PORT] = port;
-              hosts[i][HOSTS_HOST_NAME] = host_start;
-            }
-          }
-        }
+        // This hosts entry matches the name of the host we are looking for.
+        // With legacy rdata text turned off the SRV record is already decoded.
+        hosts[i][HOSTS_PORT] = String(answer->srv.port);
+        hosts[i][HOSTS_HOST_NAME] = answer->rdata_buffer;
         break;
       }
     }
@@ -105,7 +91,7 @@ void answerCallback(const mdns::Answer* answer) {
     int i = 0;
     for (; i < MAX_HOSTS; ++i) {
       if (hosts[i][HOSTS_HOST_NAME] == answer->name_buffer) {
-        hosts[i][HOSTS_ADDRESS] = answer->rdata_buffer;
+        hosts[i][HOSTS_ADDRESS] = IPAddress(answer->ipv4).toString();
         break;
       }
     }
@@ -165,6 +151,9 @@ void setup()
 
   Serial.println("Connected to wifi");
 
+  // Use the decoded fields of mdns::Answer rather than parsing text.
+  my_mdns.setLegacyRdataText(false);
+
 
   // Query for all host information for a paticular service. ("_mqtt" in this case.)
   my_mdns.Clear();
@@ -197,12 +186,13 @@ void loop()
 #ifdef DEBUG_STATISTICS
   // Give feedback on the percentage of incoming mDNS packets that fitted in buffer.
   // Useful for tuning the buffer size to make best use of available memory.
-  if(last_packet_count != my_mdns.packet_count && my_mdns.packet_count != 0){
-    last_packet_count = my_mdns.packet_count;
+  const mdns::Stats stats = my_mdns.GetStats();
+  if(last_packet_count != stats.packets_received && stats.packets_received != 0){
+    last_packet_count = stats.packets_received;
     Serial.print("mDNS decode success rate: ");
-    Serial.print(100 - (100 * my_mdns.buffer_size_fail / my_mdns.packet_count));
+    Serial.print(100 - (100 * stats.packets_oversize / stats.packets_received));
     Serial.print("%\nLargest packet size: ");
-    Serial.println(my_mdns.largest_packet_seen);
+    Serial.println(stats.largest_packet);
   }
 #endif
 
@@ -0,0 +1,79 @@
+/*
+ * This sketch will find every host providing the service defined by
+ * QUESTION_SERVICE and display its address, port and TXT record.
+ * Unlike examples/mdns_test, the ServiceResolver sends all the follow-up
+ * queries and matches the records up so there is no parsing to do here.
+ */
+
+
+#include <mdns.h>
+#include <mdns_cache.h>
+#include <mdns_resolver.h>
+
+
+#define QUESTION_SERVICE "_mqtt._tcp.local"
+
+
+// Called once a host providing QUESTION_SERVICE has been fully resolved, when
+// any of its details change and when it leaves the network.
+// See mdns_resolver.h for definition of mdns::Service.
+void serviceCallback(const mdns::Service* service) {
+  if (service->removed) {
+    Serial.print("Gone:  ");
+    Serial.println(service->instance);
+    return;
+  }
+  Serial.print("Found: ");
+  Serial.println(service->instance);
+  Serial.print("  host:    ");
+  Serial.println(service->host);
+  Serial.print("  address: ");
+  Serial.println(service->ipv4);
+  Serial.print("  port:    ");
+  Serial.println(service->port);
+
+  char key[32];
+  char value[64];
+  const mdns::TxtRecord txt = service->txt();
+  for (unsigned int i = 0; i < txt.count(); i++) {
+    txt.item(i, key, sizeof(key), value, sizeof(value));
+    Serial.print("  txt:     ");
+    Serial.print(key);
+    Serial.print(" = ");
+    Serial.println(value);
+  }
+}
+
+mdns::MDns my_mdns(NULL, NULL, NULL);
+mdns::RecordCache cache;
+mdns::ServiceResolver resolver(QUESTION_SERVICE, serviceCallback, &cache);
+
+void setup() {
+  // Open serial communications and wait for port to open:
+  Serial.begin(115200);
+
+  // setting up Station AP
+  WiFi.begin("your_WiFI_SSID", "your_WiFi_password");
+
+  // Wait for connect to AP
+  int tries = 0;
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print(".");
+    tries++;
+    if (tries > 30) {
+      break;
+    }
+  }
+  Serial.println();
+
+  // The cache must be added first so it is up to date when the resolver looks
+  // at it.
+  my_mdns.addListener(&cache);
+  my_mdns.addListener(&resolver);
+}
+
+void loop() {
+  // Queries are sent from in here as they are needed.
+  my_mdns.loop();
+}
@@ -0,0 +1,56 @@
+/*
+ * This sketch advertises the host name "esp8266.local" and an HTTP service on
+ * port 80. Other hosts will find it by browsing for "_http._tcp", eg:
+ *   avahi-browse -r _http._tcp
+ *   dns-sd -B _http._tcp
+ * The Responder probes for its names, announces them and then answers any
+ * Queries for them from inside my_mdns.loop().
+ */
+
+
+#include <mdns.h>
+#include <mdns_responder.h>
+
+
+mdns::MDns my_mdns(NULL, NULL, NULL);
+mdns::Responder responder("esp8266");
+
+void setup() {
+  // Open serial communications and wait for port to open:
+  Serial.begin(115200);
+
+  // setting up Station AP
+  WiFi.begin("your_WiFI_SSID", "your_WiFi_password");
+
+  // Wait for connect to AP
+  int tries = 0;
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print(".");
+    tries++;
+    if (tries > 30) {
+      break;
+    }
+  }
+  Serial.println();
+
+  const int service = responder.AddService("ESP8266 web server", "_http._tcp", 80);
+  responder.AddServiceTxt(service, "path=/");
+  my_mdns.addListener(&responder);
+}
+
+void loop() {
+  static bool was_established = false;
+
+  // Probes, announcements and answers are all sent from in here.
+  my_mdns.loop();
+
+  if (responder.established() && !was_established) {
+    char host[64];
+    responder.hostname(host, sizeof(host));
+    Serial.print("Advertising as ");
+    Serial.print(host);
+    Serial.println(".local");
+  }
+  was_established = responder.established();
+}
@@ -55,12 +55,13 @@ void loop() {
 #ifdef DEBUG_STATISTICS
   // Give feedback on the percentage of incoming mDNS packets that fitted in buffer.
   // Useful for tuning the buffer size to make best use of available memory.
-  if(last_packet_count != my_mdns.packet_count && my_mdns.packet_count != 0){
-    last_packet_count = my_mdns.packet_count;
+  const mdns::Stats stats = my_mdns.GetStats();
+  if(last_packet_count != stats.packets_received && stats.packets_received != 0){
+    last_packet_count = stats.packets_received;
     Serial.print("mDNS decode success rate: ");
-    Serial.print(100 - (100 * my_mdns.buffer_size_fail / my_mdns.packet_count));
+    Serial.print(100 - (100 * stats.packets_oversize / stats.packets_received));
     Serial.print("%\nLargest packet size: ");
-    Serial.println(my_mdns.largest_packet_seen);
+    Serial.println(stats.largest_packet);
   }
 #endif
 }
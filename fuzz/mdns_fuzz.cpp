@@ -0,0 +1,121 @@
+// Fuzz target for the receive path.
+// Each input is one UDP payload. It is handed to MDns::loop() through a
+// LoopbackTransport with a RecordCache, ServiceResolver, Responder and
+// ResponseScheduler attached and the record arena in use. MDns is given a
+// data_buffer exactly the input's length so AddressSanitizer catches any read
+// past the end of the packet.
+//
+// Built by CMakeLists.txt with AddressSanitizer and UndefinedBehaviorSanitizer,
+// either linked with libFuzzer (clang, -DMDNS_LIBFUZZER=ON) or with
+// replay_main.cpp, which runs the files given on the command line. The
+// latter also suits AFL: afl-fuzz -i fuzz/corpus/seed -o out -- ./mdns_fuzz @@
+
+#include <Arduino.h>
+#include <mdns.h>
+#include <mdns_cache.h>
+#include <mdns_resolver.h>
+#include <mdns_responder.h>
+#include <mdns_scheduler.h>
+#include <mdns_transport.h>
+
+#include <stdlib.h>
+
+// Stops the optimiser discarding results.
+static volatile unsigned long sink;
+
+// Check what the RecordView accessors return against the packet.
+static void CheckView(const mdns::RecordView* view) {
+  char name_buffer[MAX_MDNS_NAME_LEN];
+  sink += view->name(name_buffer, MAX_MDNS_NAME_LEN);
+  sink += view->rrtype() + view->rrclass() + view->rrttl() + view->rrset();
+  sink += view->nameId() + view->nameHash();
+
+  mdns::Query query;
+  mdns::Answer answer;
+  if (view->isQuery()) {
+    view->toQuery(&query);
+    return;
+  }
+  view->toAnswer(&answer);
+  sink += answer.FormatRdata(name_buffer, MAX_MDNS_NAME_LEN);
+
+  // A name in the resource data must end inside it.
+  const unsigned int rdata_end = view->rdataOffset() + view->rdlength();
+  for (unsigned int rdata_pos = 0; rdata_pos <= 6; rdata_pos += 6) {
+    if (view->rdataName(name_buffer, MAX_MDNS_NAME_LEN, rdata_pos) >= 0 &&
+        mdns::skipDnsName(view->packet(), view->rdataOffset() + rdata_pos, rdata_end) < 0) {
+      abort();
+    }
+    sink += view->rdataNameId(rdata_pos) + view->rdataNameHash(rdata_pos);
+  }
+}
+
+static void CheckAnswer(const mdns::Answer* answer) {
+  char text_buffer[MAX_MDNS_NAME_LEN];
+  sink += answer->FormatRdata(text_buffer, MAX_MDNS_NAME_LEN);
+  answer->Display();
+
+  const mdns::TxtRecord txt = answer->txt();
+  char key_buffer[16];
+  char value_buffer[16];
+  for (unsigned int i = 0; i <= txt.count(); i++) {
+    sink += txt.item(i, key_buffer, sizeof(key_buffer), value_buffer, sizeof(value_buffer));
+  }
+  sink += txt.get("path", value_buffer, sizeof(value_buffer));
+}
+
+static void CheckRecords(const mdns::Record* records, const unsigned int record_count) {
+  for (unsigned int i = 0; i < record_count; i++) {
+    sink += strlen(records[i].name) + records[i].name_id + records[i].target_id;
+    if (records[i].target) {
+      sink += strlen(records[i].target);
+    }
+    for (unsigned int j = 0; records[i].rdata && j < records[i].rdlength; j++) {
+      sink += records[i].rdata[j];
+    }
+  }
+}
+
+// Feed the packet to a fresh MDns and Listeners.
+static void Run(const uint8_t* data, const size_t size, const bool legacy_rdata_text,
+                const uint16_t source_port) {
+  byte* packet_buffer = new byte[size];
+  byte transport_buffer[MDNS_HOST_MAX_DATAGRAM + 8];
+  mdns::LoopbackTransport transport(transport_buffer, sizeof(transport_buffer));
+  mdns::MDns mdns(&transport, NULL, [](const mdns::Query* query) { query->Display(); },
+                  CheckAnswer, packet_buffer, size);
+  mdns.setLegacyRdataText(legacy_rdata_text);
+  mdns.setRecordCallback(CheckView);
+
+  alignas(8) byte arena[1024];
+  mdns.setRecordArena(arena, sizeof(arena), CheckRecords);
+
+  mdns::RecordCache cache(8, 512);
+  mdns::ServiceResolver resolver("_http._tcp", [](const mdns::Service* service) {
+    sink += service->port;
+  }, &cache);
+  mdns::Responder responder("esp8266");
+  responder.AddService("Kitchen sensor", "_http._tcp", 80);
+  mdns::ResponseScheduler scheduler;
+  mdns.addListener(&cache);
+  mdns.addListener(&resolver);
+  mdns.addListener(&responder);
+  mdns.addListener(&scheduler);
+
+  // The Responder gets an address on the first loop().
+  mdns.loop();
+  transport.inject(data, size, IPAddress(10, 0, 0, 9), source_port);
+  mdns.loop();
+
+  delete[] packet_buffer;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (size == 0 || size > MDNS_HOST_MAX_DATAGRAM) {
+    return 0;
+  }
+  Run(data, size, true, MDNS_SOURCE_PORT);
+  // Legacy unicast Query.
+  Run(data, size, false, 49152);
+  return 0;
+}
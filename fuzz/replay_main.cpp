@@ -0,0 +1,65 @@
+// Runs the fuzz target over files and directories of inputs, for builds
+// without libFuzzer. eg: The regression test and AFL.
+// Usage: mdns_fuzz (file | directory)...
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+static unsigned int input_count = 0;
+
+static bool RunFile(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    fprintf(stderr, "Can't read %s\n", path.c_str());
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  size_t len;
+  while ((len = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + len);
+  }
+  fclose(file);
+  LLVMFuzzerTestOneInput(data.data(), data.size());
+  input_count++;
+  return true;
+}
+
+static bool RunPath(const std::string& path) {
+  struct stat path_stat;
+  if (stat(path.c_str(), &path_stat) != 0) {
+    fprintf(stderr, "Can't read %s\n", path.c_str());
+    return false;
+  }
+  if (!S_ISDIR(path_stat.st_mode)) {
+    return RunFile(path);
+  }
+  DIR* dir = opendir(path.c_str());
+  if (!dir) {
+    return false;
+  }
+  bool success = true;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] != '.') {
+      success = RunPath(path + "/" + entry->d_name) && success;
+    }
+  }
+  closedir(dir);
+  return success;
+}
+
+int main(int argc, char** argv) {
+  bool success = true;
+  for (int i = 1; i < argc; i++) {
+    success = RunPath(argv[i]) && success;
+  }
+  printf("Ran %u inputs.\n", input_count);
+  return success ? 0 : 1;
+}
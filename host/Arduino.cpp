@@ -0,0 +1,16 @@
+#include <Arduino.h>
+#include <chrono>
+
+HostSerial Serial;
+
+static const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start_time).count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start_time).count();
+}
@@ -0,0 +1,76 @@
+#ifndef MDNS_HOST_ARDUINO_H
+#define MDNS_HOST_ARDUINO_H
+
+// The parts of the Arduino core this library uses, for building it on a
+// workstation. See CMakeLists.txt.
+// Not for use in sketches. The Arduino IDE and PlatformIO provide the real
+// Arduino.h.
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define memcpy_P memcpy
+#define F(string) string
+
+#define DEC 10
+#define HEX 16
+
+// Milliseconds and microseconds since the program started.
+unsigned long millis();
+unsigned long micros();
+
+inline long random(const long max) { return max > 0 ? rand() % max : 0; }
+inline long random(const long min, const long max) { return min + random(max - min); }
+
+inline void delay(const unsigned long ms) { }
+inline void yield() { }
+
+// IPv4 address. Stored in network byte order like the ESP8266 core's.
+class IPAddress {
+ public:
+  IPAddress() { memset(address, 0, sizeof(address)); }
+  IPAddress(const uint8_t a, const uint8_t b, const uint8_t c, const uint8_t d) {
+    address[0] = a;
+    address[1] = b;
+    address[2] = c;
+    address[3] = d;
+  }
+  IPAddress(const uint32_t value) { memcpy(address, &value, sizeof(address)); }
+
+  operator uint32_t() const {
+    uint32_t value;
+    memcpy(&value, address, sizeof(value));
+    return value;
+  }
+  uint8_t operator[](const int index) const { return address[index]; }
+  uint8_t& operator[](const int index) { return address[index]; }
+  bool operator==(const IPAddress& other) const {
+    return memcmp(address, other.address, sizeof(address)) == 0;
+  }
+  bool operator!=(const IPAddress& other) const { return !(*this == other); }
+
+ private:
+  uint8_t address[4];
+};
+
+// Serial port. Output is discarded.
+class HostSerial {
+ public:
+  void begin(const unsigned long baud) { }
+  template<typename T> void print(const T& value) { }
+  template<typename T> void print(const T& value, const int format) { }
+  template<typename T> void println(const T& value) { }
+  template<typename T> void println(const T& value, const int format) { }
+  void println() { }
+};
+
+extern HostSerial Serial;
+
+#endif  // MDNS_HOST_ARDUINO_H
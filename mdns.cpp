@@ -1,120 +1,691 @@
 #include <Arduino.h>
 #include "mdns.h"
+#include "mdns_transport.h"
 
 
 namespace mdns {
 
-
-// A UDP instance to let us send and receive packets over UDP.
-WiFiUDP Udp;
-
 // Helper function to display formatted data.
 void PrintHex(const unsigned char data) {
-  char tmp[2];
-  sprintf(tmp, "%02X", data);
-  Serial.print(tmp);
-  Serial.print(" ");
+  char tmp[3];
+  snprintf(tmp, sizeof(tmp), "%02X", data);
+  MDNS_DEBUG_SERIAL.print(tmp);
+  MDNS_DEBUG_SERIAL.print(" ");
+}
+
+Transport* MDns::defaultTransport() {
+#ifdef ESP8266
+  static WiFiUdpTransport transport;
+#else
+  static PosixUdpTransport transport;
+#endif
+  return &transport;
 }
 
 void MDns::startUdpMulticast(){
 #ifdef DEBUG_OUTPUT
-  Serial.println("Initializing Multicast.");
+  MDNS_DEBUG_SERIAL.println("Initializing Multicast.");
+#endif
+  interfaces[0]->begin();
+}
+
+bool MDns::addInterface(Transport* transport_) {
+  if (interface_count >= MDNS_MAX_INTERFACES) {
+#ifdef DEBUG_OUTPUT
+    MDNS_DEBUG_SERIAL.println(" ERROR. Too many interfaces.");
+#endif
+    return false;
+  }
+  transport_->begin();
+  interfaces[interface_count++] = transport_;
+  return true;
+}
+
+bool MDns::restart() {
+#ifdef DEBUG_OUTPUT
+  MDNS_DEBUG_SERIAL.println("Restarting Multicast.");
 #endif
-  Udp.beginMulticast(WiFi.localIP(), IPAddress(224, 0, 0, 251), MDNS_TARGET_PORT);
+  // Any packet already peeked at went with the old sockets.
+  peeked_size = 0;
+  bool success = true;
+  for (unsigned int i = 0; i < interface_count; i++) {
+    success = interfaces[i]->restart() && success;
+  }
+  return success;
 }
 
 bool MDns::loop() {
-  data_size = Udp.parsePacket();
-  if ( data_size > 12) {
-    if(data_size > largest_packet_seen){
-      largest_packet_seen = data_size;
+  CheckHeld();
+  const bool result = ProcessPacket();
+  for (unsigned int i = 0; i < listener_count; i++) {
+    listeners[i]->poll(this);
+  }
+  return result;
+}
+
+unsigned int MDns::loop(const unsigned int max_packets, const unsigned long max_micros,
+                        bool* p_more_pending) {
+  const unsigned long start = micros();
+  unsigned int processed = 0;
+  CheckHeld();
+  while ((processed == 0 || (processed < max_packets && micros() - start < max_micros)) &&
+         PeekPacket()) {
+    ProcessPacket();
+    processed++;
+  }
+  if (p_more_pending) {
+    *p_more_pending = PeekPacket();
+  }
+  for (unsigned int i = 0; i < listener_count; i++) {
+    listeners[i]->poll(this);
+  }
+  return processed;
+}
+
+bool MDns::PeekPacket() {
+  for (unsigned int i = 0; peeked_size <= 0 && i < interface_count; i++) {
+    peeked_interface = (peeked_interface +1) % interface_count;
+    peeked_size = interfaces[peeked_interface]->parsePacket();
+  }
+  return peeked_size > 0;
+}
+
+void MDns::CheckHeld() {
+  if (reassembly_used > 0 && !timeBefore(millis(), reassembly_deadline)) {
+    // No more Known-Answers are coming.
+    ReleaseHeld();
+  }
+}
+
+bool MDns::addListener(Listener* listener) {
+  if (listener_count >= MDNS_MAX_LISTENERS) {
+#ifdef DEBUG_OUTPUT
+    MDNS_DEBUG_SERIAL.println(" ERROR. Too many Listeners.");
+#endif
+    return false;
+  }
+  listeners[listener_count++] = listener;
+  return true;
+}
+
+void MDns::removeListener(Listener* listener) {
+  for (unsigned int i = 0; i < listener_count; i++) {
+    if (listeners[i] == listener) {
+      listener_count--;
+      for (; i < listener_count; i++) {
+        listeners[i] = listeners[i +1];
+      }
+      return;
     }
+  }
+}
+
+bool MDns::ProcessPacket() {
+  PeekPacket();
+  data_size = peeked_size;
+  peeked_size = 0;
+  if ( data_size > 12) {
+    Transport* transport = interfaces[peeked_interface];
 #ifdef DEBUG_STATISTICS
+    const unsigned long start = micros();
+    stats_.packets_received++;
+    stats_.bytes_received += data_size;
+    if(data_size > stats_.largest_packet){
+      stats_.largest_packet = data_size;
+    }
     if(data_size > max_packet_size) {
-      buffer_size_fail++;
-      data_size = max_packet_size;
+      stats_.packets_oversize++;
     }
-    packet_count++;
 #endif
+    if(data_size > max_packet_size) {
+      // Only the start of the packet fits. Records past the end of data_buffer
+      // fail to parse.
+      data_size = max_packet_size;
+    }
+
+    const IPAddress source = transport->remoteIP();
+    if (reassembly_used > 0 && source == reassembly_source &&
+        peeked_interface == reassembly_interface &&
+        reassembly_used + data_size +2 > reassembly_size) {
+      // No room to hold this one too. Process what has arrived so far first
+      // since data_buffer is about to be overwritten. That also overwrites
+      // data_size.
+      const unsigned int incoming_size = data_size;
+      ReleaseHeld();
+      data_size = incoming_size;
+    }
 
     // We've received a packet which is long enough to contain useful data so
     // read the data from it.
-    Udp.read(data_buffer, data_size); // read the packet into the buffer
-    // data_buffer[0] and data_buffer[1] contain the Query ID field which is unused in mDNS.
-
-    // data_buffer[2] and data_buffer[3] are DNS flags which are mostly unused in mDNS.
-    type = !(data_buffer[2] & 0b10000000);  // If it's not a query, it's an answer.
-    truncated = data_buffer[2] & 0b00000010;  // If it's truncated we can expect more data soon so we should wait for additional records before deciding whether to respond.
-    if (data_buffer[3] & 0b00001111) {
-      // Non zero Response code implies error.
+    transport->read(data_buffer, data_size); // read the packet into the buffer
+    remote_ip = source;
+    remote_port = transport->remotePort();
+    packet_interface = peeked_interface;
+
+    if (!ParseHeader()) {
+      MDNS_STAT(stats_.fail_header++);
       return false;
     }
 
-    // Number of incoming queries.
-    query_count = (data_buffer[4] << 8) + data_buffer[5];
-
-    // Number of incoming answers.
-    answer_count = (data_buffer[6] << 8) + data_buffer[7];
-
-    // Number of incoming Name Server resource records.
-    ns_count = (data_buffer[8] << 8) + data_buffer[9];
-
-    // Number of incoming Additional resource records.
-    ar_count = (data_buffer[10] << 8) + data_buffer[11];
+    if (HoldPacket()) {
+      return true;
+    }
 
     if(p_packet_function_) {
       // Since a callback function has been registered, execute it.
       p_packet_function_(this);
     }
+    for (unsigned int i = 0; i < listener_count; i++) {
+      listeners[i]->onPacket(this);
+    }
 
 #ifdef DEBUG_OUTPUT
     Display();
 #endif  // DEBUG_OUTPUT
 
-    // Start of Data section.
-    buffer_pointer = 12;
+    name_id_count = 0;
+    const bool result = ProcessRecords();
 
-    for (unsigned int i_question = 0; i_question < query_count; i_question++) {
-      Query query;
-      Parse_Query(query);
-      if (query.valid) {
-        if (p_query_function_) {
-          // Since a callback function has been registered, execute it.
-          p_query_function_(&query);
-        }
-      }
-      if(buffer_pointer >= data_size){
-        return false;
-      }
+    for (unsigned int i = 0; i < listener_count; i++) {
+      listeners[i]->onPacketEnd(this);
+    }
+
+#ifdef DEBUG_RAW
+    DisplayRawPacket();
+#endif  // DEBUG_RAW
+
+#ifdef DEBUG_STATISTICS
+    const unsigned long elapsed = micros() - start;
+    unsigned int bucket = 0;
+    while (bucket < MDNS_STATS_PARSE_BUCKETS -1 &&
+           elapsed >= ((unsigned long)MDNS_STATS_PARSE_BUCKET_MICROS << bucket)) {
+      bucket++;
+    }
+    stats_.parse_micros[bucket]++;
+#endif
+    return result;
+  }
+  return true;  // Not enough data for a full packet to be waiting.
+}
+
+bool MDns::ParseHeader() {
+  // data_buffer[0] and data_buffer[1] contain the Query ID field which is unused in mDNS.
+
+  // data_buffer[2] and data_buffer[3] are DNS flags which are mostly unused in mDNS.
+  type = !(data_buffer[2] & 0b10000000);  // If it's not a query, it's an answer.
+  truncated = data_buffer[2] & 0b00000010;  // If it's truncated we can expect more data soon so we should wait for additional records before deciding whether to respond.
+  if (data_buffer[3] & 0b00001111) {
+    // Non zero Response code implies error.
+    return false;
+  }
+
+  // Number of incoming queries.
+  query_count = (data_buffer[4] << 8) + data_buffer[5];
+
+  // Number of incoming answers.
+  answer_count = (data_buffer[6] << 8) + data_buffer[7];
+
+  // Number of incoming Name Server resource records.
+  ns_count = (data_buffer[8] << 8) + data_buffer[9];
+
+  // Number of incoming Additional resource records.
+  ar_count = (data_buffer[10] << 8) + data_buffer[11];
+
+  return true;
+}
+
+bool MDns::ProcessRecords() {
+  // Start of Data section.
+  buffer_pointer = 12;
+
+  arena_record_count = 0;
+  arena_free_end = record_arena_size;
+  name_table_count = 0;
+  const bool result = ProcessRecordViews();
+  if (arena_record_count > 0) {
+    p_records_function_((const Record*)record_arena, arena_record_count);
+  }
+  return result;
+}
+
+bool MDns::ProcessRecordViews() {
+  for (unsigned int i_question = 0; i_question < query_count; i_question++) {
+    RecordView view;
+    if (!ParseRecordView(&view, MDNS_SECTION_QUESTION)) {
+      return false;
+    }
+    MDNS_STAT(CountRecord(view));
+    const bool subscribed = Subscribed(view);
+    if (subscribed && record_arena) {
+      AddArenaRecord(view);
+    }
+    if (subscribed && p_record_function_) {
+      // Since a callback function has been registered, execute it.
+      p_record_function_(&view);
+    }
+    for (unsigned int i = 0; i < listener_count; i++) {
+      listeners[i]->onRecord(this, &view);
+    }
+    if (type && answer_count == 0) {
+      RememberQuestion(view);
+    }
+    if (subscribed) {
 #ifdef DEBUG_OUTPUT
-      query.Display();
+      ProcessQuery(view);
+#else
+      if (p_query_function_) {
+        ProcessQuery(view);
+      }
 #endif  // DEBUG_OUTPUT
     }
+  }
 
-    for (unsigned int i_answer = 0; i_answer < (answer_count + ns_count + ar_count); i_answer++) {
-      Answer answer;
-      Parse_Answer(answer);
-      if (answer.valid) {
-        if (p_answer_function_) {
-          // Since a callback function has been registered, execute it.
-          p_answer_function_(&answer);
-        }
-      }
-      if(buffer_pointer >= data_size){
-        return false;
+  const unsigned int record_count = answer_count + ns_count + ar_count;
+  for (unsigned int i_answer = 0; i_answer < record_count; i_answer++) {
+    byte section = MDNS_SECTION_ADDITIONAL;
+    if (i_answer < answer_count) {
+      section = MDNS_SECTION_ANSWER;
+    } else if (i_answer < answer_count + ns_count) {
+      section = MDNS_SECTION_AUTHORITY;
+    }
+    RecordView view;
+    if (!ParseRecordView(&view, section)) {
+      return false;
+    }
+    MDNS_STAT(CountRecord(view));
+    const bool subscribed = Subscribed(view);
+    if (subscribed && record_arena) {
+      AddArenaRecord(view);
+    }
+    if (subscribed && p_record_function_) {
+      // Since a callback function has been registered, execute it.
+      p_record_function_(&view);
+    }
+    for (unsigned int i = 0; i < listener_count; i++) {
+      listeners[i]->onRecord(this, &view);
+    }
+    if (subscribed) {
+#ifdef DEBUG_OUTPUT
+      ProcessAnswer(view);
+#else
+      if (p_answer_function_) {
+        ProcessAnswer(view);
       }
+#endif  // DEBUG_OUTPUT
+    }
+  }
+  return true;
+}
+
+void MDns::setRecordArena(byte* arena_, const unsigned int arena_size_,
+                           std::function<void(const Record*, const unsigned int)>
+                               p_records_function) {
+  // Records hold pointers so must be aligned.
+  const unsigned int misalignment = (uintptr_t)arena_ % alignof(Record);
+  const unsigned int skip = misalignment ? alignof(Record) - misalignment : 0;
+  if (!arena_ || !p_records_function || arena_size_ < skip + sizeof(Record)) {
+    record_arena = NULL;
+    record_arena_size = 0;
+    return;
+  }
+  record_arena = arena_ + skip;
+  record_arena_size = arena_size_ - skip;
+  p_records_function_ = p_records_function;
+}
+
+byte* MDns::ArenaString(const unsigned int len) {
+  // Leave room for the Record this string belongs to.
+  const unsigned int records_end = (arena_record_count +1) * sizeof(Record);
+  if (records_end + len > arena_free_end) {
+    return NULL;
+  }
+  arena_free_end -= len;
+  return record_arena + arena_free_end;
+}
+
+const char* MDns::ArenaName(const RecordView& view, const int rdata_pos) {
+  // Names are decoded into the gap between the records and the strings, where
+  // their length is found, then moved up against the strings.
+  const unsigned int records_end = (arena_record_count +1) * sizeof(Record);
+  const int gap = arena_free_end - records_end;
+  char* p_gap = (char*)record_arena + records_end;
+  const int name_len = (rdata_pos < 0) ? view.name(p_gap, gap) :
+                                         view.rdataName(p_gap, gap, rdata_pos);
+  if (name_len < 0 || name_len +1 >= gap) {
+    // Corrupt or may have been truncated.
+    return NULL;
+  }
+  byte* p_string = ArenaString(name_len +1);
+  memmove(p_string, p_gap, name_len +1);
+  return (const char*)p_string;
+}
+
+void MDns::AddArenaRecord(const RecordView& view) {
+  const unsigned int free_end_start = arena_free_end;
+  if ((arena_record_count +1) * sizeof(Record) > arena_free_end) {
+    return;
+  }
+  Record& record = ((Record*)record_arena)[arena_record_count];
+
+  record.name = ArenaName(view, -1);
+  record.rrtype = view.rrtype();
+  record.rrclass = view.rrclass();
+  record.rrset = view.rrset();
+  record.rrttl = view.rrttl();
+  record.section = view.section();
+  record.rdlength = view.rdlength();
+  record.rdata = NULL;
+  record.target = NULL;
+  record.name_id = view.nameId();
+  record.target_id = MDNS_NAME_ID_NONE;
+  bool fits = (record.name != NULL);
+
+  if (fits && !view.isQuery()) {
+    byte* p_rdata = ArenaString(record.rdlength);
+    fits = (p_rdata != NULL);
+    if (fits) {
+      memcpy(p_rdata, view.rdata(), record.rdlength);
+      record.rdata = p_rdata;
+    }
+    if (fits && (record.rrtype == MDNS_TYPE_PTR || record.rrtype == MDNS_TYPE_SRV)) {
+      // SRV has priority, weight and port before the target name.
+      const unsigned int rdata_pos = (record.rrtype == MDNS_TYPE_SRV) ? 6 : 0;
+      record.target = ArenaName(view, rdata_pos);
+      record.target_id = view.rdataNameId(rdata_pos);
+      fits = (record.target != NULL);
+    }
+  }
+
+  if (!fits) {
+    // Give back anything taken for this record.
+    arena_free_end = free_end_start;
+    return;
+  }
+  arena_record_count++;
+}
+
+void MDns::CountRecord(const RecordView& view) {
+  switch (view.rrtype()) {
+    case MDNS_TYPE_A:
+      stats_.records_a++;
+      break;
+    case MDNS_TYPE_AAAA:
+      stats_.records_aaaa++;
+      break;
+    case MDNS_TYPE_PTR:
+      stats_.records_ptr++;
+      break;
+    case MDNS_TYPE_SRV:
+      stats_.records_srv++;
+      break;
+    case MDNS_TYPE_TXT:
+      stats_.records_txt++;
+      break;
+    default:
+      stats_.records_other++;
+      break;
+  }
+}
+
+void MDns::setReassemblyBuffer(byte* reassembly_buffer_, const unsigned int reassembly_size_) {
+  reassembly_buffer = reassembly_buffer_;
+  reassembly_size = reassembly_buffer_ ? reassembly_size_ : 0;
+  reassembly_used = 0;
+}
+
+bool MDns::HoldPacket() {
+  // Packets from different IPv6 hosts can't be told apart so their
+  // Known-Answers would get merged.
+  if (!type || data_size +2 > reassembly_size || !remoteIPKnown()) {
+    return false;
+  }
+  if (reassembly_used > 0) {
+    // Only Known-Answers from the host already being waited for.
+    if (remote_ip != reassembly_source || remote_port != reassembly_port ||
+        packet_interface != reassembly_interface) {
+      return false;
+    }
+  } else if (!truncated) {
+    return false;
+  }
+
+  reassembly_buffer[reassembly_used++] = (data_size & 0xFF00) >> 8;
+  reassembly_buffer[reassembly_used++] = data_size & 0xFF;
+  memcpy(reassembly_buffer + reassembly_used, data_buffer, data_size);
+  reassembly_used += data_size;
+  reassembly_source = remote_ip;
+  reassembly_port = remote_port;
+  reassembly_interface = packet_interface;
+
+  if (truncated) {
+    // More to come.
+    reassembly_deadline = millis() + random(MDNS_TRUNCATED_WAIT_MIN, MDNS_TRUNCATED_WAIT_MAX);
+  } else {
+    // This was the last packet.
+    ReleaseHeld();
+  }
+  return true;
+}
+
+void MDns::ReleaseHeld() {
+  const unsigned int held_end = reassembly_used;
+  reassembly_used = 0;
+
+  // To Listeners this is a single, complete Query.
+  remote_ip = reassembly_source;
+  remote_port = reassembly_port;
+  packet_interface = reassembly_interface;
+  type = true;
+  truncated = false;
+  for (unsigned int i = 0; i < listener_count; i++) {
+    listeners[i]->onPacket(this);
+  }
+
+  // Name ids are not reused within the Query so Listeners can keep what they
+  // worked out for one across the held packets.
+  name_id_count = 0;
+  unsigned int held_pos = 0;
+  while (held_pos +2 <= held_end) {
+    data_size = (reassembly_buffer[held_pos] << 8) + reassembly_buffer[held_pos +1];
+    memcpy(data_buffer, reassembly_buffer + held_pos +2, data_size);
+    held_pos += data_size +2;
+
+    ParseHeader();
+    type = true;
+    truncated = false;
+    if(p_packet_function_) {
+      // Since a callback function has been registered, execute it.
+      p_packet_function_(this);
+    }
 #ifdef DEBUG_OUTPUT
-      answer.Display();
+    Display();
 #endif  // DEBUG_OUTPUT
+    ProcessRecords();
+  }
+
+  for (unsigned int i = 0; i < listener_count; i++) {
+    listeners[i]->onPacketEnd(this);
+  }
+}
+
+bool MDns::ParseRecordView(RecordView* view, const byte section) {
+  view->mdns_ = this;
+  view->packet_ = data_buffer;
+  view->packet_size_ = data_size;
+  view->section_ = section;
+  view->name_offset_ = buffer_pointer;
+
+  const int name_end = skipDnsName(data_buffer, buffer_pointer, data_size);
+  if (name_end < 0) {
+    MDNS_STAT(stats_.fail_name++);
+#ifdef DEBUG_OUTPUT
+    MDNS_DEBUG_SERIAL.println(" **ERROR** Name runs past end of packet.");
+#endif
+    return false;
+  }
+  view->fixed_offset_ = name_end;
+
+  if (section == MDNS_SECTION_QUESTION) {
+    // Type and class.
+    view->rdata_offset_ = name_end + 4;
+    view->rdlength_ = 0;
+  } else {
+    // Type, class, TTL and rdata length.
+    view->rdata_offset_ = name_end + 10;
+    if (view->rdata_offset_ > data_size) {
+      MDNS_STAT(stats_.fail_overrun++);
+#ifdef DEBUG_OUTPUT
+      MDNS_DEBUG_SERIAL.println(" **ERROR** Record runs past end of packet.");
+#endif
+      return false;
     }
+    view->rdlength_ = (data_buffer[name_end + 8] << 8) + data_buffer[name_end + 9];
+  }
 
-#ifdef DEBUG_RAW
-    DisplayRawPacket();
-#endif  // DEBUG_RAW
+  if (view->rdata_offset_ + view->rdlength_ > data_size) {
+    MDNS_STAT(stats_.fail_overrun++);
+#ifdef DEBUG_OUTPUT
+    MDNS_DEBUG_SERIAL.println(" **ERROR** Record runs past end of packet.");
+#endif
+    return false;
+  }
+  buffer_pointer = view->rdata_offset_ + view->rdlength_;
+  return true;
+}
 
-    return true;
+// Hash of a Question for duplicate question suppression.
+static uint32_t questionHash(const uint32_t name_hash, const unsigned int qtype,
+                             const unsigned int qclass) {
+  return name_hash ^ (qtype * 2654435761UL) ^ (qclass << 16);
+}
+
+void MDns::RememberQuestion(const RecordView& view) {
+  if (remote_ip == localIP()) {
+    // One of our own packets looped back.
+    return;
   }
-  return true;  // Not enough data for a full packet to be waiting.
+  recent_question_hashes[recent_question_next] =
+      questionHash(view.nameHash(), view.rrtype(), view.rrclass());
+  recent_question_times[recent_question_next] = millis();
+  recent_question_next = (recent_question_next +1) % MDNS_RECENT_QUESTIONS;
+}
+
+void MDns::InternName(unsigned int offset, const unsigned int limit, byte* p_id,
+                      uint32_t* p_hash) {
+  *p_id = MDNS_NAME_ID_NONE;
+  *p_hash = 0;
+  if (skipDnsName(data_buffer, offset, limit) < 0) {
+    return;
+  }
+  // A name which starts with a Message Compression pointer shares the entry
+  // of the name pointed to, so a repeated target is only walked once.
+  unsigned int pointer_count = 0;
+  while (data_buffer[offset] >= 0xC0) {
+    const unsigned int pointer = ((data_buffer[offset] & 0x3F) << 8) + data_buffer[offset +1];
+    if (pointer >= offset || ++pointer_count > MDNS_MAX_NAME_POINTERS) {
+      return;
+    }
+    offset = pointer;
+  }
+  for (unsigned int i = 0; i < name_table_count; i++) {
+    if (name_table_offsets[i] == offset) {
+      *p_id = name_table_ids[i];
+      *p_hash = name_table_hashes[i];
+      return;
+    }
+  }
+
+  const uint32_t hash = nameHashFromDnsPointer(data_buffer, offset, data_size);
+  if (hash == 0) {
+    return;
+  }
+  *p_hash = hash;
+
+  // The same name may also be written out in full elsewhere in the packet.
+  byte id = MDNS_NAME_ID_NONE;
+  for (unsigned int i = 0; i < name_table_count; i++) {
+    if (name_table_hashes[i] == hash &&
+        sameDnsName(data_buffer, offset, name_table_offsets[i], data_size)) {
+      id = name_table_ids[i];
+      break;
+    }
+  }
+  if (name_table_count < MDNS_NAME_TABLE_SIZE) {
+    if (id == MDNS_NAME_ID_NONE && name_id_count < MDNS_NAME_ID_NONE) {
+      id = name_id_count++;
+    }
+    name_table_offsets[name_table_count] = offset;
+    name_table_hashes[name_table_count] = hash;
+    name_table_ids[name_table_count] = id;
+    name_table_count++;
+  }
+  *p_id = id;
+}
+
+bool MDns::QuestionRecentlySeen(const Query& query) const {
+  const uint32_t hash = questionHash(nameHash(query.qname_buffer), query.qtype, query.qclass);
+  const uint32_t now = millis();
+  for (unsigned int i = 0; i < MDNS_RECENT_QUESTIONS; i++) {
+    if (recent_question_hashes[i] == hash &&
+        now - recent_question_times[i] < MDNS_QUESTION_SUPPRESS_TIME) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MDns::GetQuery(const unsigned int index, Query* p_query) {
+  if (index >= query_count) {
+    return false;
+  }
+  unsigned int pos = 12;
+  for (unsigned int i = 0; i < index; i++) {
+    const int name_end = skipDnsName(data_buffer, pos, data_size);
+    if (name_end < 0) {
+      return false;
+    }
+    pos = name_end + 4;
+  }
+  const unsigned int buffer_pointer_saved = buffer_pointer;
+  buffer_pointer = pos;
+  Parse_Query(*p_query);
+  buffer_pointer = buffer_pointer_saved;
+  return p_query->valid;
+}
+
+void MDns::ProcessQuery(const RecordView& view) {
+  const unsigned int record_end = buffer_pointer;
+  buffer_pointer = view.name_offset_;
+
+  Query query;
+  Parse_Query(query);
+  if (query.valid && p_query_function_) {
+    // Since a callback function has been registered, execute it.
+    p_query_function_(&query);
+  }
+#ifdef DEBUG_OUTPUT
+  query.Display();
+#endif  // DEBUG_OUTPUT
+
+  buffer_pointer = record_end;
+}
+
+void MDns::ProcessAnswer(const RecordView& view) {
+  const unsigned int record_end = buffer_pointer;
+  buffer_pointer = view.name_offset_;
+
+  Answer answer;
+  Parse_Answer(answer);
+  MDNS_STAT(stats_.fail_rdata += !answer.valid);
+  if (answer.valid && p_answer_function_) {
+    // Since a callback function has been registered, execute it.
+    p_answer_function_(&answer);
+  }
+#ifdef DEBUG_OUTPUT
+  answer.Display();
+#endif  // DEBUG_OUTPUT
+
+  buffer_pointer = record_end;
 }
 
 void MDns::Clear() {
@@ -138,48 +709,317 @@ void MDns::Clear() {
   answer_count = 0;
   ns_count = 0;
   ar_count = 0;
+  compression_count = 0;
+  send_interface = MDNS_ALL_INTERFACES;
+  auto_flush = false;
+  flush_count = 0;
 }
 
-unsigned int MDns::PopulateName(const char* name_buffer) {
-  // TODO: This section does not match the full mDNS spec
-  // as it does not re-use strings from previous queries.
+void MDns::Flush() {
+  // The next packet carries on with the same ID and flags.
+  byte header[4];
+  memcpy(header, data_buffer, 4);
+  const bool type_saved = type;
+  const int send_interface_saved = send_interface;
+  const unsigned int flush_count_saved = flush_count;
+
+  if (!(header[2] & 0b10000000)) {
+    // The Query continues in the next packet. (RFC 6762 7.2)
+    data_buffer[2] |= 0b00000010;
+  }
+  Send();
+
+  Clear();
+  memcpy(data_buffer, header, 4);
+  type = type_saved;
+  send_interface = send_interface_saved;
+  auto_flush = true;
+  flush_count = flush_count_saved +1;
+}
 
-  unsigned int buffer_pointer_start = buffer_pointer;
-  int word_start = 0, word_end = 0;
-  while (true) {
-    if (name_buffer[word_end] == '.' or name_buffer[word_end] == '\0') {
-      const int word_length = word_end - word_start;
-      if(buffer_pointer >= data_size){
-        buffer_pointer = buffer_pointer_start;
-#ifdef DEBUG_OUTPUT
-        Serial.println(" ERROR. MDns::PopulateName overran buffer.");
-#endif
+// Hash of a single label. Case insensitive as DNS names are.
+static uint32_t labelHash(const char* label, const unsigned int label_len) {
+  uint32_t hash = 2166136261UL;  // FNV-1a.
+  for (unsigned int i = 0; i < label_len; i++) {
+    hash ^= (byte)tolower(label[i]);
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+// Hash of a name suffix made from the hash of its first label and the hash of
+// the rest of the suffix.
+static uint32_t suffixHash(const uint32_t label_hash, const uint32_t next_suffix_hash) {
+  return (next_suffix_hash * 31) ^ label_hash ^ (next_suffix_hash >> 16);
+}
+
+// Hashes of the last labels of the name at packet_buffer_pos, read straight
+// from the packet. p_suffix_hashes[i] is the suffixHash() of the last i+1
+// labels. Returns how many were filled in, up to MDNS_SUBSCRIPTION_MAX_LABELS,
+// or 0 if the name is corrupt.
+static unsigned int suffixHashesFromDnsPointer(const byte* p_packet_buffer, int packet_buffer_pos,
+                                               const int packet_buffer_len,
+                                               uint32_t* p_suffix_hashes) {
+  // Only the last few labels matter so keep their hashes in a ring.
+  uint32_t label_hashes[MDNS_SUBSCRIPTION_MAX_LABELS];
+  unsigned int label_count = 0;
+
+  // Same rules for following pointers as nameFromDnsPointer().
+  int pointer_limit = packet_buffer_pos;
+  int pointer_count = 0;
+  while (packet_buffer_pos < packet_buffer_len) {
+    const byte word_len = p_packet_buffer[packet_buffer_pos];
+    if (word_len >= 0xC0) {
+      if (packet_buffer_pos +2 > packet_buffer_len) {
+        return 0;
+      }
+      const int pointer = ((word_len & 0x3F) << 8) + p_packet_buffer[packet_buffer_pos +1];
+      if (pointer >= pointer_limit || ++pointer_count > MDNS_MAX_NAME_POINTERS) {
         return 0;
       }
-      data_buffer[buffer_pointer++] = (unsigned byte)word_length;
-      for (int i = word_start; i < word_end; ++i) {
-        if(buffer_pointer >= data_size){
-          buffer_pointer = buffer_pointer_start;
+      pointer_limit = pointer;
+      packet_buffer_pos = pointer;
+      continue;
+    }
+    if (word_len > 0x3F || packet_buffer_pos + word_len +1 > packet_buffer_len) {
+      return 0;
+    }
+    if (word_len == 0) {
+      const unsigned int hash_count = (label_count < MDNS_SUBSCRIPTION_MAX_LABELS) ?
+                                      label_count : MDNS_SUBSCRIPTION_MAX_LABELS;
+      uint32_t suffix_hash = 0;
+      for (unsigned int i = 0; i < hash_count; i++) {
+        suffix_hash = suffixHash(label_hashes[(label_count -1 -i) % MDNS_SUBSCRIPTION_MAX_LABELS],
+                                 suffix_hash);
+        p_suffix_hashes[i] = suffix_hash;
+      }
+      return hash_count;
+    }
+    label_hashes[label_count % MDNS_SUBSCRIPTION_MAX_LABELS] =
+        labelHash((const char*)p_packet_buffer + packet_buffer_pos +1, word_len);
+    label_count++;
+    packet_buffer_pos += word_len +1;
+  }
+  return 0;
+}
+
+bool MDns::Subscribe(const char* suffix, const unsigned int rrtype) {
+  if (subscription_count >= MDNS_MAX_SUBSCRIPTIONS) {
+    return false;
+  }
+
+  // Find the labels. Empty labels (eg: a trailing '.') are skipped.
+  const char* label_starts[MDNS_SUBSCRIPTION_MAX_LABELS];
+  unsigned int label_lens[MDNS_SUBSCRIPTION_MAX_LABELS];
+  unsigned int label_count = 0;
+  while (*suffix != '\0') {
+    const char* label_end = strchr(suffix, '.');
+    const unsigned int label_len = label_end ? (unsigned int)(label_end - suffix) : strlen(suffix);
+    if (label_len > 0) {
+      if (label_count >= MDNS_SUBSCRIPTION_MAX_LABELS || label_len > 63) {
+        return false;
+      }
+      label_starts[label_count] = suffix;
+      label_lens[label_count] = label_len;
+      label_count++;
+    }
+    suffix += label_len;
+    if (*suffix == '.') {
+      suffix++;
+    }
+  }
+  if (label_count == 0) {
+    return false;
+  }
+
+  // Hash from the last label back, the same as suffixHashesFromDnsPointer().
+  uint32_t suffix_hash = 0;
+  for (int i = label_count -1; i >= 0; i--) {
+    suffix_hash = suffixHash(labelHash(label_starts[i], label_lens[i]), suffix_hash);
+  }
+
+  Subscription& subscription = subscriptions[subscription_count++];
+  subscription.suffix_hash = suffix_hash;
+  subscription.label_count = label_count;
+  subscription.rrtype = rrtype;
+  return true;
+}
+
+bool MDns::Subscribed(const RecordView& view) const {
+  if (subscription_count == 0) {
+    return true;
+  }
+  const unsigned int rrtype = view.rrtype();
+  uint32_t suffix_hashes[MDNS_SUBSCRIPTION_MAX_LABELS];
+  int hash_count = -1;
+  for (unsigned int i = 0; i < subscription_count; i++) {
+    const Subscription& subscription = subscriptions[i];
+    if (subscription.rrtype != MDNS_TYPE_ANY && rrtype != MDNS_TYPE_ANY &&
+        subscription.rrtype != rrtype) {
+      continue;
+    }
+    if (hash_count < 0) {
+      // Only walk the name once a type has matched.
+      hash_count = suffixHashesFromDnsPointer(data_buffer, view.name_offset_, data_size,
+                                              suffix_hashes);
+    }
+    if (subscription.label_count <= (unsigned int)hash_count &&
+        suffix_hashes[subscription.label_count -1] == subscription.suffix_hash) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool MDns::MatchName(unsigned int offset, const char* name_buffer) const {
+  // Walk the labels already written to data_buffer, following Message
+  // Compression pointers, and compare them with the dotted name.
+  int hops = 0;
+  while (offset < buffer_pointer) {
+    const byte word_len = data_buffer[offset];
+    if (word_len >= 0xC0) {
+      if (++hops > 8 || offset +1 >= buffer_pointer) {
+        return false;
+      }
+      offset = ((word_len & 0x3F) << 8) + data_buffer[offset +1];
+      continue;
+    }
+    if (word_len == 0) {
+      return *name_buffer == '\0';
+    }
+    if (offset + word_len >= buffer_pointer) {
+      return false;
+    }
+    for (unsigned int i = 1; i <= word_len; i++) {
+      if (tolower(*name_buffer) != tolower(data_buffer[offset + i]) || *name_buffer == '\0') {
+        return false;
+      }
+      name_buffer++;
+    }
+    if (*name_buffer == '.') {
+      name_buffer++;
+    } else if (*name_buffer != '\0') {
+      return false;
+    }
+    offset += word_len +1;
+  }
+  return false;
+}
+
+unsigned int MDns::PopulateName(const char* name_buffer) {
+  const unsigned int buffer_pointer_start = buffer_pointer;
+  const unsigned int compression_count_start = compression_count;
+
+  // Count the labels. Empty labels (eg: a trailing '.') are skipped.
+  unsigned int name_len = 0, label_count = 0;
+  for (; name_buffer[name_len] != '\0'; name_len++) {
+    if (name_buffer[name_len] != '.' && (name_len == 0 || name_buffer[name_len -1] == '.')) {
+      label_count++;
+    }
+  }
+  if (name_len >= MAX_MDNS_NAME_LEN) {
 #ifdef DEBUG_OUTPUT
-          Serial.println(" ERROR. MDns::PopulateName overran buffer.");
+    MDNS_DEBUG_SERIAL.println(" ERROR. MDns::PopulateName name too long.");
 #endif
-          return 0;
-        }
-        data_buffer[buffer_pointer++] = name_buffer[i];
-      }
-      if(name_buffer[word_end] == '\0'){
+    return 0;
+  }
+
+  // Hash every suffix of the name working backwards from the last label so the
+  // whole name only gets read once. Look each one up in the table of names
+  // already in the packet. The left most match is the longest suffix that can
+  // be replaced by a Message Compression pointer. (RFC 1035 4.1.4)
+  const unsigned int compression_free = MDNS_COMPRESSION_TABLE_SIZE - compression_count_start;
+  uint32_t suffix_hash[MDNS_COMPRESSION_TABLE_SIZE];
+  uint32_t next_suffix_hash = 0;
+  unsigned int match_label = label_count;
+  unsigned int match_offset = 0;
+  unsigned int word_end = name_len;
+  for (int i = label_count -1; i >= 0; i--) {
+    while (name_buffer[word_end -1] == '.') {
+      word_end--;
+    }
+    unsigned int word_start = word_end;
+    while (word_start > 0 && name_buffer[word_start -1] != '.') {
+      word_start--;
+    }
+    if (word_end - word_start > 63) {
+#ifdef DEBUG_OUTPUT
+      MDNS_DEBUG_SERIAL.println(" ERROR. MDns::PopulateName label too long.");
+#endif
+      return 0;
+    }
+    next_suffix_hash = suffixHash(labelHash(name_buffer + word_start, word_end - word_start),
+                                  next_suffix_hash);
+    if ((unsigned int)i < compression_free) {
+      suffix_hash[i] = next_suffix_hash;
+    }
+    for (unsigned int c = 0; c < compression_count_start; c++) {
+      if (compression_hashes[c] == next_suffix_hash &&
+          MatchName(compression_offsets[c], name_buffer + word_start)) {
+        match_label = i;
+        match_offset = compression_offsets[c];
         break;
       }
-      word_end++;  // Skip the '.' character.
-      word_start = word_end;
     }
-    word_end++;
-  };
+    word_end = word_start;
+  }
+
+  // Write the labels that could not be compressed.
+  unsigned int word_start = 0;
+  for (unsigned int i = 0; i < match_label; i++) {
+    while (name_buffer[word_start] == '.') {
+      word_start++;
+    }
+    word_end = word_start;
+    while (name_buffer[word_end] != '.' && name_buffer[word_end] != '\0') {
+      word_end++;
+    }
+    const unsigned int word_length = word_end - word_start;
+    if(buffer_pointer + word_length +1 > max_packet_size){
+      buffer_pointer = buffer_pointer_start;
+      compression_count = compression_count_start;
+      overflowed = true;
+#ifdef DEBUG_OUTPUT
+      MDNS_DEBUG_SERIAL.println(" ERROR. MDns::PopulateName overran buffer.");
+#endif
+      return 0;
+    }
+
+    // Remember where this suffix starts so later names can point to it.
+    if (i < compression_free && buffer_pointer < 0x3FFF) {
+      compression_offsets[compression_count] = buffer_pointer;
+      compression_hashes[compression_count] = suffix_hash[i];
+      compression_count++;
+    }
+
+    data_buffer[buffer_pointer++] = word_length;
+    memcpy(data_buffer + buffer_pointer, name_buffer + word_start, word_length);
+    buffer_pointer += word_length;
+    word_start = word_end;
+  }
+
+  if (match_label < label_count) {
+    // Point to the rest of the name which is already in the packet.
+    if(buffer_pointer +2 > max_packet_size){
+      buffer_pointer = buffer_pointer_start;
+      compression_count = compression_count_start;
+      overflowed = true;
+#ifdef DEBUG_OUTPUT
+      MDNS_DEBUG_SERIAL.println(" ERROR. MDns::PopulateName overran buffer while finishing.");
+#endif
+      return 0;
+    }
+    data_buffer[buffer_pointer++] = 0xC0 | (match_offset >> 8);
+    data_buffer[buffer_pointer++] = match_offset & 0xFF;
+    return buffer_pointer - buffer_pointer_start;
+  }
   
-  if(buffer_pointer >= data_size){
+  if(buffer_pointer >= max_packet_size){
     buffer_pointer = buffer_pointer_start;
+    compression_count = compression_count_start;
+    overflowed = true;
 #ifdef DEBUG_OUTPUT
-    Serial.println(" ERROR. MDns::PopulateName overran buffer while finishing.");
+    MDNS_DEBUG_SERIAL.println(" ERROR. MDns::PopulateName overran buffer while finishing.");
 #endif
     return 0;
   }
@@ -189,153 +1029,416 @@ unsigned int MDns::PopulateName(const char* name_buffer) {
 }
 
 bool MDns::AddQuery(const Query& query) {
-  if (answer_count || ns_count || ar_count) {
+  return AddFlushing([&]() {
+    if (answer_count || ns_count || ar_count) {
 #ifdef DEBUG_OUTPUT
-    Serial.println(" ERROR. Resource records included before Queries.");
+      MDNS_DEBUG_SERIAL.println(" ERROR. Resource records included before Queries.");
+#endif
+      return false;
+    }
+
+    const unsigned int compression_count_start = compression_count;
+   
+    // Create DNS name buffer from qname.
+    if(PopulateName(query.qname_buffer) == 0 || buffer_pointer +4 > max_packet_size){
+#ifdef DEBUG_OUTPUT
+      MDNS_DEBUG_SERIAL.println(" ERROR. MDns::AddQuery overran buffer.");
+#endif
+      overflowed = overflowed || buffer_pointer +4 > max_packet_size;
+      buffer_pointer = data_size;
+      compression_count = compression_count_start;
+      return false;
+    }
+    // The rest of the flags.
+    data_buffer[buffer_pointer++] = (query.qtype & 0xFF00) >> 8;
+    data_buffer[buffer_pointer++] = query.qtype & 0xFF;
+    unsigned int qclass = 0;
+    if (query.unicast_response) {
+      qclass = 0b1000000000000000;
+    }
+    qclass += query.qclass;
+    data_buffer[buffer_pointer++] = (qclass & 0xFF00) >> 8;
+    data_buffer[buffer_pointer++] = qclass & 0xFF;
+    data_size = buffer_pointer;
+    
+    // Since the data fitted in the buffer, it's ok to update the header.
+    data_buffer[2] = 0;     // 0b00000000 for Query, 0b10000000 for Answer.
+    type = 1;
+    ++query_count;
+    data_buffer[4] = (query_count & 0xFF00) >> 8;
+    data_buffer[5] = query_count & 0xFF;
+
+    return true;
+  });
+}
+
+bool MDns::AddAnswer(const Answer& answer) {
+  return AddFlushing([&]() {
+    if (!StartRecord(MDNS_SECTION_ANSWER, answer.name_buffer, answer.rrtype, answer.rrclass,
+                     answer.rrset, answer.rrttl)) {
+      return false;
+    }
+
+    switch (answer.rrtype) {
+      case MDNS_TYPE_A:  // Returns a 32-bit IPv4 address
+        if (!PopulateData((const byte*)answer.rdata_buffer, 4)) {
+          return AbandonRecord();
+        }
+        break;
+      case MDNS_TYPE_PTR:  // Pointer to a canonical name.
+        if (PopulateName(answer.rdata_buffer) == 0) {
+          return AbandonRecord();
+        }
+        break;
+      case MDNS_TYPE_AAAA:
+        if (!PopulateData(answer.ipv6, 16)) {
+          return AbandonRecord();
+        }
+        break;
+      case MDNS_TYPE_SRV:
+        {
+          const byte fixed[6] = {
+            (byte)(answer.srv.priority >> 8), (byte)answer.srv.priority,
+            (byte)(answer.srv.weight >> 8), (byte)answer.srv.weight,
+            (byte)(answer.srv.port >> 8), (byte)answer.srv.port};
+          if (!PopulateData(fixed, 6) || PopulateName(answer.rdata_buffer) == 0) {
+            return AbandonRecord();
+          }
+        }
+        break;
+      case MDNS_TYPE_TXT:
+        if (!PopulateData(answer.rdata, answer.rdlength)) {
+          return AbandonRecord();
+        }
+        break;
+      default:
+#ifdef DEBUG_OUTPUT
+        MDNS_DEBUG_SERIAL.println(" **ERROR** Use AddRecordHINFO() etc for this record type.");
+#endif
+        return AbandonRecord();
+    }
+
+    return EndRecord(MDNS_SECTION_ANSWER);
+  });
+}
+
+bool MDns::AddAnswer(const char* name, const unsigned int rrtype, const unsigned int rrclass,
+                     const bool rrset, const unsigned long int rrttl,
+                     const byte* rdata, const unsigned int rdlength) {
+  return AddRecord(MDNS_SECTION_ANSWER, name, rrtype, rrclass, rrset, rrttl, rdata, rdlength);
+}
+
+bool MDns::AddRecord(const byte section, const char* name, const unsigned int rrtype,
+                     const unsigned int rrclass, const bool rrset, const unsigned long int rrttl,
+                     const byte* rdata, const unsigned int rdlength) {
+  return AddFlushing([&]() {
+    if (!StartRecord(section, name, rrtype, rrclass, rrset, rrttl)) {
+      return false;
+    }
+
+    if (rrtype == MDNS_TYPE_PTR || rrtype == MDNS_TYPE_SRV) {
+      // Re-write the name so it can share a suffix with the rest of the packet.
+      // SRV has priority, weight and port before the target name.
+      const unsigned int fixed_len = (rrtype == MDNS_TYPE_SRV) ? 6 : 0;
+      char name_buffer[MAX_MDNS_NAME_LEN];
+      if (rdlength <= fixed_len ||
+          nameFromDnsPointer(name_buffer, 0, MAX_MDNS_NAME_LEN, rdata, fixed_len, rdlength) < 0 ||
+          !PopulateData(rdata, fixed_len) || PopulateName(name_buffer) == 0) {
+        return AbandonRecord();
+      }
+    } else if (!PopulateData(rdata, rdlength)) {
+      return AbandonRecord();
+    }
+
+    return EndRecord(section);
+  });
+}
+
+bool MDns::AddRecordA(const byte section, const char* name, const IPAddress& address,
+                      const unsigned long int rrttl, const bool rrset) {
+  return AddFlushing([&]() {
+    if (!StartRecord(section, name, MDNS_TYPE_A, MDNS_CLASS_IN, rrset, rrttl)) {
+      return false;
+    }
+    const byte rdata[4] = {address[0], address[1], address[2], address[3]};
+    if (!PopulateData(rdata, 4)) {
+      return AbandonRecord();
+    }
+    return EndRecord(section);
+  });
+}
+
+bool MDns::AddRecordAAAA(const byte section, const char* name, const byte* address,
+                         const unsigned long int rrttl, const bool rrset) {
+  return AddFlushing([&]() {
+    if (!StartRecord(section, name, MDNS_TYPE_AAAA, MDNS_CLASS_IN, rrset, rrttl)) {
+      return false;
+    }
+    if (!PopulateData(address, 16)) {
+      return AbandonRecord();
+    }
+    return EndRecord(section);
+  });
+}
+
+bool MDns::AddRecordPTR(const byte section, const char* name, const char* target,
+                        const unsigned long int rrttl, const bool rrset) {
+  return AddFlushing([&]() {
+    if (!StartRecord(section, name, MDNS_TYPE_PTR, MDNS_CLASS_IN, rrset, rrttl)) {
+      return false;
+    }
+    if (PopulateName(target) == 0) {
+      return AbandonRecord();
+    }
+    return EndRecord(section);
+  });
+}
+
+bool MDns::AddRecordSRV(const byte section, const char* name, const unsigned int priority,
+                        const unsigned int weight, const unsigned int port, const char* target,
+                        const unsigned long int rrttl, const bool rrset) {
+  return AddFlushing([&]() {
+    if (!StartRecord(section, name, MDNS_TYPE_SRV, MDNS_CLASS_IN, rrset, rrttl)) {
+      return false;
+    }
+    const byte rdata[6] = {(byte)(priority >> 8), (byte)priority, (byte)(weight >> 8), (byte)weight,
+                           (byte)(port >> 8), (byte)port};
+    if (!PopulateData(rdata, 6) || PopulateName(target) == 0) {
+      return AbandonRecord();
+    }
+    return EndRecord(section);
+  });
+}
+
+bool MDns::AddRecordTXT(const byte section, const char* name, const char* const* strings,
+                        const unsigned int string_count, const unsigned long int rrttl,
+                        const bool rrset) {
+  return AddFlushing([&]() {
+    if (!StartRecord(section, name, MDNS_TYPE_TXT, MDNS_CLASS_IN, rrset, rrttl)) {
+      return false;
+    }
+    // An empty TXT record is a single zero length string. (RFC 6763 6.1)
+    if (string_count == 0 && !PopulateString("")) {
+      return AbandonRecord();
+    }
+    for (unsigned int i = 0; i < string_count; i++) {
+      if (!PopulateString(strings[i])) {
+        return AbandonRecord();
+      }
+    }
+    return EndRecord(section);
+  });
+}
+
+bool MDns::AddRecordHINFO(const byte section, const char* name, const char* cpu, const char* os,
+                          const unsigned long int rrttl, const bool rrset) {
+  return AddFlushing([&]() {
+    if (!StartRecord(section, name, MDNS_TYPE_HINFO, MDNS_CLASS_IN, rrset, rrttl)) {
+      return false;
+    }
+    if (!PopulateString(cpu) || !PopulateString(os)) {
+      return AbandonRecord();
+    }
+    return EndRecord(section);
+  });
+}
+
+bool MDns::StartRecord(const byte section, const char* name, const unsigned int rrtype,
+                       const unsigned int rrclass, const bool rrset,
+                       const unsigned long int rrttl) {
+  if ((section == MDNS_SECTION_ANSWER && (ns_count || ar_count)) ||
+      (section == MDNS_SECTION_AUTHORITY && ar_count) ||
+      section == MDNS_SECTION_QUESTION || section > MDNS_SECTION_ADDITIONAL) {
+#ifdef DEBUG_OUTPUT
+    MDNS_DEBUG_SERIAL.println(" ERROR. Records must be added in section order.");
 #endif
     return false;
   }
- 
-  // Buffer increased by length of qname_buffer + a preceding length + zero termination
-  // + 4 bits of mDNS flags.
-  data_size += strlen(query.qname_buffer) +6;
-  
-  // Create DNS name buffer from qname.
-  if(PopulateName(query.qname_buffer) == 0 || buffer_pointer +4 > data_size){
+
+  record_compression_count = compression_count;
+
+  if(PopulateName(name) == 0 || buffer_pointer +10 > max_packet_size){
 #ifdef DEBUG_OUTPUT
-    Serial.println(" ERROR. MDns::AddQuery overran expected buffer space.");
+    MDNS_DEBUG_SERIAL.println(" ERROR. MDns::AddRecord overran buffer.");
 #endif
+    overflowed = overflowed || buffer_pointer +10 > max_packet_size;
+    return AbandonRecord();
+  }
+
+  data_buffer[buffer_pointer++] = (rrtype & 0xFF00) >> 8;
+  data_buffer[buffer_pointer++] = rrtype & 0xFF;
+
+  unsigned int rrclass_flags = rrclass;
+  if (rrset) {
+    rrclass_flags |= 0b1000000000000000;
+  }
+  data_buffer[buffer_pointer++] = (rrclass_flags & 0xFF00) >> 8;
+  data_buffer[buffer_pointer++] = rrclass_flags & 0xFF;
+
+  data_buffer[buffer_pointer++] = (rrttl & 0xFF000000) >> 24;
+  data_buffer[buffer_pointer++] = (rrttl & 0xFF0000) >> 16;
+  data_buffer[buffer_pointer++] = (rrttl & 0xFF00) >> 8;
+  data_buffer[buffer_pointer++] = (rrttl & 0xFF);
+
+  // Resource data length gets filled in by EndRecord().
+  record_rdata_pos = buffer_pointer;
+  buffer_pointer += 2;
+
+  return true;
+}
+
+bool MDns::PopulateData(const byte* data, const unsigned int len) {
+  if (buffer_pointer + len > max_packet_size) {
+    overflowed = true;
+    return false;
+  }
+  memcpy(data_buffer + buffer_pointer, data, len);
+  buffer_pointer += len;
+  return true;
+}
+
+bool MDns::PopulateString(const char* string) {
+  const unsigned int string_len = strlen(string);
+  if (string_len > 255) {
     return false;
   }
-  // The rest of the flags.
-  data_buffer[buffer_pointer++] = (query.qtype & 0xFF00) >> 8;
-  data_buffer[buffer_pointer++] = query.qtype & 0xFF;
-  unsigned int qclass = 0;
-  if (query.unicast_response) {
-    qclass = 0b1000000000000000;
+  if (buffer_pointer + string_len +1 > max_packet_size) {
+    overflowed = true;
+    return false;
   }
-  qclass += query.qclass;
-  data_buffer[buffer_pointer++] = (qclass & 0xFF00) >> 8;
-  data_buffer[buffer_pointer++] = qclass & 0xFF;
+  data_buffer[buffer_pointer++] = string_len;
+  memcpy(data_buffer + buffer_pointer, string, string_len);
+  buffer_pointer += string_len;
+  return true;
+}
+
+bool MDns::EndRecord(const byte section) {
+  const unsigned int rdata_len = buffer_pointer - record_rdata_pos -2;
+  data_buffer[record_rdata_pos] = (rdata_len & 0xFF00) >> 8;
+  data_buffer[record_rdata_pos +1] = rdata_len & 0xFF;
+
   data_size = buffer_pointer;
-  
+
   // Since the data fitted in the buffer, it's ok to update the header.
-  data_buffer[2] = 0;     // 0b00000000 for Query, 0b10000000 for Answer.
-  type = 1;
-  ++query_count;
-  data_buffer[4] = (query_count & 0xFF00) >> 8;
-  data_buffer[5] = query_count & 0xFF;
+  unsigned int* p_count = &answer_count;
+  if (section == MDNS_SECTION_AUTHORITY) {
+    p_count = &ns_count;
+  } else if (section == MDNS_SECTION_ADDITIONAL) {
+    p_count = &ar_count;
+  }
+  (*p_count)++;
+  const unsigned int count_offset = 4 + 2 * section;
+  data_buffer[count_offset] = (*p_count & 0xFF00) >> 8;
+  data_buffer[count_offset +1] = *p_count & 0xFF;
 
   return true;
 }
 
-bool MDns::AddAnswer(const Answer& answer) {
-  if (ns_count || ar_count) {
-#ifdef DEBUG_OUTPUT
-    Serial.println(" ERROR. NS or AR records added before Answer records");
-#endif
-    return false;
-  }
+bool MDns::AbandonRecord() {
+  buffer_pointer = data_size;
+  compression_count = record_compression_count;
+  return false;
+}
 
-  data_size += strlen(answer.name_buffer) +12;
-  
-  // Create DNS name buffer from name.
-  if(PopulateName(answer.name_buffer) == 0 || buffer_pointer +10 > data_size){
-#ifdef DEBUG_OUTPUT
-    Serial.println(" ERROR. MDns::AddAnswer over-ran expected buffer space.");
-#endif
-    return false;
-  }
+void MDns::SetResponse(const bool response) {
+  // QR and AA bits. All mDNS responses are authoritative.
+  data_buffer[2] = response ? 0b10000100 : 0;
+  type = !response;
+}
+
+void MDns::SetId(const uint16_t id) {
+  data_buffer[0] = (id & 0xFF00) >> 8;
+  data_buffer[1] = id & 0xFF;
+}
 
-  data_buffer[buffer_pointer++] = (answer.rrtype & 0xFF00) >> 8;
-  data_buffer[buffer_pointer++] = answer.rrtype & 0xFF;
+IPAddress MDns::localIP() const {
+  return interfaces[packet_interface]->localIP();
+}
 
-  unsigned int rrclass = 0;
-  if (answer.rrset) {
-    rrclass = 0b1000000000000000;
+IPAddress MDns::localIP(const unsigned int interface_index) const {
+  if (interface_index >= interface_count) {
+    return IPAddress(0, 0, 0, 0);
   }
-  rrclass += answer.rrclass;
-  data_buffer[buffer_pointer++] = (rrclass & 0xFF00) >> 8;
-  data_buffer[buffer_pointer++] = rrclass & 0xFF;
+  return interfaces[interface_index]->localIP();
+}
 
-  data_buffer[buffer_pointer++] = (answer.rrttl & 0xFF000000) >> 24;
-  data_buffer[buffer_pointer++] = (answer.rrttl & 0xFF0000) >> 16;
-  data_buffer[buffer_pointer++] = (answer.rrttl & 0xFF00) >> 8;
-  data_buffer[buffer_pointer++] = (answer.rrttl & 0xFF);
+IPAddress MDns::remoteIP() const {
+  return remote_ip;
+}
 
-  const unsigned int rdata_len_p0 = buffer_pointer++;
-  const unsigned int rdata_len_p1 = buffer_pointer++;
-  unsigned int rdata_len = 0;
+bool MDns::remoteIPKnown() const {
+  return !interfaces[packet_interface]->isIPv6();
+}
 
-  switch (answer.rrtype) {
-    case MDNS_TYPE_A:  // Returns a 32-bit IPv4 address
-      if(buffer_pointer +4 >= data_size){ return false; }
-      rdata_len = 4;
-      data_buffer[buffer_pointer++] = answer.rdata_buffer[0];
-      data_buffer[buffer_pointer++] = answer.rdata_buffer[1];
-      data_buffer[buffer_pointer++] = answer.rdata_buffer[2];
-      data_buffer[buffer_pointer++] = answer.rdata_buffer[3];
-      break;
-    case MDNS_TYPE_PTR:  // Pointer to a canonical name.
-      rdata_len = PopulateName(answer.rdata_buffer);
-      if(buffer_pointer >= data_size){ return false; }
-      break;
-    default:
+void MDns::Send() const {
 #ifdef DEBUG_OUTPUT
-      // TODO: Other record types.
-      Serial.println(" **ERROR** Sending this record type not implemented yet.");
+  MDNS_DEBUG_SERIAL.println("Sending UDP multicast packet");
 #endif
-      return false;
+  for (unsigned int i = 0; i < interface_count; i++) {
+    if (send_interface == MDNS_ALL_INTERFACES || (unsigned int)send_interface == i) {
+      if (interfaces[i]->send(data_buffer, data_size)) {
+        MDNS_STAT(stats_.packets_sent++);
+        MDNS_STAT(stats_.bytes_sent += data_size);
+      }
+    }
   }
-
-  data_buffer[rdata_len_p0] = (rdata_len & 0xFF00) >> 8;
-  data_buffer[rdata_len_p1] = rdata_len & 0xFF;
-
-  data_size = buffer_pointer;
-  
-  // Since the data fitted in the buffer, it's ok to update the header.
-  answer_count++;
-  data_buffer[6] = (answer_count & 0xFF00) >> 8;
-  data_buffer[7] = answer_count & 0xFF;
-
-  return true;
 }
 
-void MDns::Send() const {
+bool MDns::Send(const IPAddress& remote_ip_, const uint16_t remote_port_) const {
 #ifdef DEBUG_OUTPUT
-  Serial.println("Sending UDP multicast packet");
+  MDNS_DEBUG_SERIAL.println("Sending UDP unicast packet");
 #endif
-  Udp.begin(MDNS_SOURCE_PORT);
-  Udp.beginPacketMulticast(IPAddress(224, 0, 0, 251), MDNS_TARGET_PORT, WiFi.localIP(), MDNS_TTL);
-  Udp.write(data_buffer, data_size);
-  Udp.endPacket();
+  const unsigned int i = (send_interface == MDNS_ALL_INTERFACES) ? packet_interface : send_interface;
+  if (i >= interface_count) {
+    return false;
+  }
+  if (!interfaces[i]->sendTo(data_buffer, data_size, remote_ip_, remote_port_)) {
+    return false;
+  }
+  MDNS_STAT(stats_.packets_sent++);
+  MDNS_STAT(stats_.bytes_sent += data_size);
+  return true;
 }
 
 void MDns::Display() const {
-  Serial.println();
-  Serial.print("Packet size: ");
-  Serial.print(data_size);
-  Serial.print("  ");
-  Serial.println(data_size, HEX);
-  Serial.print(" TYPE: ");
-  Serial.print(type);
-  Serial.print("      QUERY_COUNT: ");
-  Serial.print(query_count);
-  Serial.print("      ANSWER_COUNT: ");
-  Serial.print(answer_count);
-  Serial.print("      NS_COUNT: ");
-  Serial.print(ns_count);
-  Serial.print("      AR_COUNT: ");
-  Serial.println(ar_count);
+  MDNS_DEBUG_SERIAL.println();
+  MDNS_DEBUG_SERIAL.print("Packet size: ");
+  MDNS_DEBUG_SERIAL.print(data_size);
+  MDNS_DEBUG_SERIAL.print("  ");
+  MDNS_DEBUG_SERIAL.println(data_size, HEX);
+  MDNS_DEBUG_SERIAL.print(" TYPE: ");
+  MDNS_DEBUG_SERIAL.print(type);
+  MDNS_DEBUG_SERIAL.print("      QUERY_COUNT: ");
+  MDNS_DEBUG_SERIAL.print(query_count);
+  MDNS_DEBUG_SERIAL.print("      ANSWER_COUNT: ");
+  MDNS_DEBUG_SERIAL.print(answer_count);
+  MDNS_DEBUG_SERIAL.print("      NS_COUNT: ");
+  MDNS_DEBUG_SERIAL.print(ns_count);
+  MDNS_DEBUG_SERIAL.print("      AR_COUNT: ");
+  MDNS_DEBUG_SERIAL.println(ar_count);
 }
 
 void MDns::Parse_Query(Query& query) {
 #ifdef DEBUG_OUTPUT
   query.buffer_pointer = buffer_pointer;
 #endif
-
-  buffer_pointer = nameFromDnsPointer(query.qname_buffer, 0, MAX_MDNS_NAME_LEN,
-                                      data_buffer, buffer_pointer);
+  // Leave nothing uninitialised for Display() if parsing stops early.
+  query.qtype = 0;
+  query.qclass = 0;
+  query.unicast_response = false;
+
+  const int name_end = nameFromDnsPointer(query.qname_buffer, 0, MAX_MDNS_NAME_LEN,
+                                          data_buffer, buffer_pointer, data_size);
+  if (name_end < 0 || name_end +4 > (int)data_size) {
+    // Name is corrupt or the record runs past the end of the packet.
+#ifdef DEBUG_OUTPUT
+    MDNS_DEBUG_SERIAL.print(" **ERROR name** ");
+    MDNS_DEBUG_SERIAL.println(name_end);
+#endif
+    query.valid = false;
+    return;
+  }
+  buffer_pointer = name_end;
 
   byte qtype_0 = data_buffer[buffer_pointer++];
   byte qtype_1 = data_buffer[buffer_pointer++];
@@ -352,20 +1455,20 @@ void MDns::Parse_Query(Query& query) {
   if (query.qclass != 0xFF && query.qclass != 0x01) {
     // QCLASS is not ANY (0xFF) or INternet (0x01).
 #ifdef DEBUG_OUTPUT
-    Serial.print(" **ERROR QCLASS** ");
-    Serial.println(query.qclass, HEX);
+    MDNS_DEBUG_SERIAL.print(" **ERROR QCLASS** ");
+    MDNS_DEBUG_SERIAL.println(query.qclass, HEX);
 #endif
     query.valid = false;
   }
 
-  if (buffer_pointer >= data_size) {
+  if (buffer_pointer > data_size) {
     // We've over-run the returned data.
     // Something has gone wrong receiving or parsing the data.
 #ifdef DEBUG_OUTPUT
-    Serial.print(" **ERROR size** ");
-    Serial.print(buffer_pointer, HEX);
-    Serial.print(" ");
-    Serial.println(data_size, HEX);
+    MDNS_DEBUG_SERIAL.print(" **ERROR size** ");
+    MDNS_DEBUG_SERIAL.print(buffer_pointer, HEX);
+    MDNS_DEBUG_SERIAL.print(" ");
+    MDNS_DEBUG_SERIAL.println(data_size, HEX);
 #endif
     query.valid = false;
   }
@@ -375,9 +1478,33 @@ void MDns::Parse_Answer(Answer& answer) {
 #ifdef DEBUG_OUTPUT
   answer.buffer_pointer = buffer_pointer;
 #endif
-
-  buffer_pointer = nameFromDnsPointer(answer.name_buffer, 0, MAX_MDNS_NAME_LEN,
-                                      data_buffer, buffer_pointer);
+  // An Answer which fails to parse must not leave FormatRdata() reading
+  // through a stale rdata pointer.
+  answer.rrtype = 0;
+  answer.rrclass = 0;
+  answer.rrttl = 0;
+  answer.rrset = false;
+  answer.rdata = NULL;
+  answer.rdlength = 0;
+  answer.rdata_text = false;
+  answer.rdata_buffer[0] = '\0';
+
+  const int name_end = nameFromDnsPointer(answer.name_buffer, 0, MAX_MDNS_NAME_LEN,
+                                          data_buffer, buffer_pointer, data_size);
+  if (name_end < 0) {
+#ifdef DEBUG_OUTPUT
+    MDNS_DEBUG_SERIAL.print(" **ERROR name** ");
+    MDNS_DEBUG_SERIAL.println(name_end);
+#endif
+    answer.valid = false;
+    return;
+  }
+  buffer_pointer = name_end;
+  if (buffer_pointer +10 > data_size) {
+    // Not enough data left for the fixed length part of the record.
+    answer.valid = false;
+    return;
+  }
 
   answer.rrtype = (data_buffer[buffer_pointer++] << 8);
   answer.rrtype += data_buffer[buffer_pointer++];
@@ -396,128 +1523,354 @@ void MDns::Parse_Answer(Answer& answer) {
     // We've over-run the returned data.
     // Something has gone wrong receiving or parsing the data.
 #ifdef DEBUG_OUTPUT
-    Serial.print(" **ERROR size** ");
-    Serial.print(buffer_pointer, HEX);
-    Serial.print(" ");
-    Serial.println(data_size, HEX);
+    MDNS_DEBUG_SERIAL.print(" **ERROR size** ");
+    MDNS_DEBUG_SERIAL.print(buffer_pointer, HEX);
+    MDNS_DEBUG_SERIAL.print(" ");
+    MDNS_DEBUG_SERIAL.println(data_size, HEX);
 #endif
     answer.valid = false;
     return;
   }
-  PopulateAnswerResult(&answer);
 
-  answer.valid = true;
+  answer.valid = PopulateAnswerResult(&answer);
 }
 
 // Display packet contents in HEX.
 void MDns::DisplayRawPacket() const {
   // display the packet contents in HEX
-  Serial.println("Raw packet");
+  MDNS_DEBUG_SERIAL.println("Raw packet");
   unsigned int i, j;
 
   for (i = 0; i <= data_size; i += 16) {
-    Serial.print("0x");
+    MDNS_DEBUG_SERIAL.print("0x");
     PrintHex(i >> 8); PrintHex(i);
-    Serial.print("   ");
+    MDNS_DEBUG_SERIAL.print("   ");
     for (j = 0; j < 16; j++) {
       if (i + j >= data_size) {
         break;
       }
       if (data_buffer[i + j] > 31 and data_buffer[i + j] < 128) {
-        Serial.print((char)data_buffer[i + j]);
+        MDNS_DEBUG_SERIAL.print((char)data_buffer[i + j]);
       } else {
-        Serial.print(".");
+        MDNS_DEBUG_SERIAL.print(".");
       }
     }
-    Serial.print("    ");
+    MDNS_DEBUG_SERIAL.print("    ");
     for (j = 0; j < 16; j++) {
       if (i + j >= data_size) {
         break;
       }
       PrintHex(data_buffer[i + j]);
-      Serial.print(' ');
+      MDNS_DEBUG_SERIAL.print(' ');
     }
-    Serial.println();
+    MDNS_DEBUG_SERIAL.println();
   }
 }
 
 
-void MDns::PopulateAnswerResult(Answer* answer) {
-  int rdlength = (data_buffer[buffer_pointer++] << 8);
-  rdlength += data_buffer[buffer_pointer++];
+bool MDns::PopulateAnswerResult(Answer* answer) {
+  if (buffer_pointer +2 > data_size) {
+    return false;
+  }
+  const unsigned int rdlength = (data_buffer[buffer_pointer] << 8) + data_buffer[buffer_pointer +1];
+  const unsigned int rdata_start = buffer_pointer +2;
+  if (rdata_start + rdlength > data_size) {
+    return false;
+  }
+  answer->rdata = data_buffer + rdata_start;
+  answer->rdlength = rdlength;
+  answer->rdata_text = false;
+  answer->rdata_buffer[0] = '\0';
+  memset(answer->ipv6, 0, sizeof(answer->ipv6));
 
   switch (answer->rrtype) {
     case MDNS_TYPE_A:  // Returns a 32-bit IPv4 address
-      if (MAX_MDNS_NAME_LEN >= 16) {
-        sprintf(answer->rdata_buffer, "%u.%u.%u.%u",
-                data_buffer[buffer_pointer], data_buffer[buffer_pointer +1],
-                data_buffer[buffer_pointer +2], data_buffer[buffer_pointer +3]);
-      } else {
-        sprintf(answer->rdata_buffer, "ipv4");
+      if (rdlength != 4) {
+        return false;
       }
-      buffer_pointer += 4;
-      break;
-    case MDNS_TYPE_PTR:  // Pointer to a canonical name.
-      buffer_pointer = nameFromDnsPointer(answer->rdata_buffer, 0, MAX_MDNS_NAME_LEN,
-                                          data_buffer, buffer_pointer);
-      break;
-    case MDNS_TYPE_HINFO:  // HINFO. host information
-      buffer_pointer = parseText(answer->rdata_buffer, MAX_MDNS_NAME_LEN, rdlength,
-                                 data_buffer, buffer_pointer);
-      break;
-    case MDNS_TYPE_TXT:  // Originally for arbitrary human-readable text in a DNS record.
-      // We only return the first MAX_MDNS_NAME_LEN bytes of thir record type.
-      buffer_pointer = parseText(answer->rdata_buffer, MAX_MDNS_NAME_LEN, rdlength,
-                                 data_buffer, buffer_pointer);
+      memcpy(&answer->ipv4, answer->rdata, 4);
       break;
     case MDNS_TYPE_AAAA:  // Returns a 128-bit IPv6 address.
-      {
-        int buffer_pos = 0;
-        for (int i = 0; i < rdlength; i++) {
-          if (buffer_pos < MAX_MDNS_NAME_LEN - 3) {
-            sprintf(answer->rdata_buffer + buffer_pos, "%02X:", data_buffer[buffer_pointer++]);
-          } else {
-            buffer_pointer++;
-          }
-          buffer_pos += 3;
-        }
-        answer->rdata_buffer[--buffer_pos] = '\0';  // Remove trailing ':'
+      if (rdlength != 16) {
+        return false;
+      }
+      memcpy(answer->ipv6, answer->rdata, 16);
+      break;
+    case MDNS_TYPE_PTR:  // Pointer to a canonical name.
+      if (nameFromDnsPointer(answer->rdata_buffer, 0, MAX_MDNS_NAME_LEN,
+                             data_buffer, rdata_start, rdata_start + rdlength) < 0) {
+        return false;
       }
       break;
     case MDNS_TYPE_SRV:  // Server Selection.
-      {
-        unsigned int priority = (data_buffer[buffer_pointer++] << 8);
-        priority += data_buffer[buffer_pointer++];
-        unsigned int weight = (data_buffer[buffer_pointer++] << 8);
-        weight += data_buffer[buffer_pointer++];
-        unsigned int port = (data_buffer[buffer_pointer++] << 8);
-        port += data_buffer[buffer_pointer++];
-        sprintf(answer->rdata_buffer, "p=%u;w=%u;port=%u;host=", priority, weight, port);
-
-        buffer_pointer = nameFromDnsPointer(answer->rdata_buffer, strlen(answer->rdata_buffer), 
-            MAX_MDNS_NAME_LEN - strlen(answer->rdata_buffer) -1, data_buffer, buffer_pointer);
+      if (rdlength < 7) {
+        return false;
+      }
+      answer->srv.priority = (answer->rdata[0] << 8) + answer->rdata[1];
+      answer->srv.weight = (answer->rdata[2] << 8) + answer->rdata[3];
+      answer->srv.port = (answer->rdata[4] << 8) + answer->rdata[5];
+      if (nameFromDnsPointer(answer->rdata_buffer, 0, MAX_MDNS_NAME_LEN,
+                             data_buffer, rdata_start +6, rdata_start + rdlength) < 0) {
+        return false;
       }
       break;
+    case MDNS_TYPE_HINFO:  // HINFO. host information
+      parseText(answer->rdata_buffer, MAX_MDNS_NAME_LEN, rdlength, data_buffer, rdata_start);
+      break;
     default:
-      {
-        int buffer_pos = 0;
-        for (int i = 0; i < rdlength; i++) {
-          if (buffer_pos < MAX_MDNS_NAME_LEN - 3) {
-            sprintf(answer->rdata_buffer + buffer_pos, "%02X ", data_buffer[buffer_pointer++]);
-          } else {
-            buffer_pointer++;
-          }
-          buffer_pos += 3;
-        }
-      }
+      // TXT and anything else is left in rdata. eg: answer->txt()
       break;
   }
+
+  buffer_pointer = rdata_start + rdlength;
+
+#if MDNS_RDATA_TEXT
+  if (legacy_rdata_text) {
+    answer->FormatRdata(answer->rdata_buffer, MAX_MDNS_NAME_LEN);
+    answer->rdata_text = true;
+  }
+#endif
+  return true;
 }
 
 MDns::~MDns(){
-  Udp.stop();
+  for (unsigned int i = 0; i < interface_count; i++) {
+    interfaces[i]->stop();
+  }
 };
 
+unsigned int RecordView::rrtype() const {
+  return (packet_[fixed_offset_] << 8) + packet_[fixed_offset_ +1];
+}
+
+unsigned int RecordView::rrclass() const {
+  return ((packet_[fixed_offset_ +2] & 0b01111111) << 8) + packet_[fixed_offset_ +3];
+}
+
+bool RecordView::rrset() const {
+  return packet_[fixed_offset_ +2] & 0b10000000;
+}
+
+unsigned long int RecordView::rrttl() const {
+  if (isQuery()) {
+    return 0;
+  }
+  return ((unsigned long int)packet_[fixed_offset_ +4] << 24) +
+         ((unsigned long int)packet_[fixed_offset_ +5] << 16) +
+         ((unsigned long int)packet_[fixed_offset_ +6] << 8) +
+         packet_[fixed_offset_ +7];
+}
+
+const byte* RecordView::rdata() const {
+  if (isQuery()) {
+    return NULL;
+  }
+  return packet_ + rdata_offset_;
+}
+
+int RecordView::name(char* p_name_buffer, const int name_buffer_len) const {
+  const int name_end = nameFromDnsPointer(p_name_buffer, 0, name_buffer_len,
+                                          packet_, name_offset_, packet_size_);
+  if (name_end < 0) {
+    return name_end;
+  }
+  return strlen(p_name_buffer);
+}
+
+int RecordView::rdataName(char* p_name_buffer, const int name_buffer_len,
+                          const unsigned int rdata_pos) const {
+  if (rdata_pos >= rdlength_) {
+    return MDNS_ERR_NAME_OVERRUN;
+  }
+  // The name must end inside the resource data. Compression pointers only
+  // point backwards so still reach the rest of the packet.
+  const int name_end = nameFromDnsPointer(p_name_buffer, 0, name_buffer_len, packet_,
+                                          rdata_offset_ + rdata_pos, rdata_offset_ + rdlength_);
+  if (name_end < 0) {
+    return name_end;
+  }
+  return strlen(p_name_buffer);
+}
+
+unsigned int RecordView::nameId() const {
+  byte id;
+  uint32_t hash;
+  mdns_->InternName(name_offset_, packet_size_, &id, &hash);
+  return id;
+}
+
+uint32_t RecordView::nameHash() const {
+  byte id;
+  uint32_t hash;
+  mdns_->InternName(name_offset_, packet_size_, &id, &hash);
+  return hash;
+}
+
+unsigned int RecordView::rdataNameId(const unsigned int rdata_pos) const {
+  if (rdata_pos >= rdlength_) {
+    return MDNS_NAME_ID_NONE;
+  }
+  byte id;
+  uint32_t hash;
+  mdns_->InternName(rdata_offset_ + rdata_pos, rdata_offset_ + rdlength_, &id, &hash);
+  return id;
+}
+
+uint32_t RecordView::rdataNameHash(const unsigned int rdata_pos) const {
+  if (rdata_pos >= rdlength_) {
+    return 0;
+  }
+  byte id;
+  uint32_t hash;
+  mdns_->InternName(rdata_offset_ + rdata_pos, rdata_offset_ + rdlength_, &id, &hash);
+  return hash;
+}
+
+bool RecordView::toQuery(Query* p_query) const {
+  if (!isQuery()) {
+    return false;
+  }
+  const unsigned int buffer_pointer = mdns_->buffer_pointer;
+  mdns_->buffer_pointer = name_offset_;
+  mdns_->Parse_Query(*p_query);
+  mdns_->buffer_pointer = buffer_pointer;
+  return p_query->valid;
+}
+
+bool RecordView::toAnswer(Answer* p_answer) const {
+  if (isQuery()) {
+    return false;
+  }
+  const unsigned int buffer_pointer = mdns_->buffer_pointer;
+  mdns_->buffer_pointer = name_offset_;
+  mdns_->Parse_Answer(*p_answer);
+  mdns_->buffer_pointer = buffer_pointer;
+  return p_answer->valid;
+}
+
+// Compare two dotted names. Case insensitive and ignores any trailing '.'.
+bool sameName(const char* name_a, const char* name_b) {
+  while (*name_a != '\0' && tolower(*name_a) == tolower(*name_b)) {
+    name_a++;
+    name_b++;
+  }
+  if (*name_a == '.' && *(name_a +1) == '\0') {
+    name_a++;
+  }
+  if (*name_b == '.' && *(name_b +1) == '\0') {
+    name_b++;
+  }
+  return *name_a == '\0' && *name_b == '\0';
+}
+
+uint32_t nameHash(const char* name) {
+  unsigned int name_len = strlen(name);
+  if (name_len > 0 && name[name_len -1] == '.') {
+    name_len--;
+  }
+  uint32_t hash = 2166136261UL;  // FNV-1a.
+  for (unsigned int i = 0; i < name_len; i++) {
+    hash ^= (byte)tolower(name[i]);
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+uint32_t nameHashFromDnsPointer(const byte* p_packet_buffer, int packet_buffer_pos,
+                                const int packet_buffer_len) {
+  // Same rules for following pointers as nameFromDnsPointer().
+  int pointer_limit = packet_buffer_pos;
+  int pointer_count = 0;
+  bool first_word = true;
+  uint32_t hash = 2166136261UL;  // FNV-1a.
+
+  while (packet_buffer_pos < packet_buffer_len) {
+    const byte word_len = p_packet_buffer[packet_buffer_pos];
+    if (word_len >= 0xC0) {
+      if (packet_buffer_pos +2 > packet_buffer_len) {
+        return 0;
+      }
+      const int pointer = ((word_len & 0x3F) << 8) + p_packet_buffer[packet_buffer_pos +1];
+      if (pointer >= pointer_limit || ++pointer_count > MDNS_MAX_NAME_POINTERS) {
+        return 0;
+      }
+      pointer_limit = pointer;
+      packet_buffer_pos = pointer;
+      continue;
+    }
+    if (word_len > 0x3F || packet_buffer_pos + word_len +1 > packet_buffer_len) {
+      return 0;
+    }
+    if (word_len == 0) {
+      return hash;
+    }
+    if (!first_word) {
+      hash ^= '.';
+      hash *= 16777619UL;
+    }
+    first_word = false;
+    for (int i = 1; i <= word_len; i++) {
+      hash ^= (byte)tolower(p_packet_buffer[packet_buffer_pos + i]);
+      hash *= 16777619UL;
+    }
+    packet_buffer_pos += word_len +1;
+  }
+  return 0;
+}
+
+// Follow any Message Compression pointers at *p_pos. Same rules as
+// nameFromDnsPointer(). Returns false if they are invalid.
+static bool followDnsPointers(const byte* p_packet_buffer, int* p_pos, int* p_pointer_limit,
+                              int* p_pointer_count, const int packet_buffer_len) {
+  while (*p_pos < packet_buffer_len && p_packet_buffer[*p_pos] >= 0xC0) {
+    if (*p_pos +2 > packet_buffer_len) {
+      return false;
+    }
+    const int pointer = ((p_packet_buffer[*p_pos] & 0x3F) << 8) + p_packet_buffer[*p_pos +1];
+    if (pointer >= *p_pointer_limit || ++(*p_pointer_count) > MDNS_MAX_NAME_POINTERS) {
+      return false;
+    }
+    *p_pointer_limit = pointer;
+    *p_pos = pointer;
+  }
+  return *p_pos < packet_buffer_len;
+}
+
+bool sameDnsName(const byte* p_packet_buffer, int pos_a, int pos_b,
+                 const int packet_buffer_len) {
+  int pointer_limit_a = pos_a;
+  int pointer_limit_b = pos_b;
+  int pointer_count_a = 0;
+  int pointer_count_b = 0;
+  while (true) {
+    if (!followDnsPointers(p_packet_buffer, &pos_a, &pointer_limit_a, &pointer_count_a,
+                           packet_buffer_len) ||
+        !followDnsPointers(p_packet_buffer, &pos_b, &pointer_limit_b, &pointer_count_b,
+                           packet_buffer_len)) {
+      return false;
+    }
+    const byte word_len = p_packet_buffer[pos_a];
+    if (word_len > 0x3F || word_len != p_packet_buffer[pos_b] ||
+        pos_a + word_len +1 > packet_buffer_len || pos_b + word_len +1 > packet_buffer_len) {
+      return false;
+    }
+    if (word_len == 0) {
+      return true;
+    }
+    for (int i = 1; i <= word_len; i++) {
+      if (tolower(p_packet_buffer[pos_a + i]) != tolower(p_packet_buffer[pos_b + i])) {
+        return false;
+      }
+    }
+    pos_a += word_len +1;
+    pos_b += word_len +1;
+  }
+}
+
+bool timeBefore(const uint32_t a, const uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
 bool writeToBuffer(const byte value, char* p_name_buffer, int* p_name_buffer_pos,
                    const int name_buffer_len) {
   if (*p_name_buffer_pos < name_buffer_len - 1) {
@@ -536,95 +1889,373 @@ int parseText(char* data_buffer, const int data_buffer_len, const int data_len,
   for (i = 0; i < data_len; i++) {
     writeToBuffer(p_packet_buffer[packet_buffer_pos++], data_buffer, &data_buffer_pos, data_buffer_len);
   }
+  if (data_buffer_pos >= data_buffer_len) {
+    // Text was truncated. writeToBuffer() has already terminated it.
+    data_buffer_pos = data_buffer_len -1;
+  }
   data_buffer[data_buffer_pos] = '\0';
   return packet_buffer_pos;
 }
 
 int nameFromDnsPointer(char* p_name_buffer, int name_buffer_pos, const int name_buffer_len,
                        const byte* p_packet_buffer, int packet_buffer_pos) {
+  // The real packet length is not known here. Pointers are still bounds
+  // checked as they may only point backwards.
   return nameFromDnsPointer(p_name_buffer, name_buffer_pos, name_buffer_len,
-                            p_packet_buffer, packet_buffer_pos, false);
+                            p_packet_buffer, packet_buffer_pos, 0xFFFF);
 }
 
 int nameFromDnsPointer(char* p_name_buffer, int name_buffer_pos, const int name_buffer_len,
-                       const byte* p_packet_buffer, int packet_buffer_pos, const bool recurse){
-  if (recurse) {
-    // Since we are adding more to an already populated buffer,
-    // replace the trailing EOL with the FQDN seperator.
-    name_buffer_pos--;
-    writeToBuffer('.', p_name_buffer, &name_buffer_pos, name_buffer_len);
+                       const byte* p_packet_buffer, int packet_buffer_pos,
+                       const int packet_buffer_len) {
+  // Position of the first byte after the name in the record it started in.
+  // Set by the first pointer followed or by the end of the name.
+  int name_end = -1;
+
+  // Message Compression pointers may only point to an earlier part of the
+  // packet, and each one must point earlier than the last, so a corrupt
+  // packet can never make us loop.
+  int pointer_limit = packet_buffer_pos;
+  int pointer_count = 0;
+
+  bool first_word = true;
+  if (name_buffer_pos < name_buffer_len) {
+    p_name_buffer[name_buffer_pos] = '\0';
   }
 
-  if (p_packet_buffer[packet_buffer_pos] < 0xC0) {
-    // Since the first 2 bits are not set,
-    // this is the start of a name section.
-    // http://www.tcpipguide.com/free/t_DNSNameNotationandMessageCompressionTechnique.htm
+  while (true) {
+    if (packet_buffer_pos >= packet_buffer_len) {
+      return MDNS_ERR_NAME_OVERRUN;
+    }
+    const byte word_len = p_packet_buffer[packet_buffer_pos];
+
+    if (word_len >= 0xC0) {
+      // Message Compression used. Next 2 bytes are a pointer to the actual name section.
+      // http://www.tcpipguide.com/free/t_DNSNameNotationandMessageCompressionTechnique.htm
+      if (packet_buffer_pos +2 > packet_buffer_len) {
+        return MDNS_ERR_NAME_OVERRUN;
+      }
+      const int pointer = ((word_len & 0x3F) << 8) + p_packet_buffer[packet_buffer_pos +1];
+      if (pointer >= pointer_limit) {
+        return MDNS_ERR_NAME_POINTER;
+      }
+      if (++pointer_count > MDNS_MAX_NAME_POINTERS) {
+        return MDNS_ERR_NAME_HOPS;
+      }
+      if (name_end < 0) {
+        name_end = packet_buffer_pos +2;
+      }
+      pointer_limit = pointer;
+      packet_buffer_pos = pointer;
+      continue;
+    }
+
+    if (word_len > 0x3F) {
+      // 0x40 and 0x80 label types are reserved.
+      return MDNS_ERR_NAME_LABEL;
+    }
+
+    if (word_len == 0) {
+      // End of name.
+      if (name_end < 0) {
+        name_end = packet_buffer_pos +1;
+      }
+      return name_end;
+    }
 
-    const int word_len = p_packet_buffer[packet_buffer_pos++];
+    if (packet_buffer_pos + word_len +1 > packet_buffer_len) {
+      return MDNS_ERR_NAME_OVERRUN;
+    }
+    if (!first_word) {
+      writeToBuffer('.', p_name_buffer, &name_buffer_pos, name_buffer_len);
+    }
+    first_word = false;
+    packet_buffer_pos++;
     for (int l = 0; l < word_len; l++) {
-      writeToBuffer(*(p_packet_buffer + packet_buffer_pos++), p_name_buffer,
+      writeToBuffer(p_packet_buffer[packet_buffer_pos++], p_name_buffer,
                     &name_buffer_pos, name_buffer_len);
     }
+  }
+}
+
+int skipDnsName(const byte* p_packet_buffer, int packet_buffer_pos, const int packet_buffer_len) {
+  while (packet_buffer_pos < packet_buffer_len) {
+    const byte word_len = p_packet_buffer[packet_buffer_pos];
+    if (word_len == 0) {
+      // End of name.
+      return packet_buffer_pos +1;
+    }
+    if (word_len >= 0xC0) {
+      // Message Compression pointer always ends the name.
+      if (packet_buffer_pos +2 > packet_buffer_len) {
+        return MDNS_ERR_NAME_OVERRUN;
+      }
+      return packet_buffer_pos +2;
+    }
+    if (word_len > 0x3F) {
+      // Reserved label types.
+      return MDNS_ERR_NAME_LABEL;
+    }
+    packet_buffer_pos += word_len +1;
+  }
+  return MDNS_ERR_NAME_OVERRUN;
+}
 
-    writeToBuffer('\0', p_name_buffer, &name_buffer_pos, name_buffer_len);
+int expandDnsName(byte* p_out_buffer, const int out_buffer_len,
+                  const byte* p_packet_buffer, int packet_buffer_pos, const int packet_buffer_len) {
+  // Same rules for following pointers as nameFromDnsPointer().
+  int pointer_limit = packet_buffer_pos;
+  int pointer_count = 0;
+  int out_pos = 0;
 
-    if (p_packet_buffer[packet_buffer_pos] > 0) {
-      // Next word.
-      packet_buffer_pos = nameFromDnsPointer(p_name_buffer, name_buffer_pos,
-                                             name_buffer_len, p_packet_buffer,
-                                             packet_buffer_pos, true);
-    } else {
-      // End of string.
-      packet_buffer_pos++;
+  while (true) {
+    if (packet_buffer_pos >= packet_buffer_len) {
+      return MDNS_ERR_NAME_OVERRUN;
+    }
+    const byte word_len = p_packet_buffer[packet_buffer_pos];
+
+    if (word_len >= 0xC0) {
+      if (packet_buffer_pos +2 > packet_buffer_len) {
+        return MDNS_ERR_NAME_OVERRUN;
+      }
+      const int pointer = ((word_len & 0x3F) << 8) + p_packet_buffer[packet_buffer_pos +1];
+      if (pointer >= pointer_limit) {
+        return MDNS_ERR_NAME_POINTER;
+      }
+      if (++pointer_count > MDNS_MAX_NAME_POINTERS) {
+        return MDNS_ERR_NAME_HOPS;
+      }
+      pointer_limit = pointer;
+      packet_buffer_pos = pointer;
+      continue;
+    }
+
+    if (word_len > 0x3F) {
+      return MDNS_ERR_NAME_LABEL;
+    }
+    if (packet_buffer_pos + word_len +1 > packet_buffer_len) {
+      return MDNS_ERR_NAME_OVERRUN;
+    }
+    if (out_pos + word_len +1 > out_buffer_len) {
+      return MDNS_ERR_NAME_SPACE;
+    }
+    memcpy(p_out_buffer + out_pos, p_packet_buffer + packet_buffer_pos, word_len +1);
+    out_pos += word_len +1;
+    packet_buffer_pos += word_len +1;
+
+    if (word_len == 0) {
+      // End of name.
+      return out_pos;
     }
-  } else {
-    // Message Compression used. Next 2 bytes are a pointer to the actual name section.
-    int pointer = (p_packet_buffer[packet_buffer_pos++] - 0xC0) << 8;
-    pointer += p_packet_buffer[packet_buffer_pos++];
-    nameFromDnsPointer(p_name_buffer, name_buffer_pos, name_buffer_len,
-                       p_packet_buffer, pointer, false);
   }
-  return packet_buffer_pos;
+}
+
+unsigned int TxtRecord::count() const {
+  unsigned int string_count = 0;
+  for (unsigned int pos = 0; pos < rdlength; pos += rdata[pos] +1) {
+    if (rdata[pos] > 0) {
+      // Empty strings are allowed but carry no information.
+      string_count++;
+    }
+  }
+  return string_count;
+}
+
+int TxtRecord::Locate(const unsigned int index) const {
+  unsigned int string_count = 0;
+  for (unsigned int pos = 0; pos < rdlength; pos += rdata[pos] +1) {
+    if (rdata[pos] > 0 && string_count++ == index) {
+      return pos;
+    }
+  }
+  return -1;
+}
+
+int TxtRecord::LocateKey(const char* key) const {
+  const unsigned int key_len = strlen(key);
+  for (unsigned int pos = 0; pos < rdlength; pos += rdata[pos] +1) {
+    unsigned int string_len = rdata[pos];
+    if (pos + string_len +1 > rdlength) {
+      string_len = rdlength - pos -1;
+    }
+    if (string_len < key_len || (string_len > key_len && rdata[pos +1 + key_len] != '=')) {
+      continue;
+    }
+    unsigned int i = 0;
+    while (i < key_len && tolower(rdata[pos +1 +i]) == tolower(key[i])) {
+      i++;
+    }
+    if (i == key_len) {
+      return pos;
+    }
+  }
+  return -1;
+}
+
+int TxtRecord::Copy(const int pos, const bool want_value, char* buffer, const int buffer_len) const {
+  unsigned int string_end = pos + rdata[pos] +1;
+  if (string_end > rdlength) {
+    // Truncated record.
+    string_end = rdlength;
+  }
+  unsigned int start = pos +1;
+  unsigned int equals = start;
+  while (equals < string_end && rdata[equals] != '=') {
+    equals++;
+  }
+  unsigned int end = equals;
+  if (want_value) {
+    start = (equals < string_end) ? equals +1 : string_end;
+    end = string_end;
+  }
+  int buffer_pos = 0;
+  for (unsigned int i = start; i < end; i++) {
+    writeToBuffer(rdata[i], buffer, &buffer_pos, buffer_len);
+  }
+  if (buffer_pos >= buffer_len) {
+    buffer_pos = buffer_len -1;
+  }
+  buffer[buffer_pos] = '\0';
+  return buffer_pos;
+}
+
+bool TxtRecord::item(const unsigned int index, char* key_buffer, const int key_buffer_len,
+                     char* value_buffer, const int value_buffer_len) const {
+  const int pos = Locate(index);
+  if (pos < 0) {
+    return false;
+  }
+  Copy(pos, false, key_buffer, key_buffer_len);
+  Copy(pos, true, value_buffer, value_buffer_len);
+  return true;
+}
+
+int TxtRecord::get(const char* key, char* value_buffer, const int value_buffer_len) const {
+  const int pos = LocateKey(key);
+  if (pos < 0) {
+    return -1;
+  }
+  return Copy(pos, true, value_buffer, value_buffer_len);
+}
+
+bool TxtRecord::has(const char* key) const {
+  return LocateKey(key) >= 0;
 }
 
 void Query::Display() const {
 #ifdef DEBUG_OUTPUT
-  Serial.print("question  0x");
-  Serial.println(buffer_pointer, HEX);
+  MDNS_DEBUG_SERIAL.print("question  0x");
+  MDNS_DEBUG_SERIAL.println(buffer_pointer, HEX);
 #endif
   if (!valid) {
-    Serial.println(" **ERROR**");
+    MDNS_DEBUG_SERIAL.println(" **ERROR**");
+  }
+  MDNS_DEBUG_SERIAL.print(" QNAME:    ");
+  MDNS_DEBUG_SERIAL.println(qname_buffer);
+  MDNS_DEBUG_SERIAL.print(" QTYPE:  0x");
+  MDNS_DEBUG_SERIAL.print(qtype, HEX);
+  MDNS_DEBUG_SERIAL.print("      QCLASS: 0x");
+  MDNS_DEBUG_SERIAL.print(qclass, HEX);
+  MDNS_DEBUG_SERIAL.print("      Unicast Response: ");
+  MDNS_DEBUG_SERIAL.println(unicast_response);
+}
+
+int Answer::FormatRdata(char* p_text_buffer, const int text_buffer_len) const {
+  if (text_buffer_len <= 0) {
+    return 0;
+  }
+  int text_len = 0;
+  if (rdata_text) {
+    text_len = snprintf(p_text_buffer, text_buffer_len, "%s", rdata_buffer);
+  } else {
+    switch (rrtype) {
+      case MDNS_TYPE_A:
+        {
+          const byte* address = (const byte*)&ipv4;
+          text_len = snprintf(p_text_buffer, text_buffer_len, "%u.%u.%u.%u",
+                              address[0], address[1], address[2], address[3]);
+        }
+        break;
+      case MDNS_TYPE_PTR:
+      case MDNS_TYPE_HINFO:
+        if (p_text_buffer != rdata_buffer) {
+          text_len = snprintf(p_text_buffer, text_buffer_len, "%s", rdata_buffer);
+        } else {
+          text_len = strlen(rdata_buffer);
+        }
+        break;
+      case MDNS_TYPE_SRV:
+        {
+          // p_text_buffer may be rdata_buffer so make room for the prefix by
+          // moving the host name along.
+          char prefix[40];
+          const int prefix_len = snprintf(prefix, sizeof(prefix), "p=%u;w=%u;port=%u;host=",
+                                          srv.priority, srv.weight, srv.port);
+          if (prefix_len >= text_buffer_len) {
+            p_text_buffer[0] = '\0';
+            return 0;
+          }
+          int host_len = strlen(rdata_buffer);
+          if (prefix_len + host_len >= text_buffer_len) {
+            host_len = text_buffer_len - prefix_len -1;
+          }
+          memmove(p_text_buffer + prefix_len, rdata_buffer, host_len);
+          memcpy(p_text_buffer, prefix, prefix_len);
+          text_len = prefix_len + host_len;
+          p_text_buffer[text_len] = '\0';
+        }
+        break;
+      case MDNS_TYPE_TXT:
+        parseText(p_text_buffer, text_buffer_len, rdlength, rdata, 0);
+        text_len = strlen(p_text_buffer);
+        break;
+      default:
+        {
+          // AAAA as "FE:80:00:..." and anything else as "01 02 03 ...".
+          const byte* data = (rrtype == MDNS_TYPE_AAAA) ? ipv6 : rdata;
+          const unsigned int data_len = (rrtype == MDNS_TYPE_AAAA) ? 16 : rdlength;
+          const char separator = (rrtype == MDNS_TYPE_AAAA) ? ':' : ' ';
+          p_text_buffer[0] = '\0';
+          for (unsigned int i = 0; i < data_len && text_len + 3 < text_buffer_len; i++) {
+            text_len += snprintf(p_text_buffer + text_len, text_buffer_len - text_len, "%02X%c",
+                                 data[i], separator);
+          }
+          if (rrtype == MDNS_TYPE_AAAA && text_len > 0) {
+            // Remove trailing ':'
+            p_text_buffer[--text_len] = '\0';
+          }
+        }
+        break;
+    }
   }
-  Serial.print(" QNAME:    ");
-  Serial.println(qname_buffer);
-  Serial.print(" QTYPE:  0x");
-  Serial.print(qtype, HEX);
-  Serial.print("      QCLASS: 0x");
-  Serial.print(qclass, HEX);
-  Serial.print("      Unicast Response: ");
-  Serial.println(unicast_response);
+  if (text_len >= text_buffer_len) {
+    text_len = text_buffer_len -1;
+  }
+  return text_len;
 }
 
 void Answer::Display() const {
 #ifdef DEBUG_OUTPUT
-  Serial.print("answer  0x");
-  Serial.println(buffer_pointer, HEX);
+  MDNS_DEBUG_SERIAL.print("answer  0x");
+  MDNS_DEBUG_SERIAL.println(buffer_pointer, HEX);
 #endif
   if (!valid) {
-    Serial.println(" **ERROR**");
-  }
-  Serial.print(" RRNAME:    ");
-  Serial.println(name_buffer);
-  Serial.print(" RRTYPE:  0x");
-  Serial.print(rrtype, HEX);
-  Serial.print("      RRCLASS: 0x");
-  Serial.print(rrclass, HEX);
-  Serial.print("      RRTTL: ");
-  Serial.print(rrttl);
-  Serial.print("      RRSET: ");
-  Serial.println(rrset);
-  Serial.print(" RRDATA:    ");
-  Serial.println(rdata_buffer);
+    MDNS_DEBUG_SERIAL.println(" **ERROR**");
+  }
+  MDNS_DEBUG_SERIAL.print(" RRNAME:    ");
+  MDNS_DEBUG_SERIAL.println(name_buffer);
+  MDNS_DEBUG_SERIAL.print(" RRTYPE:  0x");
+  MDNS_DEBUG_SERIAL.print(rrtype, HEX);
+  MDNS_DEBUG_SERIAL.print("      RRCLASS: 0x");
+  MDNS_DEBUG_SERIAL.print(rrclass, HEX);
+  MDNS_DEBUG_SERIAL.print("      RRTTL: ");
+  MDNS_DEBUG_SERIAL.print(rrttl);
+  MDNS_DEBUG_SERIAL.print("      RRSET: ");
+  MDNS_DEBUG_SERIAL.println(rrset);
+  MDNS_DEBUG_SERIAL.print(" RRDATA:    ");
+  char text_buffer[MAX_MDNS_NAME_LEN];
+  FormatRdata(text_buffer, MAX_MDNS_NAME_LEN);
+  MDNS_DEBUG_SERIAL.println(text_buffer);
 }
 
 } // namespace mdns
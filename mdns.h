@@ -2,13 +2,11 @@
 #define MDNS_H
 
 #include <Arduino.h>
+#include <functional>
+#ifdef ESP8266
 #include <ESP8266WiFi.h>
-#include <WiFiUdp.h>
-
-#define DEBUG_STATISTICS      // Record how many incoming packets fitted into data_buffer.
-//#define DEBUG_OUTPUT          // Send packet summaries to Serial.
-//#define DEBUG_RAW             // Send HEX ans ASCII encoded raw packet to Serial.
-
+#endif
+#include "mdns_config.h"
 
 #define MDNS_TYPE_A     0x0001
 #define MDNS_TYPE_PTR   0x000C
@@ -16,18 +14,48 @@
 #define MDNS_TYPE_TXT   0x0010
 #define MDNS_TYPE_AAAA  0x001C
 #define MDNS_TYPE_SRV   0x0021
+#define MDNS_TYPE_ANY   0x00FF
+
+#define MDNS_CLASS_IN   0x0001
+#define MDNS_CLASS_ANY  0x00FF
+
+// Section of the packet a record was found in.
+#define MDNS_SECTION_QUESTION   0
+#define MDNS_SECTION_ANSWER     1
+#define MDNS_SECTION_AUTHORITY  2
+#define MDNS_SECTION_ADDITIONAL 3
+
+// Pass to MDns::SetInterface() to send on every interface.
+#define MDNS_ALL_INTERFACES -1
 
 #define MDNS_TARGET_PORT 5353
 #define MDNS_SOURCE_PORT 5353
 #define MDNS_TTL 255
 
-// Make this as big as memory limitations allow.
-// This default value can be overridden using the max_packet_size_ parameter of
-// MDns().
-#define MAX_PACKET_SIZE 1024
+// Most Message Compression pointers followed while decoding a single name.
+#define MDNS_MAX_NAME_POINTERS 16
 
-// The mDNS spec says this should never be more than 256 (including trailing '\0').
-#define MAX_MDNS_NAME_LEN 256  
+// Errors returned by nameFromDnsPointer() and skipDnsName().
+#define MDNS_ERR_NAME_OVERRUN -1  // Name runs past the end of the packet.
+#define MDNS_ERR_NAME_POINTER -2  // Compression pointer does not point to an earlier name.
+#define MDNS_ERR_NAME_HOPS    -3  // More than MDNS_MAX_NAME_POINTERS compression pointers.
+#define MDNS_ERR_NAME_LABEL   -4  // Reserved label type.
+#define MDNS_ERR_NAME_SPACE   -5  // Output buffer too small.
+
+// RecordView::nameId() of a name which is corrupt or did not fit in the name
+// table.
+#define MDNS_NAME_ID_NONE 0xFF
+#if MDNS_NAME_TABLE_SIZE > 254
+#error "MDNS_NAME_TABLE_SIZE too large. Name ids are stored in a byte."
+#endif
+
+// How long a Question seen from another host counts as recent. (milliseconds)
+#define MDNS_QUESTION_SUPPRESS_TIME 1000
+
+// How long to wait for the rest of the Known-Answers after a Query with the
+// TC bit set. (RFC 6762 7.2) (milliseconds)
+#define MDNS_TRUNCATED_WAIT_MIN 400
+#define MDNS_TRUNCATED_WAIT_MAX 500
 
 namespace mdns{
 
@@ -45,22 +73,290 @@ typedef struct Query{
   void Display() const;                   // Display a summary of this Answer on Serial port.
 } Query;
 
+// Read only view of the "key=value" strings in the resource data of a TXT
+// record. (RFC 6763 section 6)
+// Nothing is copied so the resource data must outlive the TxtRecord.
+class TxtRecord {
+ public:
+  // Args:
+  //   rdata_ : Resource data of the TXT record.
+  //   rdlength_ : Length of rdata_.
+  TxtRecord(const byte* rdata_, const unsigned int rdlength_) :
+    rdata(rdata_),
+    rdlength(rdlength_)
+    { }
+
+  // Number of strings in the record.
+  unsigned int count() const;
+
+  // Copy the key and value of the string at index into key_buffer and
+  // value_buffer. The value is empty if the string has no '='.
+  // Returns false if there is no string at index.
+  bool item(const unsigned int index, char* key_buffer, const int key_buffer_len,
+            char* value_buffer, const int value_buffer_len) const;
+
+  // Copy the value for key into value_buffer. Keys are case insensitive.
+  // Returns the length of the value or -1 if key is not present.
+  int get(const char* key, char* value_buffer, const int value_buffer_len) const;
+
+  // True if key is present, with or without a value.
+  bool has(const char* key) const;
+
+ private:
+  // Find the string at index. Returns its position in rdata or -1.
+  int Locate(const unsigned int index) const;
+
+  // Find the string with key. Returns its position in rdata or -1.
+  int LocateKey(const char* key) const;
+
+  // Copy part of the string at pos into buffer. Returns the length copied.
+  int Copy(const int pos, const bool want_value, char* buffer, const int buffer_len) const;
+
+  const byte* rdata;
+  unsigned int rdlength;
+};
+
+// Decoded resource data of a SRV record.
+typedef struct SrvData {
+  uint16_t priority;
+  uint16_t weight;
+  uint16_t port;
+} SrvData;
+
 // A single mDNS Answer.
 typedef struct Answer{
 #ifdef DEBUG_OUTPUT
   unsigned int buffer_pointer;          // Position of Answer in packet. (Used for debugging only.)
 #endif
   char name_buffer[MAX_MDNS_NAME_LEN];  // object, domain or zone name.
-  char rdata_buffer[MAX_MDNS_NAME_LEN]; // The data portion of the resource record.
+  // The data portion of the resource record. If rdata_text is set this is a
+  // text rendering of it. Otherwise it holds the target name of PTR and SRV
+  // records, the strings of HINFO records and is empty for other types.
+  char rdata_buffer[MAX_MDNS_NAME_LEN];
   unsigned int rrtype;                  // ResourceRecord Type.
   unsigned int rrclass;                 // ResourceRecord Class: Normally the value 1 for Internet (“IN”)
   unsigned long int rrttl;              // ResourceRecord Time To Live: Number of seconds ths should be remembered.
   bool rrset;                           // Flush cache of records matching this name.
   bool valid;                           // False if problems were encountered decoding packet.
+  bool rdata_text;                      // rdata_buffer holds text. See MDns::setLegacyRdataText().
+
+  // Raw resource data. Points into the packet so is only valid until the next
+  // packet arrives.
+  const byte* rdata;
+  unsigned int rdlength;
+
+  // Decoded resource data, depending on rrtype.
+  union {
+    uint32_t ipv4;                      // MDNS_TYPE_A. eg: IPAddress(answer->ipv4)
+    byte ipv6[16];                      // MDNS_TYPE_AAAA. Network byte order.
+    SrvData srv;                        // MDNS_TYPE_SRV. Target host name is in rdata_buffer.
+  };
+
+  // "key=value" strings of a TXT record. Only valid while rdata is.
+  TxtRecord txt() const { return TxtRecord(rdata, rdlength); }
+
+  // Render the resource data as text in the format rdata_buffer has when
+  // rdata_text is set. Returns the length of the text.
+  int FormatRdata(char* p_text_buffer, const int text_buffer_len) const;
 
   void Display() const ;                // Display a summary of this Answer on Serial port.
 } Answer;
 
+// A Query or Answer decoded into the buffer passed to MDns::setRecordArena().
+// Strings and resource data are stored at their exact lengths so memory used
+// grows with the content of a packet rather than with its number of records.
+// Everything points into the arena so is only valid during the callback.
+typedef struct Record {
+  const char* name;           // Dotted name. eg: "_http._tcp.local"
+  const byte* rdata;          // Resource data as received. Names in it may be compressed. NULL for a Query.
+  const char* target;         // Dotted target name of PTR and SRV records, otherwise NULL.
+  uint32_t rrttl;             // 0 for a Query.
+  uint16_t rrtype;
+  uint16_t rrclass;           // Top bit masked off.
+  uint16_t rdlength;
+  byte section;               // One of MDNS_SECTION_*.
+  bool rrset;                 // "unicast response" for a Query, "flush cache" for an Answer.
+  byte name_id;               // RecordView::nameId() of name.
+  byte target_id;             // RecordView::rdataNameId() of target. MDNS_NAME_ID_NONE if no target.
+
+  // "key=value" strings of a TXT record.
+  TxtRecord txt() const { return TxtRecord(rdata, rdlength); }
+} Record;
+
+// Buckets in Stats::parse_micros. Bucket i counts packets which took less
+// than MDNS_STATS_PARSE_BUCKET_MICROS << i microseconds to process. The last
+// bucket counts the rest.
+#define MDNS_STATS_PARSE_BUCKETS 8
+#define MDNS_STATS_PARSE_BUCKET_MICROS 32
+
+// Counters returned by MDns::GetStats(). Only updated when DEBUG_STATISTICS is
+// defined. Otherwise they stay 0 and none of the counting code is compiled in.
+typedef struct Stats {
+  // Incoming packets.
+  uint32_t packets_received;
+  uint32_t bytes_received;
+  uint32_t packets_oversize;      // Did not fit in data_buffer. The end was lost.
+  uint32_t largest_packet;        // Bytes. Useful for choosing max_packet_size.
+
+  // Records in incoming packets by rrtype. Questions and Answers both count.
+  uint32_t records_a;
+  uint32_t records_aaaa;
+  uint32_t records_ptr;
+  uint32_t records_srv;
+  uint32_t records_txt;
+  uint32_t records_other;
+
+  // Incoming packets or records which could not be parsed, by reason.
+  uint32_t fail_header;           // Non zero response code.
+  uint32_t fail_name;             // Corrupt name or compression pointer.
+  uint32_t fail_overrun;          // Record runs past the end of the packet.
+  uint32_t fail_rdata;            // Resource data does not suit the rrtype.
+
+  // Outgoing packets the Transport accepted.
+  uint32_t packets_sent;
+  uint32_t bytes_sent;
+
+  // Responder and ResponseScheduler: response packets sent and answers not
+  // sent because the asker or another host already had them, or they were
+  // sent less than a second ago.
+  uint32_t responses_sent;
+  uint32_t responses_suppressed;
+
+  // RecordCache lookups. Filled in by RecordCache::AddStats().
+  uint32_t cache_hits;
+  uint32_t cache_misses;
+
+  // Time taken to process each incoming packet. See MDNS_STATS_PARSE_BUCKETS.
+  uint32_t parse_micros[MDNS_STATS_PARSE_BUCKETS];
+} Stats;
+
+// Wraps statements which update Stats so they compile to nothing unless
+// DEBUG_STATISTICS is defined.
+#ifdef DEBUG_STATISTICS
+#define MDNS_STAT(statement) statement
+#else
+#define MDNS_STAT(statement)
+#endif
+
+class MDns;
+class Transport;
+
+// A lightweight view of a single Query or Answer inside the packet currently
+// being processed by MDns::loop().
+// Nothing is copied out of the packet or decoded until one of the accessors is
+// called so uninteresting records can be discarded very cheaply.
+// A RecordView is only valid for the duration of the callback it was passed to.
+class RecordView {
+ public:
+  // Section of the packet this record was found in. One of MDNS_SECTION_*.
+  byte section() const { return section_; }
+
+  // True if this record is a Query rather than an Answer.
+  bool isQuery() const { return section_ == MDNS_SECTION_QUESTION; }
+
+  // ResourceRecord Type or Question Type.
+  unsigned int rrtype() const;
+
+  // ResourceRecord Class or Question Class with the top bit masked off.
+  unsigned int rrclass() const;
+
+  // Top bit of the Class field.
+  // For a Query this is the "unicast response" bit.
+  // For an Answer this is the "flush cache" bit.
+  bool rrset() const;
+
+  // ResourceRecord Time To Live. Always 0 for a Query.
+  unsigned long int rrttl() const;
+
+  // Length of the raw resource data. Always 0 for a Query.
+  unsigned int rdlength() const { return rdlength_; }
+
+  // Pointer to the raw resource data inside the packet. NULL for a Query.
+  const byte* rdata() const;
+
+  // Position of the start of the record's name inside the packet.
+  unsigned int nameOffset() const { return name_offset_; }
+
+  // Position of the start of the resource data inside the packet.
+  unsigned int rdataOffset() const { return rdata_offset_; }
+
+  // The whole packet this record is part of.
+  const byte* packet() const { return packet_; }
+  unsigned int packetSize() const { return packet_size_; }
+
+  // Decode the record's name into p_name_buffer.
+  // Returns the length of the decoded name or a negative MDNS_ERR_NAME_* error.
+  int name(char* p_name_buffer, const int name_buffer_len) const;
+
+  // Decode a name stored in the resource data. eg: The target of a PTR record
+  // (rdata_pos = 0) or of a SRV record (rdata_pos = 6).
+  // Returns the length of the decoded name or a negative MDNS_ERR_NAME_* error.
+  int rdataName(char* p_name_buffer, const int name_buffer_len,
+                const unsigned int rdata_pos = 0) const;
+
+  // Id of the record's name within the packet. Names which are the same,
+  // ignoring case, get the same id wherever they appear in the packet so can
+  // be compared without decoding them. The packets of a Query held by
+  // MDns::setReassemblyBuffer() don't reuse each other's ids, though the same
+  // name gets a new id in each. MDNS_NAME_ID_NONE if the name is corrupt or
+  // the packet has more than MDNS_NAME_TABLE_SIZE different names.
+  unsigned int nameId() const;
+
+  // mdns::nameHash() of the record's name. 0 if it is corrupt.
+  uint32_t nameHash() const;
+
+  // The same for a name stored in the resource data. See rdataName().
+  unsigned int rdataNameId(const unsigned int rdata_pos = 0) const;
+  uint32_t rdataNameHash(const unsigned int rdata_pos = 0) const;
+
+  // Fully decode this record into a Query. Returns false if this is not a Query.
+  bool toQuery(Query* p_query) const;
+
+  // Fully decode this record into an Answer. Returns false if this is not an Answer.
+  bool toAnswer(Answer* p_answer) const;
+
+ private:
+  friend class MDns;
+
+  MDns* mdns_;
+  const byte* packet_;
+  unsigned int packet_size_;
+  byte section_;
+  unsigned int name_offset_;     // First byte of the record's name.
+  unsigned int fixed_offset_;    // First byte after the name. (Type, class, etc.)
+  unsigned int rdata_offset_;    // First byte of the resource data.
+  unsigned int rdlength_;
+};
+
+// An interest registered with MDns::Subscribe().
+typedef struct Subscription {
+  uint32_t suffix_hash;       // Hash of the last label_count labels of the name.
+  unsigned int label_count;
+  unsigned int rrtype;        // MDNS_TYPE_ANY for all types.
+} Subscription;
+
+// Interface for components which are built on top of MDns. eg: RecordCache.
+// Unlike the callbacks, any number of Listeners (up to MDNS_MAX_LISTENERS) may
+// be attached to one MDns with MDns::addListener().
+class Listener {
+ public:
+  virtual ~Listener() {}
+
+  // Called for every incoming packet before any of its records.
+  virtual void onPacket(MDns* mdns) {}
+
+  // Called for every Query and Answer in the incoming packet.
+  virtual void onRecord(MDns* mdns, const RecordView* view) {}
+
+  // Called after the last record of every incoming packet.
+  virtual void onPacketEnd(MDns* mdns) {}
+
+  // Called on every MDns::loop() whether a packet arrived or not.
+  // The incoming packet has been fully processed by now so this is where
+  // a Listener may build and Send() packets of its own.
+  virtual void poll(MDns* mdns) {}
+};
+
 class MDns {
  private:
  public:
@@ -93,20 +389,8 @@ class MDns {
        std::function<void(const Query*)> p_query_function, 
        std::function<void(const Answer*)> p_answer_function,
        int max_packet_size_) :
-#ifdef DEBUG_STATISTICS
-       buffer_size_fail(0),
-       largest_packet_seen(0),
-       packet_count(0),
-#endif
-       p_packet_function_(p_packet_function),
-       p_query_function_(p_query_function),
-       p_answer_function_(p_answer_function),
-       buffer_pointer(0),
-       data_buffer(new byte[max_packet_size_]),
-       max_packet_size(max_packet_size_)
-       { 
-         this->startUdpMulticast();
-       };
+    MDns(defaultTransport(), p_packet_function, p_query_function, p_answer_function,
+         new byte[max_packet_size_], max_packet_size_) { }
 
   // Constructor can be passed the buffer to hold the mDNS data.
   // This way the potentially large buffer can be shared with other processes.
@@ -120,18 +404,61 @@ class MDns {
        std::function<void(const Answer*)> p_answer_function,
        byte* data_buffer_,
        int max_packet_size_) :
-#ifdef DEBUG_STATISTICS
-       buffer_size_fail(0),
-       largest_packet_seen(0),
-       packet_count(0),
-#endif
+    MDns(defaultTransport(), p_packet_function, p_query_function, p_answer_function,
+         data_buffer_, max_packet_size_) { }
+
+  // Constructor can be passed the Transport used to send and receive packets.
+  // See mdns_transport.h.
+  // Args:
+  //   transport_ : Sends and receives mDNS packets.
+  //   p_packet_function : Callback fires for every mDNS packet that arrives.
+  //   p_query_function : Callback fires for every mDNS Query that arrives as part of a packet.
+  //   p_answer_function : Callback fires for every mDNS Answer that arrives as part of a packet.
+  //   data_buffer_ : Buffer to hold the mDNS data.
+  //   max_packet_size_ : Size of data_buffer_.
+  MDns(Transport* transport_,
+       std::function<void(const MDns*)> p_packet_function, 
+       std::function<void(const Query*)> p_query_function,
+       std::function<void(const Answer*)> p_answer_function,
+       byte* data_buffer_,
+       int max_packet_size_) :
+       interface_count(1),
+       packet_interface(0),
+       send_interface(MDNS_ALL_INTERFACES),
        p_packet_function_(p_packet_function),
        p_query_function_(p_query_function),
        p_answer_function_(p_answer_function),
        buffer_pointer(0),
        data_buffer(data_buffer_),
-       max_packet_size(max_packet_size_)
+       max_packet_size(max_packet_size_),
+       legacy_rdata_text(true),
+       compression_count(0),
+       auto_flush(false),
+       flush_count(0),
+       overflowed(false),
+       name_table_count(0),
+       name_id_count(0),
+       recent_question_next(0),
+       listener_count(0),
+       remote_port(0),
+       peeked_size(0),
+       peeked_interface(0),
+       reassembly_buffer(NULL),
+       reassembly_size(0),
+       reassembly_used(0),
+       reassembly_port(0),
+       reassembly_interface(0),
+       reassembly_deadline(0),
+       subscription_count(0),
+       record_arena(NULL),
+       record_arena_size(0),
+       arena_record_count(0),
+       arena_free_end(0)
        { 
+         memset(recent_question_times, 0, sizeof(recent_question_times));
+         memset(recent_question_hashes, 0, sizeof(recent_question_hashes));
+         ResetStats();
+         interfaces[0] = transport_;
          this->startUdpMulticast();
        };
 
@@ -139,6 +466,19 @@ class MDns {
 
   // Call this regularly to check for an incoming packet.
   bool loop();
+
+  // Process up to max_packets waiting packets, stopping early once
+  // max_micros have passed. At least one waiting packet is always processed.
+  // Useful when packets arrive faster than loop() gets called. eg: While every
+  // host on the network announces itself after a WiFi reconnect.
+  // Args:
+  //   max_packets : Most packets to process. 0 is treated as 1.
+  //   max_micros : Time budget in microseconds.
+  //   p_more_pending : If not NULL, set to whether another packet is still
+  //                    waiting. (The UDP stack can't say how many.)
+  // Returns the number of packets processed.
+  unsigned int loop(const unsigned int max_packets, const unsigned long max_micros,
+                    bool* p_more_pending = NULL);
   // Deprecated. Use loop() instead.
   bool Check(){
     return loop();
@@ -147,6 +487,13 @@ class MDns {
   // Send this MDns packet.
   void Send() const;
 
+  // Send this MDns packet to one host rather than the multicast group.
+  // eg: A reply to a Query asking for a unicast response, or from a port other
+  // than 5353. Goes out on the interface chosen by SetInterface() or, if none,
+  // the one the current packet arrived on.
+  // Returns false if the Transport can't send unicast packets.
+  bool Send(const IPAddress& remote_ip_, const uint16_t remote_port_) const;
+
   // Resets everything to represent an empty packet.
   // Do this before building a packet for sending.
   void Clear();
@@ -156,34 +503,335 @@ class MDns {
   bool AddQuery(const Query& query);
 
   // Add an answer to packet prior to sending.
+  // Supports A (4 raw bytes in rdata_buffer), PTR (target in rdata_buffer),
+  // AAAA (ipv6), SRV (srv and target in rdata_buffer) and TXT (rdata and
+  // rdlength).
   bool AddAnswer(const Answer& answer);
+
+  // Add an answer with raw resource data to packet prior to sending.
+  // Names in the resource data of PTR and SRV records must not use Message
+  // Compression. eg: As stored by RecordCache. They get compressed against
+  // the rest of the packet.
+  bool AddAnswer(const char* name, const unsigned int rrtype, const unsigned int rrclass,
+                 const bool rrset, const unsigned long int rrttl,
+                 const byte* rdata, const unsigned int rdlength);
+
+  // Add a record with raw resource data to section (one of MDNS_SECTION_ANSWER,
+  // MDNS_SECTION_AUTHORITY or MDNS_SECTION_ADDITIONAL) prior to sending.
+  // Sections must be filled in order. The same rules for resource data apply
+  // as for the raw AddAnswer().
+  bool AddRecord(const byte section, const char* name, const unsigned int rrtype,
+                 const unsigned int rrclass, const bool rrset, const unsigned long int rrttl,
+                 const byte* rdata, const unsigned int rdlength);
+
+  // Typed builders for common record types. Each adds one record to section
+  // (one of MDNS_SECTION_ANSWER, MDNS_SECTION_AUTHORITY or
+  // MDNS_SECTION_ADDITIONAL) with class IN. Names are dotted and get
+  // compressed against the rest of the packet.
+  // rrset sets the "flush cache" bit. Set it for records only this host
+  // answers for. eg: A, AAAA, SRV, TXT and HINFO.
+  // Returns false, leaving the packet unchanged, if the record did not fit.
+  bool AddRecordA(const byte section, const char* name, const IPAddress& address,
+                  const unsigned long int rrttl, const bool rrset);
+  // address : 16 bytes in network order.
+  bool AddRecordAAAA(const byte section, const char* name, const byte* address,
+                     const unsigned long int rrttl, const bool rrset);
+  bool AddRecordPTR(const byte section, const char* name, const char* target,
+                    const unsigned long int rrttl, const bool rrset);
+  bool AddRecordSRV(const byte section, const char* name, const unsigned int priority,
+                    const unsigned int weight, const unsigned int port, const char* target,
+                    const unsigned long int rrttl, const bool rrset);
+  // strings : eg: {"path=/", "ver=2"}. Each up to 255 characters.
+  bool AddRecordTXT(const byte section, const char* name, const char* const* strings,
+                    const unsigned int string_count, const unsigned long int rrttl,
+                    const bool rrset);
+  bool AddRecordHINFO(const byte section, const char* name, const char* cpu, const char* os,
+                      const unsigned long int rrttl, const bool rrset);
+
+  // Mark the packet being built as a response rather than a query.
+  void SetResponse(const bool response);
+
+  // Send the packet being built whenever it fills up so any number of Queries
+  // and records can be added. A Query or record which does not fit goes at the
+  // start of a new packet with the same ID, flags and interface, after the
+  // full one is sent with Send(). Later records stay in their sections and
+  // each packet gets its own Message Compression table. A Query packet which
+  // continues in the next has the TC bit set so responders wait for the rest
+  // of the Known-Answers. (RFC 6762 7.2)
+  // Call after Clear(), which turns it off again. The last packet still needs
+  // Send(). Add*() then only return false for records too big for any packet.
+  void SetAutoFlush(const bool auto_flush_) { auto_flush = auto_flush_; }
+
+  // Packets sent by auto flush since Clear().
+  unsigned int flushCount() const { return flush_count; }
+
+  // Decode the Query at index in the current packet, received or being built.
+  // Returns false if there is no Query at index.
+  bool GetQuery(const unsigned int index, Query* p_query);
+
+  // True if another host has recently sent this Question without any
+  // Known-Answers. Our own copy can then be treated as sent. (RFC 6762 7.3)
+  bool QuestionRecentlySeen(const Query& query) const;
   
+  // Snapshot of the counters. All 0 unless DEBUG_STATISTICS is defined.
+  Stats GetStats() const { return stats_; }
+
+  // Set every counter back to 0.
+  void ResetStats() { memset(&stats_, 0, sizeof(stats_)); }
+
+  // Counters for Listeners to add to. eg: the Responder counts responses.
+  Stats& stats() { return stats_; }
+
   // Display a summary of the packet on Serial port.
   void Display() const;
   
   // Display the raw packet in HEX and ASCII.
   void DisplayRawPacket() const;
- 
-#ifdef DEBUG_STATISTICS
-  // Counter gets increased every time an incoming mDNS packet arrives that does
-  // not fit in the data_buffer.
-  unsigned int buffer_size_fail;
 
-  // Track the largest mDNS packet that has arrived.
-  // Useful for knowing what size to make data_buffer.
-  unsigned int largest_packet_seen;
+  // True if the current packet is a query rather than a response.
+  bool isQuery() const { return type; }
 
-  // How many mDNS packets have arrived so far.
-  unsigned int packet_count;
-#endif
+  // True if the current packet has the TC (truncated) bit set.
+  bool isTruncated() const { return truncated; }
+
+  // Address our own packets are sent from on the interface the current packet
+  // arrived on.
+  IPAddress localIP() const;
+
+  // Address our own packets are sent from on interface_index. 0.0.0.0 if it
+  // has none yet.
+  IPAddress localIP(const unsigned int interface_index) const;
+
+  // Also send and receive using transport_. eg: A WiFiUdpTransport for the
+  // SoftAP interface alongside the station interface, or an IPv6 transport.
+  // The Transport passed to the constructor is interface 0 and this one
+  // becomes interface interfaceCount() -1.
+  // Returns false if MDNS_MAX_INTERFACES are already in use.
+  bool addInterface(Transport* transport_);
+
+  unsigned int interfaceCount() const { return interface_count; }
+
+  // Reopen the sockets of every interface. Sockets are opened once by the
+  // constructor and addInterface() and stay open, so call this after a network
+  // interface comes back up if its Transport doesn't notice by itself.
+  // (WiFiUdpTransport does.) Returns false if any failed to reopen.
+  bool restart();
+
+  // Index of the interface the current packet arrived on.
+  unsigned int packetInterface() const { return packet_interface; }
+
+  // Send the packet being built only on interface_index, or on every
+  // interface if MDNS_ALL_INTERFACES. Clear() goes back to every interface.
+  void SetInterface(const int interface_index) { send_interface = interface_index; }
+
+  // Address the current incoming packet was sent from.
+  IPAddress remoteIP() const;
+
+  // False if the current packet arrived on an IPv6 interface, where
+  // remoteIP() is 0.0.0.0 for most senders. (See Transport::isIPv6().)
+  bool remoteIPKnown() const;
+
+  // Port the current incoming packet was sent from. Anything other than
+  // MDNS_SOURCE_PORT is a legacy unicast Query. (RFC 6762 6.7)
+  uint16_t remotePort() const { return remote_port; }
+
+  // Query ID of the current incoming packet. Only legacy unicast Queries use it.
+  uint16_t packetId() const { return (data_buffer[0] << 8) + data_buffer[1]; }
+
+  // Set the Query ID of the packet being built. Replies to legacy unicast
+  // Queries must echo theirs. Clear() sets it to 0.
+  void SetId(const uint16_t id);
+
+  // When set (the default) Answer::rdata_buffer holds a text rendering of the
+  // resource data as in earlier versions. eg: "p=0;w=0;port=80;host=a.local"
+  // for SRV records. Clear it to skip the formatting and use the decoded
+  // fields of Answer instead. Has no effect if MDNS_RDATA_TEXT is 0.
+  void setLegacyRdataText(const bool legacy_rdata_text_) {
+    legacy_rdata_text = legacy_rdata_text_;
+  }
+
+  // Give MDns somewhere to hold a Query with the TC bit set, and the packets
+  // of Known-Answers that follow it from the same host, for up to
+  // MDNS_TRUNCATED_WAIT_MAX milliseconds. (RFC 6762 7.2)
+  // Callbacks and Listeners then see all of them at once: Listeners get one
+  // onPacket() and onPacketEnd() around the records of every packet.
+  // Each packet held costs its length plus 2 bytes, so a few times
+  // max_packet_size is plenty. Packets which don't fit, and truncated
+  // Queries from a second host while one is held, are processed straight away.
+  // Pass NULL to stop holding packets. (The default.)
+  void setReassemblyBuffer(byte* reassembly_buffer_, const unsigned int reassembly_size_);
+
+  // Decode every record of each incoming packet into arena_ and pass them to
+  // p_records_function once the packet has been read.
+  // Records are laid out from the start of arena_ and their names and data
+  // from the end, so no space is reserved per record. Records which don't fit
+  // are left out. Subscribe() filters these records too.
+  // Pass NULL to stop.
+  void setRecordArena(byte* arena_, const unsigned int arena_size_,
+                      std::function<void(const Record* records, const unsigned int record_count)>
+                          p_records_function);
+
+  // Register a callback which fires for every Query and Answer in incoming
+  // packets with a RecordView rather than a fully decoded Query or Answer.
+  // This is much cheaper than the Query and Answer callbacks as names and data
+  // are only decoded when the callback asks for them.
+  // May be used alone or alongside the Query and Answer callbacks.
+  void setRecordCallback(std::function<void(const RecordView*)> p_record_function) {
+    p_record_function_ = p_record_function;
+  }
+
+  // Attach a Listener which will see every incoming packet and get polled on
+  // every loop(). Returns false if MDNS_MAX_LISTENERS are already attached.
+  bool addListener(Listener* listener);
+
+  // Detach a Listener added by addListener().
+  void removeListener(Listener* listener);
+
+  // Only fire the Query, Answer and RecordView callbacks for records whose
+  // name ends in suffix and whose type is rrtype. May be called several times
+  // to build up a list of interests. With none registered (the default) the
+  // callbacks fire for every record.
+  // Records are matched on hashes of their labels read straight from the
+  // packet so the rest are skipped without being decoded. Listeners still see
+  // every record.
+  // Args:
+  //   suffix : eg: "_http._tcp.local" or "local". Up to
+  //            MDNS_SUBSCRIPTION_MAX_LABELS labels.
+  //   rrtype : eg: MDNS_TYPE_PTR. MDNS_TYPE_ANY matches every type.
+  // Returns false if there are already MDNS_MAX_SUBSCRIPTIONS or suffix is
+  // not valid.
+  bool Subscribe(const char* suffix, const unsigned int rrtype = MDNS_TYPE_ANY);
+
+  // Remove every interest added by Subscribe().
+  void ClearSubscriptions() { subscription_count = 0; }
+ 
  private:
   // Initializes udp multicast
   void startUdpMulticast();
 
+  // Read and process one incoming packet if there is one waiting.
+  bool ProcessPacket();
+
+  // Check for a waiting packet without processing it. ProcessPacket() will
+  // pick it up. Returns true if there is one.
+  bool PeekPacket();
+
+  // Release held packets once their time is up.
+  void CheckHeld();
+
+  // Decode the record in view into record_arena.
+  void AddArenaRecord(const RecordView& view);
+
+  // Take len bytes from the free space of record_arena. Returns NULL if there
+  // is not enough.
+  byte* ArenaString(const unsigned int len);
+
+  // Copy the name of view, or the name at rdata_pos in its resource data if
+  // rdata_pos >= 0, into record_arena. Returns NULL if it does not fit.
+  const char* ArenaName(const RecordView& view, const int rdata_pos);
+
+  // True if the record in view matches a Subscribe() interest, or there are
+  // none.
+  bool Subscribed(const RecordView& view) const;
+
+  // Decode the header of the packet in data_buffer.
+  // Returns false if the packet reports an error.
+  bool ParseHeader();
+
+  // Fire the callbacks for every record in the packet in data_buffer.
+  // Returns false if the packet is corrupt.
+  bool ProcessRecords();
+
+  // Body of ProcessRecords(). Hands each record to the callbacks and listeners.
+  bool ProcessRecordViews();
+
+  // Add the record in view to stats_.
+  void CountRecord(const RecordView& view);
+
+  // Keep the packet in data_buffer in reassembly_buffer if it is a truncated
+  // Query or continues one. Returns true if the packet was kept.
+  bool HoldPacket();
+
+  // Process the packets in reassembly_buffer as one.
+  void ReleaseHeld();
+
+  // Transport used when none is passed to the constructor.
+  // The ESP8266 WiFi station interface or, on host builds, a POSIX socket.
+  static Transport* defaultTransport();
+
+  // Send and receive mDNS packets. interfaces[0] is the one passed to the
+  // constructor. The rest were added by addInterface().
+  Transport* interfaces[MDNS_MAX_INTERFACES];
+  unsigned int interface_count;
+
+  // Interface the current packet arrived on.
+  unsigned int packet_interface;
+
+  // Set by SetInterface().
+  int send_interface;
+
+  friend class RecordView;
+
+  // Find the boundaries of the record at buffer_pointer and move buffer_pointer
+  // past it. Returns false if the record does not fit in the packet.
+  bool ParseRecordView(RecordView* view, const byte section);
+
+  // Remember a Question another host has sent for QuestionRecentlySeen().
+  void RememberQuestion(const RecordView& view);
+
+  // Look up the name at offset in name_table, adding it if it is new. The name
+  // must end before limit. Sets *p_id to MDNS_NAME_ID_NONE and *p_hash to 0
+  // if it is corrupt.
+  void InternName(unsigned int offset, const unsigned int limit, byte* p_id, uint32_t* p_hash);
+
+  // Fully decode the record described by view and fire the Query or Answer callback.
+  void ProcessQuery(const RecordView& view);
+  void ProcessAnswer(const RecordView& view);
+
   void Parse_Query(Query& query);
   void Parse_Answer(Answer& answer);
+  // Write name_buffer into data_buffer at buffer_pointer, re-using any suffix
+  // already in the packet by way of Message Compression.
+  // Returns the number of bytes written or 0 if it did not fit.
   unsigned int PopulateName(const char* name_buffer);
-  void PopulateAnswerResult(Answer* answer);
+
+  // Write the name, type, class and TTL of a record and leave room for the
+  // resource data length. Returns false, leaving the packet unchanged, if it
+  // did not fit.
+  bool StartRecord(const byte section, const char* name, const unsigned int rrtype,
+                   const unsigned int rrclass, const bool rrset, const unsigned long int rrttl);
+  // Append to the resource data of the record being written.
+  // Return false if it did not fit.
+  bool PopulateData(const byte* data, const unsigned int len);
+  // A length prefixed <character-string>. (RFC 1035 3.3)
+  bool PopulateString(const char* string);
+  // Fill in the resource data length and the section's record count.
+  bool EndRecord(const byte section);
+  // Drop the record being written. Always returns false.
+  bool AbandonRecord();
+
+  // Run add, which adds one Query or record. If it did not fit, auto flush is
+  // on and the packet already holds something, send the packet and run add
+  // again in a new one.
+  template<typename F> bool AddFlushing(F add) {
+    overflowed = false;
+    if (add()) {
+      return true;
+    }
+    if (!auto_flush || !overflowed || data_size <= 12) {
+      return false;
+    }
+    Flush();
+    return add();
+  }
+
+  // Send the packet being built and start another with the same header.
+  void Flush();
+
+  // Compare the name written to data_buffer at offset with name_buffer.
+  bool MatchName(unsigned int offset, const char* name_buffer) const;
+  // Decode the resource data of answer. Returns false if it is corrupt.
+  bool PopulateAnswerResult(Answer* answer);
 
   // Pointer to function that gets called for every incoming mDNS packet.
   std::function<void(const MDns*)> p_packet_function_;
@@ -194,6 +842,10 @@ class MDns {
   // Pointer to function that gets called for every incoming answer.
   std::function<void(const Answer*)> p_answer_function_;
 
+  // Pointer to function that gets called with a RecordView for every incoming
+  // query and answer.
+  std::function<void(const RecordView*)> p_record_function_;
+
   // Position in data_buffer while processing packet.
   unsigned int buffer_pointer;
 
@@ -212,6 +864,9 @@ class MDns {
   // Whether more follows in another packet.
   bool truncated;
 
+  // Render Answer::rdata_buffer as text. See setLegacyRdataText().
+  bool legacy_rdata_text;
+
   // Number of Qeries in the packet.
   unsigned int query_count;
   
@@ -220,6 +875,109 @@ class MDns {
   
   unsigned int ns_count;
   unsigned int ar_count;
+
+  // Names already written to data_buffer that later names may point to.
+  // Populated by PopulateName(). Emptied by Clear().
+  uint16_t compression_offsets[MDNS_COMPRESSION_TABLE_SIZE];
+  uint32_t compression_hashes[MDNS_COMPRESSION_TABLE_SIZE];
+  unsigned int compression_count;
+
+  // State of the record being written between StartRecord() and EndRecord().
+  unsigned int record_compression_count;
+  unsigned int record_rdata_pos;
+
+  // Set by SetAutoFlush(). Cleared by Clear().
+  bool auto_flush;
+  unsigned int flush_count;
+
+  // The last Query or record added ran out of space in data_buffer.
+  bool overflowed;
+
+  // Names of the incoming packet which have been given an id. Each offset is
+  // where the name's first label is, after any leading Message Compression
+  // pointers. Emptied by ProcessRecords(). name_id_count only goes back to 0
+  // at the start of a Query, which may be several held packets.
+  uint16_t name_table_offsets[MDNS_NAME_TABLE_SIZE];
+  uint32_t name_table_hashes[MDNS_NAME_TABLE_SIZE];
+  byte name_table_ids[MDNS_NAME_TABLE_SIZE];
+  unsigned int name_table_count;
+  unsigned int name_id_count;
+
+  // Hashes of Questions other hosts sent recently and when they were seen.
+  uint32_t recent_question_hashes[MDNS_RECENT_QUESTIONS];
+  uint32_t recent_question_times[MDNS_RECENT_QUESTIONS];
+  unsigned int recent_question_next;
+
+  // Attached by addListener().
+  Listener* listeners[MDNS_MAX_LISTENERS];
+  unsigned int listener_count;
+
+  // Address and port the current packet came from.
+  IPAddress remote_ip;
+  uint16_t remote_port;
+
+  // Size returned by a parsePacket() made by PeekPacket(). 0 if none.
+  // Interfaces are polled in turn so a busy one can't starve the others.
+  int peeked_size;
+  unsigned int peeked_interface;
+
+  // Packets held by HoldPacket(). Each is a 2 byte length then the packet.
+  byte* reassembly_buffer;
+  unsigned int reassembly_size;
+  unsigned int reassembly_used;
+  IPAddress reassembly_source;
+  uint16_t reassembly_port;
+  unsigned int reassembly_interface;
+  uint32_t reassembly_deadline;
+
+  // Added by Subscribe().
+  Subscription subscriptions[MDNS_MAX_SUBSCRIPTIONS];
+  unsigned int subscription_count;
+
+  // Set by setRecordArena(). Records grow up from the start. Strings grow
+  // down from arena_free_end.
+  std::function<void(const Record*, const unsigned int)> p_records_function_;
+  byte* record_arena;
+  unsigned int record_arena_size;
+  unsigned int arena_record_count;
+  unsigned int arena_free_end;
+
+  // Returned by GetStats(). Send() is const but counts sent packets.
+  mutable Stats stats_;
+};
+
+// MDns which holds its own data_buffer of N bytes so the packet size can be
+// chosen per instance without a heap allocation. eg:
+//   mdns::StaticMDns<512> my_mdns(NULL, NULL, answerCallback);
+template <unsigned int N>
+class StaticMDns : public MDns {
+ public:
+  static_assert(N > 12, "StaticMDns buffer must hold at least a DNS header.");
+
+  // Uses the default Transport.
+  // Args:
+  //   p_packet_function : Callback fires for every mDNS packet that arrives.
+  //   p_query_function : Callback fires for every mDNS Query that arrives as part of a packet.
+  //   p_answer_function : Callback fires for every mDNS Answer that arrives as part of a packet.
+  StaticMDns(std::function<void(const MDns*)> p_packet_function,
+             std::function<void(const Query*)> p_query_function,
+             std::function<void(const Answer*)> p_answer_function) :
+    MDns(p_packet_function, p_query_function, p_answer_function, static_buffer, N) { }
+
+  // Args:
+  //   transport_ : Sends and receives mDNS packets.
+  //   p_packet_function : Callback fires for every mDNS packet that arrives.
+  //   p_query_function : Callback fires for every mDNS Query that arrives as part of a packet.
+  //   p_answer_function : Callback fires for every mDNS Answer that arrives as part of a packet.
+  StaticMDns(Transport* transport_,
+             std::function<void(const MDns*)> p_packet_function,
+             std::function<void(const Query*)> p_query_function,
+             std::function<void(const Answer*)> p_answer_function) :
+    MDns(transport_, p_packet_function, p_query_function, p_answer_function, static_buffer, N) { }
+
+ private:
+  // Only its address is used before MDns is constructed.
+  byte static_buffer[N];
 };
 
 
@@ -228,11 +986,49 @@ class MDns {
 void PrintHex(unsigned char data);
 
 // Extract Name from DNS data. Will follow pointers used by Message Compression.
-// TODO Check for exceeding packet size.
+// The name is written to p_name_buffer starting at name_buffer_pos and is
+// silently truncated to fit in name_buffer_len.
+// Returns the position in p_packet_buffer of the first byte after the name or a
+// negative MDNS_ERR_NAME_* error if the name runs past packet_buffer_len or
+// its compression pointers are invalid.
+int nameFromDnsPointer(char* p_name_buffer, int name_buffer_pos, const int name_buffer_len,
+    const byte* p_packet_buffer, int packet_buffer_pos, const int packet_buffer_len);
+
+// Deprecated. Does not know the length of the packet so can not stop a
+// corrupt name from being read past the end of it.
 int nameFromDnsPointer(char* p_name_buffer, int name_buffer_pos, const int name_buffer_len, 
     const byte* p_packet_buffer, int packet_buffer_pos);
-int nameFromDnsPointer(char* p_name_buffer, int name_buffer_pos, const int name_buffer_len,
-    const byte* p_packet_buffer, int packet_buffer_pos, const bool recurse);
+
+// Find the end of a DNS name without decoding it.
+// Returns the position of the first byte after the name or a negative
+// MDNS_ERR_NAME_* error.
+int skipDnsName(const byte* p_packet_buffer, int packet_buffer_pos, const int packet_buffer_len);
+
+// Copy a DNS name into p_out_buffer in wire format, following any Message
+// Compression pointers so the copy makes sense outside of the packet.
+// Returns the number of bytes written or a negative MDNS_ERR_NAME_* error.
+int expandDnsName(byte* p_out_buffer, const int out_buffer_len,
+    const byte* p_packet_buffer, int packet_buffer_pos, const int packet_buffer_len);
+
+// Compare two dotted names. Case insensitive and ignores any trailing '.'.
+bool sameName(const char* name_a, const char* name_b);
+
+// Case insensitive hash of a dotted name. eg: "MyHost.local".
+// A trailing '.' is ignored.
+uint32_t nameHash(const char* name);
+
+// The same hash as nameHash() calculated directly from a name in a packet.
+// Returns 0 if the name is corrupt.
+uint32_t nameHashFromDnsPointer(const byte* p_packet_buffer, int packet_buffer_pos,
+    const int packet_buffer_len);
+
+// Compare two names in a packet without decoding them. Case insensitive.
+// Returns false if either is corrupt.
+bool sameDnsName(const byte* p_packet_buffer, int pos_a, int pos_b,
+    const int packet_buffer_len);
+
+// True if millis() time a is before time b. Works across millis() wrapping round.
+bool timeBefore(const uint32_t a, const uint32_t b);
 
 bool writeToBuffer(const byte value, char* p_name_buffer, int* p_name_buffer_pos, const int name_buffer_len);
 
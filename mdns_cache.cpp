@@ -0,0 +1,410 @@
+#include <Arduino.h>
+#include "mdns_cache.h"
+
+
+namespace mdns {
+
+// Length of a dotted name ignoring any trailing '.'.
+static unsigned int cacheNameLen(const char* name) {
+  unsigned int name_len = strlen(name);
+  if (name_len > 0 && name[name_len -1] == '.') {
+    name_len--;
+  }
+  return name_len;
+}
+
+RecordCache::RecordCache(CacheEntry* entries_, unsigned int entry_count_,
+                         byte* arena_, unsigned int arena_size_) :
+  entries(entries_),
+  // With fewer than 2 slots there is never an empty one to end a probe
+  // sequence so the cache is disabled.
+  entry_count(entry_count_ < 2 ? 0 : entry_count_),
+  arena(arena_),
+  arena_size(arena_size_ > 0xFFFF ? 0xFFFF : arena_size_),
+  known(new byte[(entry_count +7) / 8]),
+  last_purge(millis()),
+  owns_storage(false),
+  hit_count(0),
+  miss_count(0) {
+  Clear();
+}
+
+RecordCache::~RecordCache() {
+  delete[] known;
+  if (owns_storage) {
+    delete[] entries;
+    delete[] arena;
+  }
+}
+
+void RecordCache::Clear() {
+  for (unsigned int i = 0; i < entry_count; i++) {
+    entries[i].used = false;
+  }
+  used_count = 0;
+  arena_used = 0;
+  arena_live = 0;
+}
+
+unsigned int RecordCache::Slot(const uint32_t name_hash, const unsigned int rrtype) const {
+  return (name_hash ^ (rrtype * 2654435761UL)) % entry_count;
+}
+
+bool RecordCache::MatchName(const CacheEntry& cache_entry, const char* name,
+                            const unsigned int name_len) const {
+  if (cache_entry.name_len != name_len) {
+    return false;
+  }
+  const byte* stored = arena + cache_entry.data_offset;
+  for (unsigned int i = 0; i < name_len; i++) {
+    if (tolower(stored[i]) != tolower(name[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int RecordCache::Find(const char* name, const unsigned int rrtype, const int after) const {
+  if (entry_count == 0) {
+    MDNS_STAT(miss_count += (after < 0));
+    return -1;
+  }
+  const unsigned int name_len = cacheNameLen(name);
+  const uint32_t name_hash = nameHash(name);
+  const uint32_t now = millis();
+
+  if (rrtype == MDNS_TYPE_ANY) {
+    // Records of each type are in different probe sequences so look at every
+    // slot.
+    for (unsigned int slot = after +1; slot < entry_count; slot++) {
+      const CacheEntry& cache_entry = entries[slot];
+      if (cache_entry.used && cache_entry.name_hash == name_hash &&
+          timeBefore(now, cache_entry.expires) && MatchName(cache_entry, name, name_len)) {
+        MDNS_STAT(hit_count += (after < 0));
+        return slot;
+      }
+    }
+    MDNS_STAT(miss_count += (after < 0));
+    return -1;
+  }
+
+  // Linear probing. Every record with this name and type is between the home
+  // slot and the next empty slot.
+  unsigned int slot = (after < 0) ? Slot(name_hash, rrtype) : (after +1) % entry_count;
+  while (entries[slot].used) {
+    const CacheEntry& cache_entry = entries[slot];
+    if (cache_entry.name_hash == name_hash && cache_entry.rrtype == rrtype &&
+        timeBefore(now, cache_entry.expires) && MatchName(cache_entry, name, name_len)) {
+      MDNS_STAT(hit_count += (after < 0));
+      return slot;
+    }
+    slot = (slot +1) % entry_count;
+  }
+  MDNS_STAT(miss_count += (after < 0));
+  return -1;
+}
+
+void RecordCache::AddStats(Stats* stats) const {
+  stats->cache_hits += hit_count;
+  stats->cache_misses += miss_count;
+}
+
+void RecordCache::ResetStats() {
+  hit_count = 0;
+  miss_count = 0;
+}
+
+unsigned long int RecordCache::ttl(const int index) const {
+  const int32_t remaining = entries[index].expires - millis();
+  if (remaining <= 0) {
+    return 0;
+  }
+  return remaining / 1000;
+}
+
+int RecordCache::name(const int index, char* p_name_buffer, const int name_buffer_len) const {
+  int name_len = entries[index].name_len;
+  if (name_len > name_buffer_len -1) {
+    name_len = name_buffer_len -1;
+  }
+  memcpy(p_name_buffer, arena + entries[index].data_offset, name_len);
+  p_name_buffer[name_len] = '\0';
+  return name_len;
+}
+
+int RecordCache::rdataName(const int index, char* p_name_buffer, const int name_buffer_len,
+                           const unsigned int rdata_pos) const {
+  if (rdata_pos >= entries[index].rdlength) {
+    return MDNS_ERR_NAME_OVERRUN;
+  }
+  const int name_end = nameFromDnsPointer(p_name_buffer, 0, name_buffer_len, rdata(index),
+                                          rdata_pos, entries[index].rdlength);
+  if (name_end < 0) {
+    return name_end;
+  }
+  return strlen(p_name_buffer);
+}
+
+bool RecordCache::Insert(const RecordView* view) {
+  if (view->isQuery() || entry_count == 0) {
+    return false;
+  }
+
+  char name_buffer[MAX_MDNS_NAME_LEN];
+  const int name_len = view->name(name_buffer, MAX_MDNS_NAME_LEN);
+  if (name_len < 0) {
+    return false;
+  }
+  const uint32_t name_hash = nameHash(name_buffer);
+  const unsigned int rrtype = view->rrtype();
+  const unsigned int rrclass = view->rrclass();
+
+  // Names in the resource data may point elsewhere in the packet so they are
+  // stored expanded.
+  byte rdata_buffer[MAX_MDNS_NAME_LEN + 6];
+  const byte* p_rdata = view->rdata();
+  int rdlength = view->rdlength();
+  if (rrtype == MDNS_TYPE_PTR || rrtype == MDNS_TYPE_SRV) {
+    // SRV has priority, weight and port before the target name.
+    const unsigned int fixed_len = (rrtype == MDNS_TYPE_SRV) ? 6 : 0;
+    if ((unsigned int)rdlength < fixed_len +1) {
+      return false;
+    }
+    memcpy(rdata_buffer, p_rdata, fixed_len);
+    const int expanded_len = expandDnsName(rdata_buffer + fixed_len, MAX_MDNS_NAME_LEN,
+                                           view->packet(), view->rdataOffset() + fixed_len,
+                                           view->packetSize());
+    if (expanded_len < 0) {
+      return false;
+    }
+    p_rdata = rdata_buffer;
+    rdlength = fixed_len + expanded_len;
+  }
+
+  const uint32_t now = millis();
+  unsigned long int rrttl = view->rrttl();
+  if (rrttl > MDNS_CACHE_MAX_TTL) {
+    rrttl = MDNS_CACHE_MAX_TTL;
+  }
+
+  // Look for this exact record. At the same time, if the "flush cache" bit is
+  // set, any other record with this name, type and class which has been cached
+  // for more than a second is due to be flushed. (RFC 6762 10.2)
+  int existing = -1;
+  unsigned int slot = Slot(name_hash, rrtype);
+  while (entries[slot].used) {
+    CacheEntry& cache_entry = entries[slot];
+    if (cache_entry.name_hash == name_hash && cache_entry.rrtype == rrtype &&
+        cache_entry.rrclass == rrclass && MatchName(cache_entry, name_buffer, name_len)) {
+      if (cache_entry.rdlength == rdlength &&
+          memcmp(arena + cache_entry.data_offset + cache_entry.name_len, p_rdata, rdlength) == 0) {
+        existing = slot;
+      } else if (view->rrset() && now - cache_entry.received > MDNS_CACHE_FLUSH_DELAY &&
+                 timeBefore(now + MDNS_CACHE_FLUSH_DELAY, cache_entry.expires)) {
+        cache_entry.expires = now + MDNS_CACHE_FLUSH_DELAY;
+      }
+    }
+    slot = (slot +1) % entry_count;
+  }
+
+  if (rrttl == 0) {
+    // Goodbye packet. Keep the record for one more second. (RFC 6762 10.1)
+    if (existing >= 0 && timeBefore(now + MDNS_CACHE_FLUSH_DELAY, entries[existing].expires)) {
+      entries[existing].expires = now + MDNS_CACHE_FLUSH_DELAY;
+    }
+    return true;
+  }
+
+  if (existing >= 0) {
+    entries[existing].received = now;
+    entries[existing].expires = now + rrttl * 1000;
+    entries[existing].rrttl = rrttl;
+    return true;
+  }
+
+  const int new_slot = Allocate(name_hash, rrtype, name_len + rdlength);
+  if (new_slot < 0) {
+#ifdef DEBUG_OUTPUT
+    MDNS_DEBUG_SERIAL.println(" ERROR. RecordCache::Insert record too big for arena.");
+#endif
+    return false;
+  }
+
+  CacheEntry& cache_entry = entries[new_slot];
+  cache_entry.name_hash = name_hash;
+  cache_entry.received = now;
+  cache_entry.expires = now + rrttl * 1000;
+  cache_entry.rrttl = rrttl;
+  cache_entry.rrtype = rrtype;
+  cache_entry.rrclass = rrclass;
+  cache_entry.data_offset = arena_used;
+  cache_entry.rdlength = rdlength;
+  cache_entry.name_len = name_len;
+  cache_entry.used = true;
+  memcpy(arena + arena_used, name_buffer, name_len);
+  memcpy(arena + arena_used + name_len, p_rdata, rdlength);
+  arena_used += name_len + rdlength;
+  arena_live += name_len + rdlength;
+  used_count++;
+
+  return true;
+}
+
+int RecordCache::Allocate(const uint32_t name_hash, const unsigned int rrtype,
+                          const unsigned int size) {
+  if (size > arena_size) {
+    return -1;
+  }
+
+  // Keep the table at most 3/4 full so probe sequences stay short.
+  const unsigned int max_used = entry_count - (entry_count +3) / 4;
+  while (used_count >= max_used) {
+    EvictOne();
+  }
+
+  if (arena_used + size > arena_size) {
+    while (arena_live + size > arena_size) {
+      EvictOne();
+    }
+    Compact();
+  }
+
+  unsigned int slot = Slot(name_hash, rrtype);
+  while (entries[slot].used) {
+    slot = (slot +1) % entry_count;
+  }
+  return slot;
+}
+
+void RecordCache::Remove(unsigned int slot) {
+  arena_live -= entries[slot].name_len + entries[slot].rdlength;
+  if (arena_live == 0) {
+    arena_used = 0;
+  }
+  entries[slot].used = false;
+  used_count--;
+
+  // Move any later records in the same run of used slots back into the gap if
+  // that does not put them before their home slot.
+  unsigned int hole = slot;
+  unsigned int next = (slot +1) % entry_count;
+  while (entries[next].used) {
+    const unsigned int home = Slot(entries[next].name_hash, entries[next].rrtype);
+    bool reachable;
+    if (hole <= next) {
+      reachable = home > hole && home <= next;
+    } else {
+      reachable = home > hole || home <= next;
+    }
+    if (!reachable) {
+      entries[hole] = entries[next];
+      entries[next].used = false;
+      hole = next;
+    }
+    next = (next +1) % entry_count;
+  }
+}
+
+bool RecordCache::EvictOne() {
+  int oldest = -1;
+  for (unsigned int i = 0; i < entry_count; i++) {
+    if (entries[i].used && (oldest < 0 || timeBefore(entries[i].expires, entries[oldest].expires))) {
+      oldest = i;
+    }
+  }
+  if (oldest < 0) {
+    return false;
+  }
+  Remove(oldest);
+  return true;
+}
+
+void RecordCache::Compact() {
+  // Move records down in the order they appear in the arena so none gets
+  // overwritten before it has been moved.
+  unsigned int arena_pos = 0;
+  while (true) {
+    int lowest = -1;
+    for (unsigned int i = 0; i < entry_count; i++) {
+      if (entries[i].used && entries[i].name_len + entries[i].rdlength > 0 &&
+          entries[i].data_offset >= arena_pos &&
+          (lowest < 0 || entries[i].data_offset < entries[lowest].data_offset)) {
+        lowest = i;
+      }
+    }
+    if (lowest < 0) {
+      break;
+    }
+    const unsigned int size = entries[lowest].name_len + entries[lowest].rdlength;
+    memmove(arena + arena_pos, arena + entries[lowest].data_offset, size);
+    entries[lowest].data_offset = arena_pos;
+    arena_pos += size;
+  }
+  arena_used = arena_pos;
+}
+
+void RecordCache::Purge() {
+  const uint32_t now = millis();
+  unsigned int slot = 0;
+  while (slot < entry_count) {
+    if (entries[slot].used && !timeBefore(now, entries[slot].expires)) {
+      // Remove() may move another record into this slot so check it again.
+      Remove(slot);
+      continue;
+    }
+    slot++;
+  }
+}
+
+unsigned int RecordCache::AddKnownAnswers(MDns* mdns) const {
+  // Pick the records first. With auto flush the Queries are gone from the
+  // packet once the first one is sent.
+  if (!known) {
+    return 0;
+  }
+  memset(known, 0, (entry_count +7) / 8);
+  Query query;
+  for (unsigned int i_question = 0; mdns->GetQuery(i_question, &query); i_question++) {
+    for (int index = Find(query.qname_buffer, query.qtype); index >= 0;
+         index = Find(query.qname_buffer, query.qtype, index)) {
+      const CacheEntry& cache_entry = entries[index];
+      if (ttl(index) * 2 <= cache_entry.rrttl ||
+          (cache_entry.rrclass != query.qclass && query.qclass != 0xFF)) {
+        continue;
+      }
+      known[index / 8] |= (1 << (index % 8));
+    }
+  }
+
+  unsigned int added = 0;
+  char name_buffer[MAX_MDNS_NAME_LEN];
+  for (unsigned int index = 0; index < entry_count; index++) {
+    if (!(known[index / 8] & (1 << (index % 8)))) {
+      continue;
+    }
+    const CacheEntry& cache_entry = entries[index];
+    name(index, name_buffer, MAX_MDNS_NAME_LEN);
+    if (!mdns->AddAnswer(name_buffer, cache_entry.rrtype, cache_entry.rrclass, false,
+                         ttl(index), rdata(index), cache_entry.rdlength)) {
+      // Packet is full.
+      break;
+    }
+    added++;
+  }
+  return added;
+}
+
+void RecordCache::onRecord(MDns* mdns, const RecordView* view) {
+  if (!view->isQuery()) {
+    Insert(view);
+  }
+}
+
+void RecordCache::poll(MDns* mdns) {
+  if (millis() - last_purge >= MDNS_CACHE_PURGE_INTERVAL) {
+    last_purge = millis();
+    Purge();
+  }
+}
+
+} // namespace mdns
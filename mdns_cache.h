@@ -0,0 +1,188 @@
+#ifndef MDNS_CACHE_H
+#define MDNS_CACHE_H
+
+#include <Arduino.h>
+#include "mdns.h"
+
+// How long records superseded by a "flush cache" record or removed by a
+// goodbye packet (TTL = 0) are kept for. (RFC 6762 10.1 and 10.2)
+#define MDNS_CACHE_FLUSH_DELAY 1000
+
+// Longest TTL honoured. Longer ones are clamped so expiry times can be
+// compared across millis() wrapping round. (seconds)
+#define MDNS_CACHE_MAX_TTL 0x1FFFFF
+
+// How often expired records are removed from the cache. (milliseconds)
+#define MDNS_CACHE_PURGE_INTERVAL 1000
+
+#if MAX_MDNS_NAME_LEN > 256
+#error "MAX_MDNS_NAME_LEN too large. RecordCache stores name lengths in a byte."
+#endif
+
+namespace mdns {
+
+// One record stored in a RecordCache.
+typedef struct CacheEntry {
+  uint32_t name_hash;       // nameHash() of the record's name.
+  uint32_t received;        // millis() when the record last arrived.
+  uint32_t expires;         // millis() when the record stops being valid.
+  uint32_t rrttl;           // TTL of the record when it last arrived. (seconds)
+  uint16_t rrtype;          // ResourceRecord Type.
+  uint16_t rrclass;         // ResourceRecord Class without the "flush cache" bit.
+  uint16_t data_offset;     // Position of the name and resource data in the arena.
+  uint16_t rdlength;        // Length of the resource data.
+  byte name_len;            // Length of the name. (Stored without terminating '\0'.)
+  bool used;                // False if this slot in the table is empty.
+} CacheEntry;
+
+// Fixed size cache of the Answers seen by an MDns instance.
+// Records are looked up by name and type in constant time without any heap
+// allocation. Expiry follows the rules in RFC 6762: Records are dropped when
+// their TTL runs out, soon after a goodbye packet and soon after another
+// record arrives with the "flush cache" bit set.
+// When full, the record closest to expiring is evicted.
+//
+// Names in the resource data of PTR and SRV records are stored without
+// Message Compression so rdata() can be used without the original packet.
+//
+// Attach to an MDns with MDns::addListener().
+class RecordCache : public Listener {
+ public:
+  // Simple constructor allocates MDNS_CACHE_ENTRIES table entries and
+  // MDNS_CACHE_ARENA_SIZE bytes of arena.
+  RecordCache() : RecordCache(MDNS_CACHE_ENTRIES, MDNS_CACHE_ARENA_SIZE) { }
+
+  // Args:
+  //   entry_count_ : Size of the hash table. Up to 3/4 of it is used. With
+  //                  less than 2 nothing is cached.
+  //   arena_size_ : Bytes of storage for record names and resource data.
+  RecordCache(unsigned int entry_count_, unsigned int arena_size_) :
+    RecordCache(new CacheEntry[entry_count_], entry_count_, new byte[arena_size_], arena_size_) {
+    owns_storage = true;
+  }
+
+  // Constructor can be passed the storage the cache uses so it can be
+  // statically allocated. Only a bitmap of entry_count_ bits is then
+  // allocated, once, by the constructor.
+  // Args:
+  //   entries_ : Table of entry_count_ records.
+  //   entry_count_ : Size of entries_. With less than 2 nothing is cached.
+  //   arena_ : Storage for record names and resource data.
+  //   arena_size_ : Size of arena_. At most 65535.
+  RecordCache(CacheEntry* entries_, unsigned int entry_count_, byte* arena_, unsigned int arena_size_);
+
+  ~RecordCache();
+
+  // Store the Answer described by view. Queries are ignored.
+  // Returns false if the record could not be cached.
+  bool Insert(const RecordView* view);
+
+  // Find a record with a matching name and type.
+  // Args:
+  //   name : Dotted name of the record. eg: "_http._tcp.local".
+  //   rrtype : ResourceRecord Type. eg: MDNS_TYPE_PTR. MDNS_TYPE_ANY finds
+  //            records of every type. That looks at the whole table.
+  //   after : Pass the index returned by a previous call to Find() to get the
+  //           next matching record.
+  // Returns the index of a matching record or -1 if there are no more.
+  // Indexes stay valid until the next MDns::loop() or Insert().
+  int Find(const char* name, const unsigned int rrtype, const int after = -1) const;
+
+  // Accessors for a record found by Find().
+  const CacheEntry* entry(const int index) const { return &entries[index]; }
+  const byte* rdata(const int index) const {
+    return arena + entries[index].data_offset + entries[index].name_len;
+  }
+  unsigned int rdlength(const int index) const { return entries[index].rdlength; }
+
+  // Seconds until the record expires.
+  unsigned long int ttl(const int index) const;
+
+  // Copy the record's name to p_name_buffer. Returns the length of the name.
+  int name(const int index, char* p_name_buffer, const int name_buffer_len) const;
+
+  // Decode a name stored in the resource data. eg: The target of a PTR record
+  // (rdata_pos = 0) or of a SRV record (rdata_pos = 6).
+  // Returns the length of the decoded name or a negative MDNS_ERR_NAME_* error.
+  int rdataName(const int index, char* p_name_buffer, const int name_buffer_len,
+                const unsigned int rdata_pos = 0) const;
+
+  // Add Known-Answers to the packet being built by mdns. (RFC 6762 7.1)
+  // For every Query already in the packet, any cached record answering it
+  // with more than half of its TTL left is added to the Answer section so
+  // responders know not to send it again.
+  // Call this after all the Queries have been added. With
+  // MDns::SetAutoFlush() on, a long list of Known-Answers continues over
+  // several packets.
+  // Returns the number of records added.
+  unsigned int AddKnownAnswers(MDns* mdns) const;
+
+  // Remove every record.
+  void Clear();
+
+  // Remove records which have expired.
+  void Purge();
+
+  // Number of records currently stored. Includes expired records which have
+  // not been purged yet.
+  unsigned int size() const { return used_count; }
+
+  // Add how many Find() calls found a record and how many did not to
+  // stats. Only counted when DEBUG_STATISTICS is defined.
+  // eg: Stats stats = my_mdns.GetStats(); cache.AddStats(&stats);
+  void AddStats(Stats* stats) const;
+
+  // Set the hit and miss counts back to 0.
+  void ResetStats();
+
+  // Listener interface.
+  void onRecord(MDns* mdns, const RecordView* view);
+  void poll(MDns* mdns);
+
+ private:
+  // Home slot of a record in entries.
+  unsigned int Slot(const uint32_t name_hash, const unsigned int rrtype) const;
+
+  // Compare the name stored for an entry with name.
+  bool MatchName(const CacheEntry& cache_entry, const char* name, const unsigned int name_len) const;
+
+  // Find space in entries and arena for a new record, evicting if necessary.
+  // Returns the slot or -1 if the record can never fit.
+  int Allocate(const uint32_t name_hash, const unsigned int rrtype, const unsigned int size);
+
+  // Remove the record at slot, closing the gap in the probe sequence.
+  void Remove(unsigned int slot);
+
+  // Remove the record that will expire soonest.
+  bool EvictOne();
+
+  // Move the live records to the start of the arena.
+  void Compact();
+
+  CacheEntry* entries;
+  unsigned int entry_count;
+  byte* arena;
+  unsigned int arena_size;
+
+  // Bytes at the start of arena which are allocated.
+  // Some of these may belong to records that have been removed.
+  unsigned int arena_used;
+
+  // Bytes of arena belonging to stored records.
+  unsigned int arena_live;
+
+  // One bit per slot in entries. Records picked by AddKnownAnswers().
+  byte* known;
+
+  unsigned int used_count;
+  uint32_t last_purge;
+  bool owns_storage;
+
+  // Counted by Find(), which is const.
+  mutable uint32_t hit_count;
+  mutable uint32_t miss_count;
+};
+
+} // namespace mdns
+
+#endif  // MDNS_CACHE_H
@@ -0,0 +1,135 @@
+#ifndef MDNS_CONFIG_H
+#define MDNS_CONFIG_H
+
+// Compile time configuration.
+// Every setting here can be overridden with a compiler flag, eg: in
+// platformio.ini
+//   build_flags = -DMAX_PACKET_SIZE=512 -DMDNS_RDATA_TEXT=0
+// Settings must be the same for every file of the library so defining them in
+// a sketch before including mdns.h is not enough.
+
+// Debugging. All off by default so none of the code is compiled in.
+// Define to enable:
+//   DEBUG_STATISTICS : Record how many incoming packets fitted into data_buffer.
+//   DEBUG_OUTPUT : Send packet summaries to MDNS_DEBUG_SERIAL.
+//   DEBUG_RAW : Send HEX and ASCII encoded raw packet to MDNS_DEBUG_SERIAL.
+
+// Where debugging output and the Display() methods print to. Anything with
+// Serial's print() and println().
+#ifndef MDNS_DEBUG_SERIAL
+#define MDNS_DEBUG_SERIAL Serial
+#endif
+
+// Set to 0 to leave out the text rendering of resource data filled into
+// Answer::rdata_buffer. (See MDns::setLegacyRdataText().) Answer::FormatRdata()
+// is still available.
+#ifndef MDNS_RDATA_TEXT
+#define MDNS_RDATA_TEXT 1
+#endif
+
+// Make this as big as memory limitations allow.
+// This default value can be overridden using the max_packet_size_ parameter of
+// MDns() or the size given to StaticMDns.
+#ifndef MAX_PACKET_SIZE
+#define MAX_PACKET_SIZE 1024
+#endif
+
+// The mDNS spec says this should never be more than 256 (including trailing '\0').
+// Query and Answer hold buffers this size. Shorter names are truncated.
+#ifndef MAX_MDNS_NAME_LEN
+#define MAX_MDNS_NAME_LEN 256
+#endif
+
+// How many name suffixes to remember while building a packet so later names
+// can point at them using Message Compression.
+// Each entry costs 8 bytes of RAM.
+#ifndef MDNS_COMPRESSION_TABLE_SIZE
+#define MDNS_COMPRESSION_TABLE_SIZE 16
+#endif
+
+// How many distinct names of an incoming packet get a name id. (See
+// RecordView::nameId().) Each entry costs 7 bytes of RAM.
+#ifndef MDNS_NAME_TABLE_SIZE
+#define MDNS_NAME_TABLE_SIZE 16
+#endif
+
+// How many recently seen Questions are remembered for duplicate question
+// suppression. (RFC 6762 7.3)
+#ifndef MDNS_RECENT_QUESTIONS
+#define MDNS_RECENT_QUESTIONS 8
+#endif
+
+// How many Transports (network interfaces and address families) one MDns
+// instance can use. See MDns::addInterface().
+#ifndef MDNS_MAX_INTERFACES
+#define MDNS_MAX_INTERFACES 3
+#endif
+
+// How many Listeners may be attached to one MDns instance.
+#ifndef MDNS_MAX_LISTENERS
+#define MDNS_MAX_LISTENERS 4
+#endif
+
+// How many (name suffix, type) interests MDns::Subscribe() can hold.
+#ifndef MDNS_MAX_SUBSCRIPTIONS
+#define MDNS_MAX_SUBSCRIPTIONS 8
+#endif
+
+// Most labels in a suffix passed to MDns::Subscribe(). eg: "_http._tcp.local"
+// is 3.
+#ifndef MDNS_SUBSCRIPTION_MAX_LABELS
+#define MDNS_SUBSCRIPTION_MAX_LABELS 6
+#endif
+
+// Default size of the RecordCache hash table. Up to 3/4 of the entries are used.
+// Each entry costs 28 bytes of RAM.
+#ifndef MDNS_CACHE_ENTRIES
+#define MDNS_CACHE_ENTRIES 32
+#endif
+
+// Default size of the RecordCache arena which stores record names and data.
+#ifndef MDNS_CACHE_ARENA_SIZE
+#define MDNS_CACHE_ARENA_SIZE 2048
+#endif
+
+// How many service instances a ServiceResolver can track at once.
+// Each costs about 700 bytes of RAM.
+#ifndef MDNS_RESOLVER_MAX_SERVICES
+#define MDNS_RESOLVER_MAX_SERVICES 4
+#endif
+
+// Bytes of TXT record kept for each ServiceResolver service instance.
+#ifndef MDNS_RESOLVER_TXT_LEN
+#define MDNS_RESOLVER_TXT_LEN 128
+#endif
+
+// How many services a Responder can advertise.
+// Each costs a little under 250 bytes of RAM.
+#ifndef MDNS_RESPONDER_MAX_SERVICES
+#define MDNS_RESPONDER_MAX_SERVICES 4
+#endif
+
+// Bytes of TXT record kept for each Responder service.
+#ifndef MDNS_RESPONDER_TXT_LEN
+#define MDNS_RESPONDER_TXT_LEN 128
+#endif
+
+// How many records a ResponseScheduler can hold waiting to be sent.
+// Each costs 28 bytes of RAM plus 4 bytes per MDNS_SCHEDULER_MAX_ASKERS.
+#ifndef MDNS_SCHEDULER_MAX_RECORDS
+#define MDNS_SCHEDULER_MAX_RECORDS 16
+#endif
+
+// How many hosts asking for the same queued record a ResponseScheduler tells
+// apart. Known-Answers only stop an answer once every host which asked for it
+// has listed it. Records asked for by more hosts are always sent.
+#ifndef MDNS_SCHEDULER_MAX_ASKERS
+#define MDNS_SCHEDULER_MAX_ASKERS 4
+#endif
+
+// Bytes of ResponseScheduler storage for queued record names and data.
+#ifndef MDNS_SCHEDULER_ARENA_SIZE
+#define MDNS_SCHEDULER_ARENA_SIZE 1024
+#endif
+
+#endif  // MDNS_CONFIG_H
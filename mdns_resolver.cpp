@@ -0,0 +1,473 @@
+#include <Arduino.h>
+#include "mdns_resolver.h"
+
+
+namespace mdns {
+
+// millis() when a record arriving now with rrttl stops being valid. Goodbye
+// records (TTL = 0) are kept for one more second. (RFC 6762 10.1)
+static uint32_t expiryTime(unsigned long int rrttl) {
+  if (rrttl == 0) {
+    return millis() + MDNS_CACHE_FLUSH_DELAY;
+  }
+  if (rrttl > MDNS_CACHE_MAX_TTL) {
+    rrttl = MDNS_CACHE_MAX_TTL;
+  }
+  return millis() + rrttl * 1000;
+}
+
+ServiceResolver::ServiceResolver(const char* service_type_,
+                                 std::function<void(const Service*)> p_service_function,
+                                 RecordCache* cache_) :
+  service_type(service_type_),
+  p_service_function_(p_service_function),
+  cache(cache_) {
+  Restart();
+}
+
+void ServiceResolver::Restart() {
+  for (unsigned int i = 0; i < MDNS_RESOLVER_MAX_SERVICES; i++) {
+    entries[i].used = false;
+  }
+  started = false;
+}
+
+unsigned int ServiceResolver::count() const {
+  unsigned int service_count = 0;
+  for (unsigned int i = 0; i < MDNS_RESOLVER_MAX_SERVICES; i++) {
+    if (entries[i].used) {
+      service_count++;
+    }
+  }
+  return service_count;
+}
+
+const Service* ServiceResolver::service(const unsigned int index) const {
+  unsigned int service_count = 0;
+  for (unsigned int i = 0; i < MDNS_RESOLVER_MAX_SERVICES; i++) {
+    if (entries[i].used && service_count++ == index) {
+      return &entries[i].service;
+    }
+  }
+  return NULL;
+}
+
+ServiceResolver::Entry* ServiceResolver::FindInstance(const char* name) {
+  for (unsigned int i = 0; i < MDNS_RESOLVER_MAX_SERVICES; i++) {
+    if (entries[i].used && sameName(entries[i].service.instance, name)) {
+      return &entries[i];
+    }
+  }
+  return NULL;
+}
+
+ServiceResolver::Entry* ServiceResolver::AddInstance(const char* name, const uint32_t now) {
+  for (unsigned int i = 0; i < MDNS_RESOLVER_MAX_SERVICES; i++) {
+    Entry* entry = &entries[i];
+    if (!entry->used) {
+      Service* service = &entry->service;
+      strncpy(service->instance, name, MAX_MDNS_NAME_LEN -1);
+      service->instance[MAX_MDNS_NAME_LEN -1] = '\0';
+      service->host[0] = '\0';
+      service->port = 0;
+      service->has_ipv4 = false;
+      service->has_ipv6 = false;
+      service->txt_len = 0;
+      service->removed = false;
+      entry->used = true;
+      entry->has_srv = false;
+      entry->has_txt = false;
+      entry->reported = false;
+      entry->changed = false;
+      entry->attempts = 0;
+      entry->expires = now + MDNS_RESOLVER_MIN_INTERVAL;
+      entry->next_query = now + MDNS_RESOLVER_QUERY_DELAY;
+      entry->interval = MDNS_RESOLVER_MIN_INTERVAL;
+      return entry;
+    }
+  }
+#ifdef DEBUG_OUTPUT
+  MDNS_DEBUG_SERIAL.print(" ERROR. No space in ServiceResolver for ");
+  MDNS_DEBUG_SERIAL.println(name);
+#endif
+  return NULL;
+}
+
+bool ServiceResolver::IsComplete(const Entry& entry) const {
+  return entry.has_srv && entry.has_txt && (entry.service.has_ipv4 || entry.service.has_ipv6);
+}
+
+void ServiceResolver::SetSrv(Entry* entry, const unsigned int port, const char* host,
+                             const unsigned long int rrttl) {
+  Service* service = &entry->service;
+  const bool same_host = entry->has_srv && sameName(service->host, host);
+  if (same_host && service->port == port) {
+    entry->srv_expires = expiryTime(rrttl);
+    return;
+  }
+  if (rrttl == 0) {
+    return;
+  }
+  entry->srv_expires = expiryTime(rrttl);
+  if (!same_host) {
+    // Any address we have belongs to the old host.
+    strncpy(service->host, host, MAX_MDNS_NAME_LEN -1);
+    service->host[MAX_MDNS_NAME_LEN -1] = '\0';
+    service->has_ipv4 = false;
+    service->has_ipv6 = false;
+  }
+  service->port = port;
+  entry->has_srv = true;
+  entry->changed = true;
+}
+
+void ServiceResolver::SetTxt(Entry* entry, const byte* rdata, const unsigned int rdlength,
+                             const unsigned long int rrttl) {
+  // Only keep whole strings.
+  unsigned int txt_len = 0;
+  while (txt_len < rdlength && txt_len + rdata[txt_len] +1 <= rdlength &&
+         txt_len + rdata[txt_len] +1 <= MDNS_RESOLVER_TXT_LEN) {
+    txt_len += rdata[txt_len] +1;
+  }
+  Service* service = &entry->service;
+  if (entry->has_txt && service->txt_len == txt_len &&
+      memcmp(service->txt_buffer, rdata, txt_len) == 0) {
+    entry->txt_expires = expiryTime(rrttl);
+    return;
+  }
+  if (rrttl == 0) {
+    return;
+  }
+  entry->txt_expires = expiryTime(rrttl);
+  memcpy(service->txt_buffer, rdata, txt_len);
+  service->txt_len = txt_len;
+  entry->has_txt = true;
+  entry->changed = true;
+}
+
+void ServiceResolver::SetIpv4(Entry* entry, const byte* address, const unsigned long int rrttl) {
+  Service* service = &entry->service;
+  const IPAddress ipv4(address[0], address[1], address[2], address[3]);
+  if (service->has_ipv4 && service->ipv4 == ipv4) {
+    entry->ipv4_expires = expiryTime(rrttl);
+    return;
+  }
+  if (rrttl == 0) {
+    return;
+  }
+  entry->ipv4_expires = expiryTime(rrttl);
+  service->ipv4 = ipv4;
+  service->has_ipv4 = true;
+  entry->changed = true;
+}
+
+void ServiceResolver::SetIpv6(Entry* entry, const byte* address, const unsigned long int rrttl) {
+  Service* service = &entry->service;
+  if (service->has_ipv6 && memcmp(service->ipv6, address, 16) == 0) {
+    entry->ipv6_expires = expiryTime(rrttl);
+    return;
+  }
+  if (rrttl == 0) {
+    return;
+  }
+  entry->ipv6_expires = expiryTime(rrttl);
+  memcpy(service->ipv6, address, 16);
+  service->has_ipv6 = true;
+  entry->changed = true;
+}
+
+void ServiceResolver::FillFromCache(Entry* entry) {
+  if (!cache) {
+    return;
+  }
+  char name_buffer[MAX_MDNS_NAME_LEN];
+  int index;
+  if (!entry->has_srv) {
+    index = cache->Find(entry->service.instance, MDNS_TYPE_SRV);
+    if (index >= 0 && cache->rdlength(index) > 6 &&
+        cache->rdataName(index, name_buffer, MAX_MDNS_NAME_LEN, 6) >= 0) {
+      const byte* rdata = cache->rdata(index);
+      SetSrv(entry, (rdata[4] << 8) + rdata[5], name_buffer, cache->ttl(index));
+    }
+  }
+  if (!entry->has_txt) {
+    index = cache->Find(entry->service.instance, MDNS_TYPE_TXT);
+    if (index >= 0) {
+      SetTxt(entry, cache->rdata(index), cache->rdlength(index), cache->ttl(index));
+    }
+  }
+  if (entry->has_srv && !entry->service.has_ipv4) {
+    index = cache->Find(entry->service.host, MDNS_TYPE_A);
+    if (index >= 0 && cache->rdlength(index) == 4) {
+      SetIpv4(entry, cache->rdata(index), cache->ttl(index));
+    }
+  }
+  if (entry->has_srv && !entry->service.has_ipv6) {
+    index = cache->Find(entry->service.host, MDNS_TYPE_AAAA);
+    if (index >= 0 && cache->rdlength(index) == 16) {
+      SetIpv6(entry, cache->rdata(index), cache->ttl(index));
+    }
+  }
+}
+
+void ServiceResolver::BrowseCache(const uint32_t now) {
+  if (!cache) {
+    return;
+  }
+  char name_buffer[MAX_MDNS_NAME_LEN];
+  for (int index = cache->Find(service_type, MDNS_TYPE_PTR); index >= 0;
+       index = cache->Find(service_type, MDNS_TYPE_PTR, index)) {
+    if (cache->rdataName(index, name_buffer, MAX_MDNS_NAME_LEN) < 0) {
+      continue;
+    }
+    Entry* entry = FindInstance(name_buffer);
+    if (!entry) {
+      entry = AddInstance(name_buffer, now);
+    }
+    if (entry) {
+      entry->expires = now + cache->ttl(index) * 1000;
+      FillFromCache(entry);
+    }
+  }
+}
+
+void ServiceResolver::Report() {
+  for (unsigned int i = 0; i < MDNS_RESOLVER_MAX_SERVICES; i++) {
+    Entry* entry = &entries[i];
+    if (entry->used && IsComplete(*entry) && (!entry->reported || entry->changed)) {
+      entry->reported = true;
+      entry->changed = false;
+      if (p_service_function_) {
+        // Since a callback function has been registered, execute it.
+        p_service_function_(&entry->service);
+      }
+    }
+  }
+}
+
+void ServiceResolver::onRecord(MDns* mdns, const RecordView* view) {
+  if (view->isQuery()) {
+    return;
+  }
+  const unsigned int rrtype = view->rrtype();
+  if (rrtype != MDNS_TYPE_PTR && rrtype != MDNS_TYPE_SRV && rrtype != MDNS_TYPE_TXT &&
+      rrtype != MDNS_TYPE_A && rrtype != MDNS_TYPE_AAAA) {
+    return;
+  }
+
+  char name_buffer[MAX_MDNS_NAME_LEN];
+  if (view->name(name_buffer, MAX_MDNS_NAME_LEN) < 0) {
+    return;
+  }
+  char rdata_name_buffer[MAX_MDNS_NAME_LEN];
+  const uint32_t now = millis();
+  Entry* entry;
+
+  switch (rrtype) {
+    case MDNS_TYPE_PTR:
+      {
+        if (!sameName(name_buffer, service_type) ||
+            view->rdataName(rdata_name_buffer, MAX_MDNS_NAME_LEN) < 0) {
+          return;
+        }
+        unsigned long int rrttl = view->rrttl();
+        entry = FindInstance(rdata_name_buffer);
+        if (rrttl == 0) {
+          // Goodbye packet. (RFC 6762 10.1)
+          if (entry) {
+            entry->expires = now + MDNS_CACHE_FLUSH_DELAY;
+          }
+          return;
+        }
+        if (!entry) {
+          entry = AddInstance(rdata_name_buffer, now);
+        }
+        if (entry) {
+          if (rrttl > MDNS_CACHE_MAX_TTL) {
+            rrttl = MDNS_CACHE_MAX_TTL;
+          }
+          entry->expires = now + rrttl * 1000;
+        }
+      }
+      break;
+    case MDNS_TYPE_SRV:
+      entry = FindInstance(name_buffer);
+      if (entry && view->rdlength() > 6 &&
+          view->rdataName(rdata_name_buffer, MAX_MDNS_NAME_LEN, 6) >= 0) {
+        SetSrv(entry, (view->rdata()[4] << 8) + view->rdata()[5], rdata_name_buffer,
+               view->rrttl());
+      }
+      break;
+    case MDNS_TYPE_TXT:
+      entry = FindInstance(name_buffer);
+      if (entry) {
+        SetTxt(entry, view->rdata(), view->rdlength(), view->rrttl());
+      }
+      break;
+    case MDNS_TYPE_A:
+    case MDNS_TYPE_AAAA:
+      // Several instances may share a host.
+      for (unsigned int i = 0; i < MDNS_RESOLVER_MAX_SERVICES; i++) {
+        entry = &entries[i];
+        if (!entry->used || !entry->has_srv || !sameName(entry->service.host, name_buffer)) {
+          continue;
+        }
+        if (rrtype == MDNS_TYPE_A && view->rdlength() == 4) {
+          SetIpv4(entry, view->rdata(), view->rrttl());
+        } else if (rrtype == MDNS_TYPE_AAAA && view->rdlength() == 16) {
+          SetIpv6(entry, view->rdata(), view->rrttl());
+        }
+      }
+      break;
+  }
+}
+
+void ServiceResolver::ExpireRecords(Entry* entry, const uint32_t now) {
+  Service* service = &entry->service;
+  const bool was_complete = IsComplete(*entry);
+  if (entry->has_srv && !timeBefore(now, entry->srv_expires)) {
+    // The addresses belong to the host it named.
+    entry->has_srv = false;
+    service->host[0] = '\0';
+    service->port = 0;
+    service->has_ipv4 = false;
+    service->has_ipv6 = false;
+  }
+  if (entry->has_txt && !timeBefore(now, entry->txt_expires)) {
+    entry->has_txt = false;
+    service->txt_len = 0;
+  }
+  if (service->has_ipv4 && !timeBefore(now, entry->ipv4_expires)) {
+    service->has_ipv4 = false;
+  }
+  if (service->has_ipv6 && !timeBefore(now, entry->ipv6_expires)) {
+    service->has_ipv6 = false;
+  }
+  if (was_complete && !IsComplete(*entry)) {
+    // Ask for the missing records again.
+    entry->attempts = 0;
+    entry->next_query = now;
+    entry->interval = MDNS_RESOLVER_MIN_INTERVAL;
+  }
+}
+
+void ServiceResolver::onPacketEnd(MDns* mdns) {
+  // Records may have arrived in an order that meant they could not be matched
+  // up. eg: An A record before the SRV record naming its host.
+  for (unsigned int i = 0; i < MDNS_RESOLVER_MAX_SERVICES; i++) {
+    if (entries[i].used && !IsComplete(entries[i])) {
+      FillFromCache(&entries[i]);
+    }
+  }
+  Report();
+}
+
+void ServiceResolver::poll(MDns* mdns) {
+  const uint32_t now = millis();
+
+  if (!started) {
+    started = true;
+    next_browse = now;
+    browse_interval = MDNS_RESOLVER_MIN_INTERVAL;
+    BrowseCache(now);
+    Report();
+  }
+
+  // Forget instances which have expired and details whose records have.
+  for (unsigned int i = 0; i < MDNS_RESOLVER_MAX_SERVICES; i++) {
+    Entry* entry = &entries[i];
+    if (entry->used && !timeBefore(now, entry->expires)) {
+      entry->used = false;
+      if (entry->reported && p_service_function_) {
+        entry->service.removed = true;
+        p_service_function_(&entry->service);
+      }
+    }
+    if (entry->used) {
+      ExpireRecords(entry, now);
+    }
+  }
+
+  const bool browse_due = !timeBefore(now, next_browse);
+  bool query_due = browse_due;
+  for (unsigned int i = 0; i < MDNS_RESOLVER_MAX_SERVICES; i++) {
+    const Entry& entry = entries[i];
+    if (entry.used && !IsComplete(entry) && entry.attempts < MDNS_RESOLVER_MAX_ATTEMPTS &&
+        !timeBefore(now, entry.next_query)) {
+      query_due = true;
+    }
+  }
+  if (!query_due) {
+    return;
+  }
+
+  // Everything that is due goes in one packet, continued in more if it does
+  // not fit.
+  mdns->Clear();
+  mdns->SetAutoFlush(true);
+  bool added = false;
+
+  const bool first_browse = browse_interval == MDNS_RESOLVER_MIN_INTERVAL;
+  if (browse_due && AddQuery(mdns, service_type, MDNS_TYPE_PTR, first_browse, &added)) {
+    next_browse = now + browse_interval;
+    browse_interval *= 2;
+    if (browse_interval > MDNS_RESOLVER_MAX_INTERVAL) {
+      browse_interval = MDNS_RESOLVER_MAX_INTERVAL;
+    }
+  }
+
+  for (unsigned int i = 0; i < MDNS_RESOLVER_MAX_SERVICES; i++) {
+    Entry* entry = &entries[i];
+    if (!entry->used || IsComplete(*entry) || entry->attempts >= MDNS_RESOLVER_MAX_ATTEMPTS ||
+        timeBefore(now, entry->next_query)) {
+      continue;
+    }
+    const bool first = entry->attempts == 0;
+    bool fitted = true;
+    if (!entry->has_srv) {
+      fitted = fitted && AddQuery(mdns, entry->service.instance, MDNS_TYPE_SRV, first, &added);
+    }
+    if (!entry->has_txt) {
+      fitted = fitted && AddQuery(mdns, entry->service.instance, MDNS_TYPE_TXT, first, &added);
+    }
+    if (entry->has_srv && !entry->service.has_ipv4 && !entry->service.has_ipv6) {
+      fitted = fitted && AddQuery(mdns, entry->service.host, MDNS_TYPE_A, first, &added);
+      fitted = fitted && AddQuery(mdns, entry->service.host, MDNS_TYPE_AAAA, first, &added);
+    }
+    if (!fitted) {
+      // Packet is full. The rest will go on the next loop().
+      break;
+    }
+    entry->attempts++;
+    entry->next_query = now + entry->interval;
+    entry->interval *= 2;
+  }
+
+  if (added) {
+    if (cache) {
+      cache->AddKnownAnswers(mdns);
+    }
+    mdns->Send();
+  }
+}
+
+bool ServiceResolver::AddQuery(MDns* mdns, const char* name, const unsigned int qtype,
+                               const bool unicast, bool* added) {
+  Query query;
+  strncpy(query.qname_buffer, name, MAX_MDNS_NAME_LEN -1);
+  query.qname_buffer[MAX_MDNS_NAME_LEN -1] = '\0';
+  query.qtype = qtype;
+  query.qclass = 1;  // "INternet"
+  query.unicast_response = unicast;
+  if (mdns->QuestionRecentlySeen(query)) {
+    // The answers will arrive without us asking. (RFC 6762 7.3)
+    return true;
+  }
+  if (!mdns->AddQuery(query)) {
+    return false;
+  }
+  *added = true;
+  return true;
+}
+
+} // namespace mdns
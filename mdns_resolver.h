@@ -0,0 +1,153 @@
+#ifndef MDNS_RESOLVER_H
+#define MDNS_RESOLVER_H
+
+#include <Arduino.h>
+#include "mdns.h"
+#include "mdns_cache.h"
+
+// How long to wait after discovering an instance before asking for the records
+// which are still missing. Gives the responder a chance to send them unasked.
+// (milliseconds)
+#define MDNS_RESOLVER_QUERY_DELAY 100
+
+// Interval between the first two queries. It doubles after every query.
+// (milliseconds)
+#define MDNS_RESOLVER_MIN_INTERVAL 1000
+
+// Longest interval between browse (PTR) queries. (RFC 6762 5.2) (milliseconds)
+#define MDNS_RESOLVER_MAX_INTERVAL 3600000
+
+// How many times to ask for the missing records of an instance before waiting
+// for it to be announced again.
+#define MDNS_RESOLVER_MAX_ATTEMPTS 4
+
+namespace mdns {
+
+// A service instance found by ServiceResolver.
+typedef struct Service {
+  char instance[MAX_MDNS_NAME_LEN];   // Service Instance Name. eg: "Mosquitto MQTT server on twinkle._mqtt._tcp.local"
+  char host[MAX_MDNS_NAME_LEN];       // Target host from the SRV record. eg: "twinkle.local"
+  unsigned int port;                  // Port from the SRV record.
+  IPAddress ipv4;                     // Address from the A record. Only valid if has_ipv4.
+  byte ipv6[16];                      // Address from the AAAA record. Only valid if has_ipv6.
+  bool has_ipv4;
+  bool has_ipv6;
+  byte txt_buffer[MDNS_RESOLVER_TXT_LEN];  // Resource data of the TXT record.
+  unsigned int txt_len;               // Bytes used in txt_buffer.
+  bool removed;                       // True if the instance has left the network.
+
+  // The "key=value" strings of the TXT record.
+  TxtRecord txt() const { return TxtRecord(txt_buffer, txt_len); }
+} Service;
+
+// Finds every instance of a service type on the network and follows the
+// PTR -> SRV -> TXT -> A/AAAA chain to resolve each one to a host, port,
+// address and TXT strings.
+// Records are taken from whichever section of any packet they arrive in, and
+// from a RecordCache if one is given, so follow-up queries are only sent for
+// records that are still missing. All queries due at the same time are sent
+// in one packet along with Known-Answers from the cache. A query another host
+// has just sent is not repeated. A and AAAA records are asked for together.
+//
+// Each record is dropped when its TTL runs out, or a second after a goodbye
+// packet. When the SRV record goes, so do the host, port and addresses. An
+// instance left unresolved is asked about again.
+//
+// Attach to an MDns with MDns::addListener().
+class ServiceResolver : public Listener {
+ public:
+  // Args:
+  //   service_type_ : Service to browse for. eg: "_mqtt._tcp.local".
+  //                   The string must stay valid for the life of the resolver.
+  //   p_service_function : Callback fires when an instance has been fully
+  //                        resolved, when any of its details change afterwards
+  //                        and when it leaves the network.
+  //   cache_ : Optional RecordCache which is checked before sending queries.
+  //            It should be attached to the same MDns before the resolver.
+  ServiceResolver(const char* service_type_,
+                  std::function<void(const Service*)> p_service_function,
+                  RecordCache* cache_ = NULL);
+
+  // Forget all instances and start browsing again on the next MDns::loop().
+  void Restart();
+
+  // Instances currently known, resolved or not.
+  unsigned int count() const;
+  const Service* service(const unsigned int index) const;
+
+  // Listener interface.
+  void onRecord(MDns* mdns, const RecordView* view);
+  void onPacketEnd(MDns* mdns);
+  void poll(MDns* mdns);
+
+ private:
+  typedef struct Entry {
+    Service service;
+    bool used;
+    bool has_srv;
+    bool has_txt;
+    bool reported;        // The callback has fired for this instance.
+    bool changed;         // Something changed since the callback last fired.
+    uint32_t expires;     // millis() when the PTR record expires.
+    // millis() when the SRV, TXT, A and AAAA records expire.
+    uint32_t srv_expires;
+    uint32_t txt_expires;
+    uint32_t ipv4_expires;
+    uint32_t ipv6_expires;
+    uint32_t next_query;  // millis() when the missing records are next asked for.
+    uint32_t interval;
+    byte attempts;
+  } Entry;
+
+  // Find the instance with name. Returns NULL if not tracked.
+  Entry* FindInstance(const char* name);
+
+  // Start tracking a new instance. Returns NULL if there is no space.
+  Entry* AddInstance(const char* name, const uint32_t now);
+
+  bool IsComplete(const Entry& entry) const;
+
+  // Record details of an instance and when they expire. Mark it changed if
+  // they differ. A goodbye (rrttl 0) only affects details which match.
+  void SetSrv(Entry* entry, const unsigned int port, const char* host,
+              const unsigned long int rrttl);
+  void SetTxt(Entry* entry, const byte* rdata, const unsigned int rdlength,
+              const unsigned long int rrttl);
+  void SetIpv4(Entry* entry, const byte* address, const unsigned long int rrttl);
+  void SetIpv6(Entry* entry, const byte* address, const unsigned long int rrttl);
+
+  // Drop the details of an instance whose records have expired.
+  void ExpireRecords(Entry* entry, const uint32_t now);
+
+  // Fill in whatever is missing from an instance using the cache.
+  void FillFromCache(Entry* entry);
+
+  // Look for instances in the cache.
+  void BrowseCache(const uint32_t now);
+
+  // Fire the callback for every instance that needs it.
+  void Report();
+
+  // Add a Query to the packet mdns is building unless another host has just
+  // asked the same question. Sets *added if the Query was added.
+  // unicast : Set the QU bit. Used for the first Query of each kind so hosts
+  //           which have recently multicast the answer reply directly.
+  //           (RFC 6762 5.4)
+  // Returns false if the packet is full.
+  bool AddQuery(MDns* mdns, const char* name, const unsigned int qtype, const bool unicast,
+                bool* added);
+
+  const char* service_type;
+  std::function<void(const Service*)> p_service_function_;
+  RecordCache* cache;
+
+  Entry entries[MDNS_RESOLVER_MAX_SERVICES];
+
+  bool started;
+  uint32_t next_browse;
+  uint32_t browse_interval;
+};
+
+} // namespace mdns
+
+#endif  // MDNS_RESOLVER_H
@@ -0,0 +1,765 @@
+#include <Arduino.h>
+#include "mdns_responder.h"
+
+
+namespace mdns {
+
+// Encode a dotted name as uncompressed DNS labels.
+// Returns the number of bytes written or 0 if it did not fit.
+static unsigned int wireName(const char* name, byte* p_buffer, const unsigned int buffer_len) {
+  unsigned int buffer_pos = 0;
+  while (*name != '\0') {
+    const char* label_end = strchr(name, '.');
+    const unsigned int label_len = label_end ? (unsigned int)(label_end - name) : strlen(name);
+    if (label_len == 0 || label_len > 63 || buffer_pos + label_len +2 > buffer_len) {
+      return 0;
+    }
+    p_buffer[buffer_pos++] = label_len;
+    memcpy(p_buffer + buffer_pos, name, label_len);
+    buffer_pos += label_len;
+    name += label_len;
+    if (*name == '.') {
+      name++;
+    }
+  }
+  if (buffer_pos +1 > buffer_len) {
+    return 0;
+  }
+  p_buffer[buffer_pos++] = 0;
+  return buffer_pos;
+}
+
+// Copy a string into a fixed size buffer, truncating if needed.
+static void copyLabel(char* p_dest, const char* source, const unsigned int dest_len) {
+  strncpy(p_dest, source, dest_len -1);
+  p_dest[dest_len -1] = '\0';
+}
+
+Responder::Responder(const char* hostname_) :
+  host_rename_count(0),
+  state(STATE_IDLE),
+  next_time(0),
+  send_count(0),
+  current_interface(0),
+  packet_answers(0),
+  packet_known(0),
+  packet_unicast(0),
+  match_name_id(MDNS_NAME_ID_NONE),
+  match_records(0),
+  response_time(0),
+  unicast_answers(0),
+  unicast_interface(0),
+  legacy_answers(0),
+  legacy_port(0),
+  legacy_id(0),
+  legacy_interface(0) {
+  copyLabel(host, hostname_, MDNS_RESPONDER_LABEL_LEN);
+  for (unsigned int i = 0; i < MDNS_RESPONDER_MAX_SERVICES; i++) {
+    services[i].used = false;
+  }
+  memset(last_sent, 0, sizeof(last_sent));
+  memset(pending_answers, 0, sizeof(pending_answers));
+  Rehash();
+}
+
+int Responder::AddService(const char* instance, const char* service_type, const unsigned int port) {
+  for (unsigned int i = 0; i < MDNS_RESPONDER_MAX_SERVICES; i++) {
+    ResponderService& service = services[i];
+    if (service.used) {
+      continue;
+    }
+    copyLabel(service.instance, instance, MDNS_RESPONDER_LABEL_LEN);
+    copyLabel(service.service_type, service_type, MDNS_RESPONDER_TYPE_LEN);
+    service.port = port;
+    service.txt_len = 0;
+    service.rename_count = 0;
+    service.used = true;
+    Rehash();
+    if (state == STATE_PROBING || state == STATE_ANNOUNCING || state == STATE_ESTABLISHED) {
+      StartProbing(millis());
+    }
+    return i;
+  }
+  return -1;
+}
+
+bool Responder::AddServiceTxt(const int service, const char* txt_string) {
+  if (service < 0 || service >= MDNS_RESPONDER_MAX_SERVICES || !services[service].used) {
+    return false;
+  }
+  ResponderService& responder_service = services[service];
+  const unsigned int txt_string_len = strlen(txt_string);
+  if (txt_string_len > 255 ||
+      responder_service.txt_len + txt_string_len +1 > MDNS_RESPONDER_TXT_LEN) {
+    return false;
+  }
+  responder_service.txt_buffer[responder_service.txt_len++] = txt_string_len;
+  memcpy(responder_service.txt_buffer + responder_service.txt_len, txt_string, txt_string_len);
+  responder_service.txt_len += txt_string_len;
+
+  // The name has not changed so there is no need to probe again. Announce the
+  // new data. (RFC 6762 8.4)
+  if (state == STATE_ESTABLISHED) {
+    state = STATE_ANNOUNCING;
+    send_count = 0;
+    next_time = millis();
+  }
+  return true;
+}
+
+void Responder::Stop() {
+  if (state == STATE_ANNOUNCING || state == STATE_ESTABLISHED) {
+    state = STATE_GOODBYE;
+  } else {
+    state = STATE_STOPPED;
+  }
+  memset(pending_answers, 0, sizeof(pending_answers));
+  unicast_answers = 0;
+  legacy_answers = 0;
+}
+
+void Responder::hostname(char* p_name_buffer, const int name_buffer_len) const {
+  if (host_rename_count == 0) {
+    snprintf(p_name_buffer, name_buffer_len, "%s", host);
+  } else {
+    snprintf(p_name_buffer, name_buffer_len, "%s-%u", host, host_rename_count +1);
+  }
+}
+
+bool Responder::GetRecordInfo(const unsigned int r, RecordInfo* info) const {
+  if (r == 0) {
+    info->rrtype = MDNS_TYPE_A;
+    info->unique = true;
+    info->rrttl = MDNS_RESPONDER_HOST_TTL;
+    return true;
+  }
+  const unsigned int service = (r -1) / 4;
+  if (r >= MDNS_RESPONDER_MAX_RECORDS || !services[service].used) {
+    return false;
+  }
+  switch ((r -1) % 4) {
+    case KIND_PTR:
+      info->rrtype = MDNS_TYPE_PTR;
+      info->unique = false;
+      info->rrttl = MDNS_RESPONDER_OTHER_TTL;
+      return true;
+    case KIND_SRV:
+      info->rrtype = MDNS_TYPE_SRV;
+      info->unique = true;
+      info->rrttl = MDNS_RESPONDER_HOST_TTL;
+      return true;
+    case KIND_TXT:
+      info->rrtype = MDNS_TYPE_TXT;
+      info->unique = true;
+      info->rrttl = MDNS_RESPONDER_OTHER_TTL;
+      return true;
+    default:
+      // Only one enumeration record per service type.
+      for (unsigned int i = 0; i < service; i++) {
+        if (services[i].used && sameName(services[i].service_type, services[service].service_type)) {
+          return false;
+        }
+      }
+      info->rrtype = MDNS_TYPE_PTR;
+      info->unique = false;
+      info->rrttl = MDNS_RESPONDER_OTHER_TTL;
+      return true;
+  }
+}
+
+void Responder::RecordName(const unsigned int r, char* p_name_buffer, const int name_buffer_len) const {
+  if (r == 0) {
+    hostname(p_name_buffer, name_buffer_len);
+    const unsigned int name_len = strlen(p_name_buffer);
+    snprintf(p_name_buffer + name_len, name_buffer_len - name_len, ".local");
+    return;
+  }
+  const ResponderService& service = services[(r -1) / 4];
+  switch ((r -1) % 4) {
+    case KIND_PTR:
+      snprintf(p_name_buffer, name_buffer_len, "%s.local", service.service_type);
+      break;
+    case KIND_ENUM:
+      snprintf(p_name_buffer, name_buffer_len, "_services._dns-sd._udp.local");
+      break;
+    default:
+      if (service.rename_count == 0) {
+        snprintf(p_name_buffer, name_buffer_len, "%s.%s.local", service.instance,
+                 service.service_type);
+      } else {
+        snprintf(p_name_buffer, name_buffer_len, "%s (%u).%s.local", service.instance,
+                 service.rename_count +1, service.service_type);
+      }
+  }
+}
+
+unsigned int Responder::RecordData(const unsigned int r, byte* p_rdata,
+                                   const unsigned int rdata_len) const {
+  char name_buffer[MAX_MDNS_NAME_LEN];
+  if (r == 0) {
+    if (rdata_len < 4) {
+      return 0;
+    }
+    for (unsigned int i = 0; i < 4; i++) {
+      p_rdata[i] = addresses[current_interface][i];
+    }
+    return 4;
+  }
+  const ResponderService& service = services[(r -1) / 4];
+  switch ((r -1) % 4) {
+    case KIND_PTR:
+      // Points at the SRV and TXT records' name.
+      RecordName(r + KIND_SRV - KIND_PTR, name_buffer, MAX_MDNS_NAME_LEN);
+      return wireName(name_buffer, p_rdata, rdata_len);
+    case KIND_SRV: {
+      if (rdata_len < 6) {
+        return 0;
+      }
+      // Priority and weight are both 0.
+      memset(p_rdata, 0, 4);
+      p_rdata[4] = (service.port & 0xFF00) >> 8;
+      p_rdata[5] = service.port & 0xFF;
+      RecordName(0, name_buffer, MAX_MDNS_NAME_LEN);
+      const unsigned int name_len = wireName(name_buffer, p_rdata + 6, rdata_len - 6);
+      return name_len ? 6 + name_len : 0;
+    }
+    case KIND_TXT:
+      // An empty TXT record is a single zero length string. (RFC 6763 6.1)
+      if (service.txt_len == 0) {
+        if (rdata_len < 1) {
+          return 0;
+        }
+        p_rdata[0] = 0;
+        return 1;
+      }
+      if (rdata_len < service.txt_len) {
+        return 0;
+      }
+      memcpy(p_rdata, service.txt_buffer, service.txt_len);
+      return service.txt_len;
+    default:
+      RecordName(r - KIND_ENUM + KIND_PTR, name_buffer, MAX_MDNS_NAME_LEN);
+      return wireName(name_buffer, p_rdata, rdata_len);
+  }
+}
+
+bool Responder::AddRecord(MDns* mdns, const unsigned int r, const byte section,
+                          const bool goodbye, const bool legacy) const {
+  RecordInfo info;
+  if (!GetRecordInfo(r, &info)) {
+    return true;
+  }
+  char name_buffer[MAX_MDNS_NAME_LEN];
+  char target_buffer[MAX_MDNS_NAME_LEN];
+  RecordName(r, name_buffer, MAX_MDNS_NAME_LEN);
+  unsigned long int rrttl = goodbye ? 0 : info.rrttl;
+  if (legacy && rrttl > MDNS_LEGACY_TTL) {
+    rrttl = MDNS_LEGACY_TTL;
+  }
+  // Probes and legacy replies carry no cache flush bit. (RFC 6762 10.2)
+  const bool flush = info.unique && section != MDNS_SECTION_AUTHORITY && !legacy;
+
+  if (r == 0) {
+    return mdns->AddRecordA(section, name_buffer, addresses[current_interface], rrttl, flush);
+  }
+  const ResponderService& service = services[(r -1) / 4];
+  switch ((r -1) % 4) {
+    case KIND_PTR:
+      RecordName(r + KIND_SRV - KIND_PTR, target_buffer, MAX_MDNS_NAME_LEN);
+      return mdns->AddRecordPTR(section, name_buffer, target_buffer, rrttl, flush);
+    case KIND_SRV:
+      RecordName(0, target_buffer, MAX_MDNS_NAME_LEN);
+      return mdns->AddRecordSRV(section, name_buffer, 0, 0, service.port, target_buffer, rrttl,
+                                flush);
+    case KIND_TXT: {
+      // txt_buffer is already in wire format.
+      byte rdata_buffer[MDNS_RESPONDER_TXT_LEN];
+      const unsigned int rdlength = RecordData(r, rdata_buffer, sizeof(rdata_buffer));
+      return mdns->AddRecord(section, name_buffer, MDNS_TYPE_TXT, MDNS_CLASS_IN, flush, rrttl,
+                             rdata_buffer, rdlength);
+    }
+    default:
+      RecordName(r - KIND_ENUM + KIND_PTR, target_buffer, MAX_MDNS_NAME_LEN);
+      return mdns->AddRecordPTR(section, name_buffer, target_buffer, rrttl, flush);
+  }
+}
+
+uint32_t Responder::AdditionalRecords(const uint32_t answers) const {
+  uint32_t additional = 0;
+  for (unsigned int service = 0; service < MDNS_RESPONDER_MAX_SERVICES; service++) {
+    const unsigned int base = 1 + 4 * service;
+    if (answers & (1UL << (base + KIND_PTR))) {
+      additional |= (1UL << (base + KIND_SRV)) | (1UL << (base + KIND_TXT)) | 1UL;
+    }
+    if (answers & (1UL << (base + KIND_SRV))) {
+      additional |= 1UL;
+    }
+  }
+  return additional;
+}
+
+uint32_t Responder::MatchingRecords(const RecordView* view) const {
+  // Compare hashes first so the name only gets decoded if it is probably ours.
+  const uint32_t view_hash = view->nameHash();
+  uint32_t matches = 0;
+  for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+    RecordInfo info;
+    if (name_hashes[r] == view_hash && GetRecordInfo(r, &info)) {
+      matches |= (1UL << r);
+    }
+  }
+  if (matches == 0) {
+    return 0;
+  }
+
+  char view_name[MAX_MDNS_NAME_LEN];
+  char record_name[MAX_MDNS_NAME_LEN];
+  if (view->name(view_name, MAX_MDNS_NAME_LEN) < 0) {
+    return 0;
+  }
+  for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+    if (matches & (1UL << r)) {
+      RecordName(r, record_name, MAX_MDNS_NAME_LEN);
+      if (!sameName(view_name, record_name)) {
+        matches &= ~(1UL << r);
+      }
+    }
+  }
+  return matches;
+}
+
+int Responder::CompareData(const RecordView* view, const unsigned int r) const {
+  byte ours[MAX_MDNS_NAME_LEN + MDNS_RESPONDER_TXT_LEN];
+  const unsigned int ours_len = RecordData(r, ours, sizeof(ours));
+
+  // Names in the resource data may be compressed so expand them first.
+  byte theirs_buffer[MAX_MDNS_NAME_LEN + 6];
+  const byte* theirs = view->rdata();
+  int theirs_len = view->rdlength();
+  const unsigned int rrtype = view->rrtype();
+  if (rrtype == MDNS_TYPE_PTR || rrtype == MDNS_TYPE_SRV) {
+    const unsigned int fixed_len = (rrtype == MDNS_TYPE_SRV) ? 6 : 0;
+    if ((unsigned int)theirs_len < fixed_len +1) {
+      return -1;
+    }
+    memcpy(theirs_buffer, theirs, fixed_len);
+    const int expanded_len = expandDnsName(theirs_buffer + fixed_len, MAX_MDNS_NAME_LEN,
+                                           view->packet(), view->rdataOffset() + fixed_len,
+                                           view->packetSize());
+    if (expanded_len < 0) {
+      return -1;
+    }
+    theirs = theirs_buffer;
+    theirs_len = fixed_len + expanded_len;
+  }
+
+  const unsigned int common_len = ((unsigned int)theirs_len < ours_len) ? theirs_len : ours_len;
+  const int result = memcmp(theirs, ours, common_len);
+  if (result != 0) {
+    return result;
+  }
+  return theirs_len - (int)ours_len;
+}
+
+void Responder::Rehash() {
+  char name_buffer[MAX_MDNS_NAME_LEN];
+  for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+    RecordInfo info;
+    if (GetRecordInfo(r, &info)) {
+      RecordName(r, name_buffer, MAX_MDNS_NAME_LEN);
+      name_hashes[r] = nameHash(name_buffer);
+    } else {
+      name_hashes[r] = 0;
+    }
+  }
+  match_name_id = MDNS_NAME_ID_NONE;
+}
+
+void Responder::StartProbing(const uint32_t start) {
+  state = STATE_PROBING;
+  send_count = 0;
+  next_time = start;
+  memset(pending_answers, 0, sizeof(pending_answers));
+  unicast_answers = 0;
+  legacy_answers = 0;
+  for (unsigned int i = 0; i < MDNS_MAX_INTERFACES; i++) {
+    for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+      last_sent[i][r] = start - MDNS_RESPONSE_RATE_LIMIT;
+    }
+  }
+}
+
+void Responder::Conflict(const unsigned int r) {
+#ifdef DEBUG_OUTPUT
+  MDNS_DEBUG_SERIAL.print(" Responder name conflict on record ");
+  MDNS_DEBUG_SERIAL.println(r);
+#endif
+  if (state == STATE_PROBING) {
+    // Pick a new name. (RFC 6762 9)
+    if (r == 0) {
+      host_rename_count++;
+      // Every SRV record contains the host name.
+    } else {
+      services[(r -1) / 4].rename_count++;
+    }
+    Rehash();
+  }
+  StartProbing(millis());
+}
+
+bool Responder::StartPacket(MDns* mdns, const unsigned int interface_index) {
+  if ((uint32_t)addresses[interface_index] == 0) {
+    return false;
+  }
+  current_interface = interface_index;
+  mdns->Clear();
+  mdns->SetInterface(interface_index);
+  return true;
+}
+
+void Responder::SendProbe(MDns* mdns) {
+  for (unsigned int i = 0; i < mdns->interfaceCount(); i++) {
+    if (!StartPacket(mdns, i)) {
+      continue;
+    }
+    mdns->SetAutoFlush(true);
+
+    // Ask about every unique name, requesting unicast replies. (RFC 6762 8.1)
+    Query query;
+    query.qtype = MDNS_TYPE_ANY;
+    query.qclass = MDNS_CLASS_IN;
+    query.unicast_response = true;
+    for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+      RecordInfo info;
+      // SRV and TXT share a name so only ask about one of them.
+      if (GetRecordInfo(r, &info) && info.unique && info.rrtype != MDNS_TYPE_TXT) {
+        RecordName(r, query.qname_buffer, MAX_MDNS_NAME_LEN);
+        mdns->AddQuery(query);
+      }
+    }
+
+    // The records we intend to use go in the Authority section for the
+    // simultaneous probe tie-break. (RFC 6762 8.2)
+    for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+      RecordInfo info;
+      if (GetRecordInfo(r, &info) && info.unique) {
+        AddRecord(mdns, r, MDNS_SECTION_AUTHORITY, false);
+      }
+    }
+    mdns->Send();
+  }
+}
+
+void Responder::SendAnnouncement(MDns* mdns, const bool goodbye) {
+  const uint32_t now = millis();
+  for (unsigned int i = 0; i < mdns->interfaceCount(); i++) {
+    if (!StartPacket(mdns, i)) {
+      continue;
+    }
+    mdns->SetResponse(true);
+    mdns->SetAutoFlush(true);
+    for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+      RecordInfo info;
+      if (GetRecordInfo(r, &info) && AddRecord(mdns, r, MDNS_SECTION_ANSWER, goodbye)) {
+        last_sent[i][r] = now;
+      }
+    }
+    mdns->Send();
+  }
+}
+
+void Responder::SendResponse(MDns* mdns, const uint32_t now) {
+  for (unsigned int i = 0; i < mdns->interfaceCount(); i++) {
+    uint32_t answers = pending_answers[i];
+    pending_answers[i] = 0;
+
+    // Don't multicast the same record more than once a second. (RFC 6762 6.2)
+    for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+      if ((answers & (1UL << r)) && now - last_sent[i][r] < MDNS_RESPONSE_RATE_LIMIT) {
+        answers &= ~(1UL << r);
+        MDNS_STAT(mdns->stats().responses_suppressed++);
+      }
+    }
+    if (answers == 0 || !StartPacket(mdns, i)) {
+      continue;
+    }
+    const uint32_t additional = AdditionalRecords(answers) & ~answers;
+
+    mdns->SetResponse(true);
+    mdns->SetAutoFlush(true);
+    for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+      if ((answers & (1UL << r)) && AddRecord(mdns, r, MDNS_SECTION_ANSWER, false)) {
+        last_sent[i][r] = now;
+      }
+    }
+    for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+      if (additional & (1UL << r)) {
+        AddRecord(mdns, r, MDNS_SECTION_ADDITIONAL, false);
+      }
+    }
+    mdns->Send();
+    MDNS_STAT(mdns->stats().responses_sent += 1 + mdns->flushCount());
+  }
+}
+
+void Responder::SendUnicast(MDns* mdns) {
+  const uint32_t answers = unicast_answers;
+  unicast_answers = 0;
+  if (!StartPacket(mdns, unicast_interface)) {
+    return;
+  }
+  const uint32_t additional = AdditionalRecords(answers) & ~answers;
+
+  mdns->SetResponse(true);
+  for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+    if ((answers & (1UL << r)) && !AddRecord(mdns, r, MDNS_SECTION_ANSWER, false)) {
+      break;
+    }
+  }
+  for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+    if ((additional & (1UL << r)) && !AddRecord(mdns, r, MDNS_SECTION_ADDITIONAL, false)) {
+      break;
+    }
+  }
+  mdns->Send(unicast_ip, MDNS_TARGET_PORT);
+  MDNS_STAT(mdns->stats().responses_sent++);
+}
+
+void Responder::SendLegacy(MDns* mdns) {
+  const uint32_t answers = legacy_answers;
+  legacy_answers = 0;
+  if (!StartPacket(mdns, legacy_interface)) {
+    return;
+  }
+  mdns->SetId(legacy_id);
+
+  // The reply repeats the Question. (RFC 6762 6.7)
+  Query query;
+  query.qclass = MDNS_CLASS_IN;
+  query.unicast_response = false;
+  for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+    RecordInfo info;
+    if ((answers & (1UL << r)) && GetRecordInfo(r, &info)) {
+      RecordName(r, query.qname_buffer, MAX_MDNS_NAME_LEN);
+      query.qtype = info.rrtype;
+      mdns->AddQuery(query);
+    }
+  }
+  // After the questions since AddQuery() marks the packet as a Query.
+  mdns->SetResponse(true);
+  for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+    if ((answers & (1UL << r)) && !AddRecord(mdns, r, MDNS_SECTION_ANSWER, false, true)) {
+      break;
+    }
+  }
+  mdns->Send(legacy_ip, legacy_port);
+  MDNS_STAT(mdns->stats().responses_sent++);
+}
+
+bool Responder::Pending() const {
+  if (unicast_answers) {
+    return true;
+  }
+  for (unsigned int i = 0; i < MDNS_MAX_INTERFACES; i++) {
+    if (pending_answers[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Responder::onPacket(MDns* mdns) {
+  current_interface = mdns->packetInterface();
+  packet_answers = 0;
+  packet_known = 0;
+  packet_unicast = 0;
+  match_name_id = MDNS_NAME_ID_NONE;
+}
+
+void Responder::onRecord(MDns* mdns, const RecordView* view) {
+  if (state == STATE_IDLE || state == STATE_STOPPED || state == STATE_GOODBYE ||
+      (uint32_t)addresses[current_interface] == 0 ||
+      mdns->remoteIP() == addresses[current_interface]) {
+    return;
+  }
+  if (view->rrclass() != MDNS_CLASS_IN && view->rrclass() != MDNS_CLASS_ANY) {
+    return;
+  }
+  // Questions and Known-Answers for one name usually come together.
+  const unsigned int name_id = view->nameId();
+  if (name_id == MDNS_NAME_ID_NONE || name_id != match_name_id) {
+    match_name_id = name_id;
+    match_records = MatchingRecords(view);
+  }
+  const uint32_t matches = match_records;
+  if (matches == 0) {
+    return;
+  }
+  const unsigned int rrtype = view->rrtype();
+
+  for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+    RecordInfo info;
+    if ((matches & (1UL << r)) == 0 || !GetRecordInfo(r, &info)) {
+      continue;
+    }
+
+    if (!mdns->isQuery()) {
+      // Somebody else answering with a different version of a record only we
+      // should have. (RFC 6762 9)
+      if (info.unique && rrtype == info.rrtype && CompareData(view, r) != 0) {
+        Conflict(r);
+        return;
+      }
+    } else if (view->isQuery()) {
+      // Don't answer until our names have been probed.
+      if (state != STATE_PROBING && (rrtype == info.rrtype || rrtype == MDNS_TYPE_ANY)) {
+        packet_answers |= (1UL << r);
+        if (view->rrset()) {
+          packet_unicast |= (1UL << r);
+        }
+      }
+    } else if (view->section() == MDNS_SECTION_ANSWER) {
+      // Known-Answer with at least half its TTL left. (RFC 6762 7.1)
+      if (rrtype == info.rrtype && view->rrttl() * 2 >= info.rrttl && CompareData(view, r) == 0) {
+        packet_known |= (1UL << r);
+      }
+    } else if (view->section() == MDNS_SECTION_AUTHORITY && state == STATE_PROBING) {
+      // Another host is probing for the same name. The lexicographically later
+      // data wins. (RFC 6762 8.2)
+      if (info.unique && rrtype == info.rrtype && CompareData(view, r) > 0) {
+        StartProbing(millis() + MDNS_PROBE_DEFER);
+        return;
+      }
+    }
+  }
+}
+
+void Responder::onPacketEnd(MDns* mdns) {
+  if (!mdns->isQuery()) {
+    return;
+  }
+  const uint32_t answers = packet_answers & ~packet_known;
+  MDNS_STAT(mdns->stats().responses_suppressed += __builtin_popcountl(packet_answers & packet_known));
+  if (answers == 0) {
+    return;
+  }
+
+  if (mdns->remotePort() != MDNS_SOURCE_PORT) {
+    // Legacy unicast Query. Only the asker wants this. (RFC 6762 6.7)
+    legacy_answers = answers;
+    legacy_ip = mdns->remoteIP();
+    legacy_port = mdns->remotePort();
+    legacy_id = mdns->packetId();
+    legacy_interface = current_interface;
+    return;
+  }
+
+  // Records asked for by QU questions which were multicast recently enough
+  // are sent straight back to the asker. (RFC 6762 5.4)
+  const uint32_t now = millis();
+  uint32_t unicast = 0;
+  for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+    RecordInfo info;
+    if ((answers & packet_unicast & (1UL << r)) && GetRecordInfo(r, &info) &&
+        now - last_sent[current_interface][r] < info.rrttl * 250) {
+      unicast |= (1UL << r);
+    }
+  }
+  if (unicast && unicast_answers &&
+      (unicast_ip != mdns->remoteIP() || unicast_interface != current_interface)) {
+    // Already waiting to answer another host. Multicast these instead.
+    unicast = 0;
+  }
+  if (!mdns->remoteIPKnown()) {
+    // No address to send them to.
+    unicast = 0;
+  }
+  if (unicast) {
+    unicast_answers |= unicast;
+    unicast_ip = mdns->remoteIP();
+    unicast_interface = current_interface;
+  }
+
+  // Answers made up only of records nobody else can have go straight away.
+  // Otherwise wait a while so answers from several hosts don't collide.
+  // (RFC 6762 6) A truncated Query will be followed by more Known-Answers.
+  // (RFC 6762 7.2) MDns::setReassemblyBuffer() avoids this by waiting for them
+  // before any records arrive here.
+  uint32_t delay = 0;
+  if (mdns->isTruncated()) {
+    delay = random(MDNS_TRUNCATED_WAIT_MIN, MDNS_TRUNCATED_WAIT_MAX);
+  } else {
+    for (unsigned int r = 0; r < MDNS_RESPONDER_MAX_RECORDS; r++) {
+      RecordInfo info;
+      if ((answers & (1UL << r)) && GetRecordInfo(r, &info) && !info.unique) {
+        delay = random(MDNS_RESPONSE_DELAY_MIN, MDNS_RESPONSE_DELAY_MAX);
+        break;
+      }
+    }
+  }
+
+  const uint32_t send_time = now + delay;
+  if (!Pending() || timeBefore(send_time, response_time)) {
+    response_time = send_time;
+  }
+  pending_answers[current_interface] |= answers & ~unicast;
+}
+
+void Responder::poll(MDns* mdns) {
+  if (state == STATE_STOPPED) {
+    return;
+  }
+  if (state == STATE_GOODBYE) {
+    SendAnnouncement(mdns, true);
+    state = STATE_STOPPED;
+    return;
+  }
+
+  const uint32_t now = millis();
+  bool have_address = false;
+  bool address_changed = false;
+  for (unsigned int i = 0; i < mdns->interfaceCount(); i++) {
+    const IPAddress local_ip = mdns->localIP(i);
+    if (local_ip != addresses[i]) {
+      addresses[i] = local_ip;
+      address_changed = true;
+    }
+    have_address |= ((uint32_t)local_ip != 0);
+  }
+  if (!have_address) {
+    state = STATE_IDLE;
+    return;
+  }
+  if (state == STATE_IDLE || address_changed) {
+    // Wait a random time before the first probe. (RFC 6762 8.1)
+    StartProbing(now + random(0, MDNS_PROBE_INTERVAL));
+  }
+
+  if (state == STATE_PROBING && !timeBefore(now, next_time)) {
+    SendProbe(mdns);
+    next_time = now + MDNS_PROBE_INTERVAL;
+    if (++send_count >= MDNS_PROBE_COUNT) {
+      state = STATE_ANNOUNCING;
+      send_count = 0;
+    }
+  } else if (state == STATE_ANNOUNCING && !timeBefore(now, next_time)) {
+    SendAnnouncement(mdns, false);
+    next_time = now + MDNS_ANNOUNCE_INTERVAL;
+    if (++send_count >= MDNS_ANNOUNCE_COUNT) {
+      state = STATE_ESTABLISHED;
+    }
+  }
+
+  if ((state == STATE_ANNOUNCING || state == STATE_ESTABLISHED) && legacy_answers) {
+    SendLegacy(mdns);
+  }
+  if ((state == STATE_ANNOUNCING || state == STATE_ESTABLISHED) && Pending() &&
+      !timeBefore(now, response_time)) {
+    SendResponse(mdns, now);
+    if (unicast_answers) {
+      SendUnicast(mdns);
+    }
+  }
+}
+
+} // namespace mdns
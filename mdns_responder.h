@@ -0,0 +1,249 @@
+#ifndef MDNS_RESPONDER_H
+#define MDNS_RESPONDER_H
+
+#include <Arduino.h>
+#include "mdns.h"
+
+// Longest host or instance label. Leaves room for a suffix added to make the
+// name unique after a conflict. (RFC 6762 9)
+#define MDNS_RESPONDER_LABEL_LEN 56
+
+// Longest service type. eg: "_http._tcp".
+#define MDNS_RESPONDER_TYPE_LEN 32
+
+// TTL of records containing a host name. (RFC 6762 10) (seconds)
+#define MDNS_RESPONDER_HOST_TTL 120
+
+// TTL of all other records. (RFC 6762 10) (seconds)
+#define MDNS_RESPONDER_OTHER_TTL 4500
+
+// Time between probes and how many are sent. (RFC 6762 8.1) (milliseconds)
+#define MDNS_PROBE_INTERVAL 250
+#define MDNS_PROBE_COUNT 3
+
+// How long to wait before probing again after losing a simultaneous probe
+// tie-break. (RFC 6762 8.2) (milliseconds)
+#define MDNS_PROBE_DEFER 1000
+
+// Time between announcements and how many are sent. (RFC 6762 8.3) (milliseconds)
+#define MDNS_ANNOUNCE_INTERVAL 1000
+#define MDNS_ANNOUNCE_COUNT 2
+
+// Random delay before answering a Query which may have several responders.
+// (RFC 6762 6) (milliseconds)
+#define MDNS_RESPONSE_DELAY_MIN 20
+#define MDNS_RESPONSE_DELAY_MAX 120
+
+// A record is not multicast again within this long of last being sent.
+// (RFC 6762 6.2) (milliseconds)
+#define MDNS_RESPONSE_RATE_LIMIT 1000
+
+// Longest TTL in replies to legacy unicast Queries. (RFC 6762 6.7) (seconds)
+#define MDNS_LEGACY_TTL 10
+
+// Records: the host's A record then 4 per service. (PTR, SRV, TXT and the
+// DNS-SD service type enumeration PTR.)
+#define MDNS_RESPONDER_MAX_RECORDS (1 + 4 * MDNS_RESPONDER_MAX_SERVICES)
+#if MDNS_RESPONDER_MAX_RECORDS > 32
+#error "MDNS_RESPONDER_MAX_SERVICES too large. Records are tracked in a 32 bit mask."
+#endif
+
+namespace mdns {
+
+// A service advertised by a Responder.
+typedef struct ResponderService {
+  char instance[MDNS_RESPONDER_LABEL_LEN];     // Instance label. eg: "Kitchen sensor"
+  char service_type[MDNS_RESPONDER_TYPE_LEN];  // eg: "_http._tcp"
+  unsigned int port;
+  byte txt_buffer[MDNS_RESPONDER_TXT_LEN];     // Resource data of the TXT record.
+  unsigned int txt_len;                        // Bytes used in txt_buffer.
+  unsigned int rename_count;                   // Times the instance has been renamed after a conflict.
+  bool used;
+} ResponderService;
+
+// Advertises a host name and services on the network and answers Queries for
+// them. (RFC 6762 and RFC 6763)
+// Names are probed for and announced before being used. Incoming Queries are
+// matched against a table of name hashes so uninteresting ones are rejected
+// without decoding them. Answers wait the random delay RFC 6762 asks for so
+// they can be gathered into one packet with their additional records, and no
+// record is multicast more than once a second.
+//
+// Conflict handling is simplified: A conflicting name found while probing is
+// renamed ("host-2", "instance (2)") and probed again. A conflict afterwards
+// starts probing again.
+//
+// With several MDns interfaces each gets its own A record holding that
+// interface's address, and Queries are answered only on the interface they
+// arrived on.
+//
+// Questions asking for a unicast response (QU) are answered by unicast if the
+// record was multicast within the last quarter of its TTL, otherwise by
+// multicast. (RFC 6762 5.4) Queries from a port other than 5353 are legacy
+// unicast Queries and get a unicast reply straight away. (RFC 6762 6.7)
+// Only one of each unicast reply waits at a time.
+//
+// Attach to an MDns with MDns::addListener(). Nothing is sent until one of the
+// MDns interfaces has a local IP address.
+class Responder : public Listener {
+ public:
+  // Args:
+  //   hostname_ : Host name without the ".local". eg: "esp8266".
+  Responder(const char* hostname_);
+
+  // Advertise a service.
+  // Args:
+  //   instance : Instance label. eg: "Kitchen sensor". Must not contain '.'.
+  //   service_type : eg: "_http._tcp".
+  //   port : Port the service listens on.
+  // Returns an id for AddServiceTxt() or -1 if there is no space.
+  int AddService(const char* instance, const char* service_type, const unsigned int port);
+
+  // Append a "key=value" string to the TXT record of a service.
+  // Returns false if there is no space left.
+  bool AddServiceTxt(const int service, const char* txt_string);
+
+  // Send goodbye packets for everything and stop responding.
+  void Stop();
+
+  // Host name currently in use, which may differ from the one asked for
+  // after a conflict. Without the ".local".
+  void hostname(char* p_name_buffer, const int name_buffer_len) const;
+
+  // True once probing and announcing have completed.
+  bool established() const { return state == STATE_ESTABLISHED; }
+
+  // Listener interface.
+  void onPacket(MDns* mdns);
+  void onRecord(MDns* mdns, const RecordView* view);
+  void onPacketEnd(MDns* mdns);
+  void poll(MDns* mdns);
+
+ private:
+  enum State {
+    STATE_IDLE,         // No address yet.
+    STATE_PROBING,
+    STATE_ANNOUNCING,
+    STATE_ESTABLISHED,
+    STATE_GOODBYE,      // Stop() called. Goodbyes go on the next poll().
+    STATE_STOPPED
+  };
+
+  // Kinds of record. Record index r is: 0 for the host's A record, otherwise
+  // 1 + 4 * service + kind.
+  enum RecordKind {
+    KIND_PTR = 0,       // Service type -> instance.
+    KIND_SRV = 1,       // Instance -> host and port.
+    KIND_TXT = 2,       // Instance -> TXT strings.
+    KIND_ENUM = 3       // "_services._dns-sd._udp.local" -> service type.
+  };
+
+  // Describes one of our records.
+  typedef struct RecordInfo {
+    unsigned int rrtype;
+    bool unique;                // Only we may have this name and type. (Sets cache flush bit.)
+    unsigned long int rrttl;
+  } RecordInfo;
+
+  // Returns false if record r is not in use.
+  bool GetRecordInfo(const unsigned int r, RecordInfo* info) const;
+
+  // Write the name of record r to p_name_buffer.
+  void RecordName(const unsigned int r, char* p_name_buffer, const int name_buffer_len) const;
+
+  // Write the uncompressed resource data of record r to p_rdata.
+  // Returns its length or 0 on failure.
+  unsigned int RecordData(const unsigned int r, byte* p_rdata, const unsigned int rdata_len) const;
+
+  // Add record r to section of the packet mdns is building.
+  // legacy : For a legacy unicast reply. Caps the TTL and clears the cache
+  //          flush bit. (RFC 6762 6.7)
+  bool AddRecord(MDns* mdns, const unsigned int r, const byte section, const bool goodbye,
+                 const bool legacy = false) const;
+
+  // Records worth sending as additional records alongside answers.
+  // (RFC 6763 12)
+  uint32_t AdditionalRecords(const uint32_t answers) const;
+
+  // Find which of our records the record in view has the same name as.
+  // Returns a bit mask of records.
+  uint32_t MatchingRecords(const RecordView* view) const;
+
+  // Compare the resource data in view with that of record r.
+  // Returns <0, 0 or >0 like memcmp().
+  int CompareData(const RecordView* view, const unsigned int r) const;
+
+  // Recalculate name_hashes after a name changes.
+  void Rehash();
+
+  // Probe for our names again starting at time start.
+  void StartProbing(const uint32_t start);
+
+  // Another host is using one of our unique names.
+  void Conflict(const unsigned int r);
+
+  // True if any interface has answers waiting.
+  bool Pending() const;
+
+  // Start a packet for interface_index. Returns false if the interface has no
+  // address so nothing should be sent on it.
+  bool StartPacket(MDns* mdns, const unsigned int interface_index);
+
+  // Each sends a packet on every interface which has an address.
+  void SendProbe(MDns* mdns);
+  void SendAnnouncement(MDns* mdns, const bool goodbye);
+  void SendResponse(MDns* mdns, const uint32_t now);
+
+  // Send the answers waiting in unicast_answers or legacy_answers.
+  void SendUnicast(MDns* mdns);
+  void SendLegacy(MDns* mdns);
+
+  char host[MDNS_RESPONDER_LABEL_LEN];
+  unsigned int host_rename_count;
+  ResponderService services[MDNS_RESPONDER_MAX_SERVICES];
+
+  // nameHash() of the name of each record.
+  uint32_t name_hashes[MDNS_RESPONDER_MAX_RECORDS];
+
+  // millis() each record was last multicast on each interface.
+  uint32_t last_sent[MDNS_MAX_INTERFACES][MDNS_RESPONDER_MAX_RECORDS];
+
+  State state;
+  uint32_t next_time;         // millis() of the next probe or announcement.
+  unsigned int send_count;    // Probes or announcements sent so far.
+  IPAddress addresses[MDNS_MAX_INTERFACES];  // Address of each MDns interface.
+  unsigned int current_interface;            // Interface being sent or received on.
+
+  // Records asked for by the current incoming packet and those it already
+  // has as Known-Answers.
+  uint32_t packet_answers;
+  uint32_t packet_known;
+
+  // Records asked for by questions with the QU bit set.
+  uint32_t packet_unicast;
+
+  // MatchingRecords() of the last record in the current packet with a valid
+  // RecordView::nameId(). Records sharing a name reuse it.
+  unsigned int match_name_id;
+  uint32_t match_records;
+
+  // Records waiting to be sent on each interface and when.
+  uint32_t pending_answers[MDNS_MAX_INTERFACES];
+  uint32_t response_time;
+
+  // Records waiting to be sent by unicast at response_time, and to whom.
+  uint32_t unicast_answers;
+  IPAddress unicast_ip;
+  unsigned int unicast_interface;
+
+  // Reply to a legacy unicast Query waiting for the next poll().
+  uint32_t legacy_answers;
+  IPAddress legacy_ip;
+  uint16_t legacy_port;
+  uint16_t legacy_id;
+  unsigned int legacy_interface;
+};
+
+} // namespace mdns
+
+#endif  // MDNS_RESPONDER_H
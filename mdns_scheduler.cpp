@@ -0,0 +1,338 @@
+#include <Arduino.h>
+#include "mdns_scheduler.h"
+
+
+namespace mdns {
+
+ResponseScheduler::ResponseScheduler() :
+  heap_count(0),
+  arena_used(0),
+  current_interface(0),
+  current_source(0) {
+  for (unsigned int i = 0; i < MDNS_SCHEDULER_MAX_RECORDS; i++) {
+    entries[i].used = false;
+  }
+}
+
+void ResponseScheduler::Clear() {
+  for (unsigned int i = 0; i < MDNS_SCHEDULER_MAX_RECORDS; i++) {
+    entries[i].used = false;
+  }
+  heap_count = 0;
+  arena_used = 0;
+}
+
+bool ResponseScheduler::Schedule(const byte section, const char* name, const unsigned int rrtype,
+                                 const unsigned int rrclass, const bool rrset,
+                                 const unsigned long int rrttl, const byte* rdata,
+                                 const unsigned int rdlength, const unsigned int delay) {
+  const uint32_t due = millis() + delay;
+  const uint32_t name_hash = nameHash(name);
+
+  const int found = Find(name_hash, name, rrtype, rrclass, rdata, rdlength, current_interface);
+  if (found >= 0) {
+    // Already queued. Send it once, at the earlier time and in the earlier
+    // section.
+    ScheduledRecord& entry = entries[found];
+    AddAsker(found);
+    if (section < entry.section) {
+      entry.section = section;
+    }
+    if (timeBefore(due, entry.due)) {
+      entry.due = due;
+      SiftUp(entry.heap_pos);
+    }
+    return true;
+  }
+
+  const unsigned int name_len = strlen(name) +1;
+  if (heap_count >= MDNS_SCHEDULER_MAX_RECORDS || name_len > 255 ||
+      name_len + rdlength > MDNS_SCHEDULER_ARENA_SIZE) {
+    return false;
+  }
+  if (arena_used + name_len + rdlength > MDNS_SCHEDULER_ARENA_SIZE) {
+    Compact();
+    if (arena_used + name_len + rdlength > MDNS_SCHEDULER_ARENA_SIZE) {
+      return false;
+    }
+  }
+
+  unsigned int index = 0;
+  while (entries[index].used) {
+    index++;
+  }
+  ScheduledRecord& entry = entries[index];
+  entry.due = due;
+  entry.name_hash = name_hash;
+  entry.rrttl = rrttl;
+  entry.rrtype = rrtype;
+  entry.rrclass = rrclass;
+  entry.data_offset = arena_used;
+  entry.rdlength = rdlength;
+  entry.name_len = name_len;
+  entry.section = section;
+  entry.interface_index = current_interface;
+  entry.rrset = rrset;
+  entry.used = true;
+  entry.asker_count = 0;
+  entry.askers_known = 0;
+  AddAsker(index);
+  memcpy(arena + arena_used, name, name_len);
+  memcpy(arena + arena_used + name_len, rdata, rdlength);
+  arena_used += name_len + rdlength;
+
+  entry.heap_pos = heap_count;
+  heap[heap_count++] = index;
+  SiftUp(entry.heap_pos);
+  return true;
+}
+
+int ResponseScheduler::Find(const uint32_t name_hash, const char* name,
+                            const unsigned int rrtype, const unsigned int rrclass,
+                            const byte* rdata, const unsigned int rdlength,
+                            const unsigned int interface_index) const {
+  for (unsigned int pos = 0; pos < heap_count; pos++) {
+    const ScheduledRecord& entry = entries[heap[pos]];
+    if (entry.name_hash == name_hash && entry.rrtype == rrtype && entry.rrclass == rrclass &&
+        entry.rdlength == rdlength && entry.interface_index == interface_index &&
+        memcmp(arena + entry.data_offset + entry.name_len, rdata, rdlength) == 0 &&
+        sameName((const char*)arena + entry.data_offset, name)) {
+      return heap[pos];
+    }
+  }
+  return -1;
+}
+
+void ResponseScheduler::AddAsker(const unsigned int index) {
+  ScheduledRecord& entry = entries[index];
+  if (entry.asker_count > MDNS_SCHEDULER_MAX_ASKERS) {
+    return;
+  }
+  for (unsigned int i = 0; i < entry.asker_count; i++) {
+    if (entry.askers[i] == current_source) {
+      // Asking again. Any Known-Answer comes after the Question.
+      entry.askers_known &= ~(1 << i);
+      return;
+    }
+  }
+  if (entry.asker_count == MDNS_SCHEDULER_MAX_ASKERS || current_source == 0) {
+    // Can't tell when this host has the record so it is always sent.
+    entry.asker_count = MDNS_SCHEDULER_MAX_ASKERS +1;
+    return;
+  }
+  entry.askers[entry.asker_count++] = current_source;
+}
+
+void ResponseScheduler::HeapSwap(const unsigned int a, const unsigned int b) {
+  const byte index = heap[a];
+  heap[a] = heap[b];
+  heap[b] = index;
+  entries[heap[a]].heap_pos = a;
+  entries[heap[b]].heap_pos = b;
+}
+
+void ResponseScheduler::SiftUp(unsigned int pos) {
+  while (pos > 0) {
+    const unsigned int parent = (pos -1) / 2;
+    if (!timeBefore(entries[heap[pos]].due, entries[heap[parent]].due)) {
+      return;
+    }
+    HeapSwap(pos, parent);
+    pos = parent;
+  }
+}
+
+void ResponseScheduler::SiftDown(unsigned int pos) {
+  while (true) {
+    const unsigned int left = 2 * pos +1;
+    const unsigned int right = left +1;
+    unsigned int earliest = pos;
+    if (left < heap_count && timeBefore(entries[heap[left]].due, entries[heap[earliest]].due)) {
+      earliest = left;
+    }
+    if (right < heap_count && timeBefore(entries[heap[right]].due, entries[heap[earliest]].due)) {
+      earliest = right;
+    }
+    if (earliest == pos) {
+      return;
+    }
+    HeapSwap(pos, earliest);
+    pos = earliest;
+  }
+}
+
+void ResponseScheduler::Remove(const unsigned int index) {
+  const unsigned int pos = entries[index].heap_pos;
+  entries[index].used = false;
+  heap_count--;
+  if (pos < heap_count) {
+    // Fill the hole with the last record and move that to where it belongs.
+    heap[pos] = heap[heap_count];
+    entries[heap[pos]].heap_pos = pos;
+    SiftUp(pos);
+    SiftDown(entries[heap[pos]].heap_pos);
+  }
+  if (heap_count == 0) {
+    arena_used = 0;
+  }
+}
+
+void ResponseScheduler::Compact() {
+  // Repeatedly move the queued record with the lowest offset above the end of
+  // the data already moved down against the start of the arena.
+  unsigned int compacted = 0;
+  while (true) {
+    int lowest = -1;
+    for (unsigned int i = 0; i < MDNS_SCHEDULER_MAX_RECORDS; i++) {
+      if (entries[i].used && entries[i].data_offset >= compacted &&
+          (lowest < 0 || entries[i].data_offset < entries[lowest].data_offset)) {
+        lowest = i;
+      }
+    }
+    if (lowest < 0) {
+      break;
+    }
+    ScheduledRecord& entry = entries[lowest];
+    const unsigned int len = entry.name_len + entry.rdlength;
+    memmove(arena + compacted, arena + entry.data_offset, len);
+    entry.data_offset = compacted;
+    compacted += len;
+  }
+  arena_used = compacted;
+}
+
+void ResponseScheduler::onPacket(MDns* mdns) {
+  current_interface = mdns->packetInterface();
+  current_source = mdns->remoteIPKnown() ? (uint32_t)mdns->remoteIP() : 0;
+}
+
+void ResponseScheduler::onRecord(MDns* mdns, const RecordView* view) {
+  if (heap_count == 0 || view->isQuery() || mdns->remoteIP() == mdns->localIP()) {
+    return;
+  }
+  // A Query lists this record as a Known-Answer (RFC 6762 7.1) or another
+  // host has multicast it. (RFC 6762 7.4)
+  const bool known_answer = mdns->isQuery();
+  if (known_answer && view->section() != MDNS_SECTION_ANSWER) {
+    // Records in the Authority Section of a Query are probes.
+    return;
+  }
+  const uint32_t name_hash = view->nameHash();
+  const unsigned int rrtype = view->rrtype();
+  for (unsigned int pos = 0; pos < heap_count; pos++) {
+    const unsigned int index = heap[pos];
+    ScheduledRecord& entry = entries[index];
+    if (entry.name_hash != name_hash || entry.rrtype != rrtype ||
+        entry.rrclass != view->rrclass() || entry.interface_index != current_interface) {
+      continue;
+    }
+    if (known_answer ? view->rrttl() * 2 < entry.rrttl : view->rrttl() < entry.rrttl) {
+      continue;
+    }
+
+    char name_buffer[MAX_MDNS_NAME_LEN];
+    if (view->name(name_buffer, MAX_MDNS_NAME_LEN) < 0 ||
+        !sameName(name_buffer, (const char*)arena + entry.data_offset)) {
+      continue;
+    }
+
+    // Names in the resource data may be compressed so expand them first.
+    byte theirs_buffer[MAX_MDNS_NAME_LEN + 6];
+    const byte* theirs = view->rdata();
+    int theirs_len = view->rdlength();
+    if (rrtype == MDNS_TYPE_PTR || rrtype == MDNS_TYPE_SRV) {
+      const unsigned int fixed_len = (rrtype == MDNS_TYPE_SRV) ? 6 : 0;
+      if ((unsigned int)theirs_len < fixed_len +1) {
+        continue;
+      }
+      memcpy(theirs_buffer, theirs, fixed_len);
+      const int expanded_len = expandDnsName(theirs_buffer + fixed_len, MAX_MDNS_NAME_LEN,
+                                             view->packet(), view->rdataOffset() + fixed_len,
+                                             view->packetSize());
+      if (expanded_len < 0) {
+        continue;
+      }
+      theirs = theirs_buffer;
+      theirs_len = fixed_len + expanded_len;
+    }
+    if ((unsigned int)theirs_len == entry.rdlength &&
+        memcmp(theirs, arena + entry.data_offset + entry.name_len, theirs_len) == 0) {
+      if (known_answer) {
+        // Only the answer to this host is no longer needed.
+        for (unsigned int i = 0; i < entry.asker_count && i < MDNS_SCHEDULER_MAX_ASKERS; i++) {
+          if (entry.askers[i] == current_source) {
+            entry.askers_known |= (1 << i);
+          }
+        }
+        if (entry.asker_count > MDNS_SCHEDULER_MAX_ASKERS ||
+            entry.askers_known != (1 << entry.asker_count) -1) {
+          return;
+        }
+      }
+      Remove(index);
+      MDNS_STAT(mdns->stats().responses_suppressed++);
+      return;
+    }
+  }
+}
+
+void ResponseScheduler::poll(MDns* mdns) {
+  if (heap_count == 0 || timeBefore(millis(), entries[heap[0]].due)) {
+    return;
+  }
+
+  // Take everything due soon off the heap.
+  const uint32_t window_end = millis() + MDNS_SCHEDULER_WINDOW;
+  byte send_list[MDNS_SCHEDULER_MAX_RECORDS];
+  unsigned int send_count = 0;
+  while (heap_count > 0 && !timeBefore(window_end, entries[heap[0]].due)) {
+    const byte index = heap[0];
+    send_list[send_count++] = index;
+    heap_count--;
+    if (heap_count > 0) {
+      heap[0] = heap[heap_count];
+      entries[heap[0]].heap_pos = 0;
+      SiftDown(0);
+    }
+  }
+
+  for (unsigned int i = 0; i < mdns->interfaceCount(); i++) {
+    Send(mdns, send_list, send_count, i);
+  }
+  for (unsigned int i = 0; i < send_count; i++) {
+    entries[send_list[i]].used = false;
+  }
+  if (heap_count == 0) {
+    arena_used = 0;
+  }
+}
+
+void ResponseScheduler::Send(MDns* mdns, const byte* send_list, const unsigned int send_count,
+                             const unsigned int interface_index) {
+  bool started = false;
+  // Sections must be filled in order.
+  for (byte section = MDNS_SECTION_ANSWER; section <= MDNS_SECTION_ADDITIONAL; section++) {
+    for (unsigned int i = 0; i < send_count; i++) {
+      const ScheduledRecord& entry = entries[send_list[i]];
+      if (entry.section != section || entry.interface_index != interface_index) {
+        continue;
+      }
+      if (!started) {
+        started = true;
+        mdns->Clear();
+        mdns->SetInterface(interface_index);
+        mdns->SetResponse(true);
+        mdns->SetAutoFlush(true);
+      }
+      const char* name = (const char*)arena + entry.data_offset;
+      mdns->AddRecord(section, name, entry.rrtype, entry.rrclass, entry.rrset, entry.rrttl,
+                      arena + entry.data_offset + entry.name_len, entry.rdlength);
+    }
+  }
+  if (started) {
+    mdns->Send();
+    MDNS_STAT(mdns->stats().responses_sent += 1 + mdns->flushCount());
+  }
+}
+
+} // namespace mdns
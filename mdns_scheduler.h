@@ -0,0 +1,122 @@
+#ifndef MDNS_SCHEDULER_H
+#define MDNS_SCHEDULER_H
+
+#include <Arduino.h>
+#include "mdns.h"
+
+// Records falling due within this long of the earliest one go in the same
+// packet. (milliseconds)
+#define MDNS_SCHEDULER_WINDOW 20
+
+#if MDNS_SCHEDULER_MAX_RECORDS > 255
+#error "MDNS_SCHEDULER_MAX_RECORDS too large. Heap positions are stored in a byte."
+#endif
+
+#if MDNS_SCHEDULER_MAX_ASKERS > 8
+#error "MDNS_SCHEDULER_MAX_ASKERS too large. Known-Answers are tracked in an 8 bit mask."
+#endif
+
+namespace mdns {
+
+// One record waiting to be sent by a ResponseScheduler.
+typedef struct ScheduledRecord {
+  uint32_t due;             // millis() when the record must be sent by.
+  uint32_t askers[MDNS_SCHEDULER_MAX_ASKERS];  // IPv4 addresses of the hosts which asked for it.
+  uint32_t name_hash;       // nameHash() of the record's name.
+  uint32_t rrttl;
+  uint16_t rrtype;
+  uint16_t rrclass;         // ResourceRecord Class without the "flush cache" bit.
+  uint16_t data_offset;     // Position of the name and resource data in the arena.
+  uint16_t rdlength;
+  byte name_len;            // Length of the name. (Stored with terminating '\0'.)
+  byte section;             // MDNS_SECTION_ANSWER or MDNS_SECTION_ADDITIONAL.
+  byte interface_index;     // MDns interface to send it on.
+  byte heap_pos;            // Position in ResponseScheduler::heap.
+  byte asker_count;         // More than MDNS_SCHEDULER_MAX_ASKERS if they weren't all recorded.
+  byte askers_known;        // Bit set for each of askers which listed it as a Known-Answer.
+  bool rrset;
+  bool used;
+} ScheduledRecord;
+
+// Gathers the answers to several Queries into as few packets as possible.
+// Records are queued with a deadline, usually the random 20-120 ms RFC 6762 6
+// asks for. When the earliest deadline passes, it and everything else due
+// within MDNS_SCHEDULER_WINDOW goes out together. Records are kept in a min
+// heap ordered by deadline so finding the next one is constant time.
+//
+// The same record queued twice is only sent once, at the earlier deadline.
+// A queued record is dropped if another host multicasts it with at least its
+// TTL. (RFC 6762 7.4) A Known-Answer with at least half its TTL only stops the
+// answer to the host which listed it, so the record is dropped once every host
+// which asked for it has. (RFC 6762 7.1)
+//
+// For sketches answering Queries themselves from the MDns query callback.
+// Responder already gathers its own answers.
+//
+// Attach to an MDns with MDns::addListener().
+class ResponseScheduler : public Listener {
+ public:
+  ResponseScheduler();
+
+  // Queue a record to be multicast within delay milliseconds on the interface
+  // the current packet arrived on, in answer to the host which sent it.
+  // Args:
+  //   section : MDNS_SECTION_ANSWER or MDNS_SECTION_ADDITIONAL.
+  //   rdata : Resource data. The same rules apply as for MDns::AddRecord().
+  //           Names in it must not use Message Compression.
+  //   delay : eg: random(20, 120) when answering a shared record.
+  // Returns false if there is no space.
+  bool Schedule(const byte section, const char* name, const unsigned int rrtype,
+                const unsigned int rrclass, const bool rrset, const unsigned long int rrttl,
+                const byte* rdata, const unsigned int rdlength, const unsigned int delay);
+
+  // Drop everything queued.
+  void Clear();
+
+  // Number of records waiting to be sent.
+  unsigned int pending() const { return heap_count; }
+
+  // Listener interface.
+  void onPacket(MDns* mdns);
+  void onRecord(MDns* mdns, const RecordView* view);
+  void poll(MDns* mdns);
+
+ private:
+  // Find a queued record. Returns its index in entries or -1.
+  int Find(const uint32_t name_hash, const char* name, const unsigned int rrtype,
+           const unsigned int rrclass, const byte* rdata, const unsigned int rdlength,
+           const unsigned int interface_index) const;
+
+  // Min heap of indexes into entries ordered by due time.
+  void HeapSwap(const unsigned int a, const unsigned int b);
+  void SiftUp(unsigned int pos);
+  void SiftDown(unsigned int pos);
+  void Remove(const unsigned int index);
+
+  // Move the names and resource data of queued records to the start of the
+  // arena so the free space is all at the end.
+  void Compact();
+
+  // Note that the host which sent the current packet asked for the record at
+  // index.
+  void AddAsker(const unsigned int index);
+
+  // Send the records in send_list which are for interface_index.
+  void Send(MDns* mdns, const byte* send_list, const unsigned int send_count,
+            const unsigned int interface_index);
+
+  ScheduledRecord entries[MDNS_SCHEDULER_MAX_RECORDS];
+  byte heap[MDNS_SCHEDULER_MAX_RECORDS];
+  unsigned int heap_count;
+
+  byte arena[MDNS_SCHEDULER_ARENA_SIZE];
+  unsigned int arena_used;
+
+  // Interface the current packet arrived on and the host which sent it.
+  unsigned int current_interface;
+  uint32_t current_source;
+};
+
+} // namespace mdns
+
+#endif  // MDNS_SCHEDULER_H
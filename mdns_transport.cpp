@@ -0,0 +1,604 @@
+#include <Arduino.h>
+#include "mdns_transport.h"
+
+#ifndef ARDUINO
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+
+namespace mdns {
+
+#ifdef ESP8266
+bool WiFiUdpTransport::begin() {
+  if (!soft_ap && !got_ip_handler) {
+    // Event callbacks run in the SDK's context so only set a flag there.
+    got_ip_handler = WiFi.onStationModeGotIP([this](const WiFiEventStationModeGotIP&) {
+      restart_pending = true;
+    });
+  }
+  restart_pending = false;
+  joined_ip = localIP();
+  current_udp = &udp_;
+  if (separate_send && !send_udp_.begin(0)) {
+    return false;
+  }
+  return udp_.beginMulticast(joined_ip, MDNS_MULTICAST_ADDRESS, MDNS_TARGET_PORT);
+}
+
+void WiFiUdpTransport::CheckRestart() {
+  // Losing the address is left alone. Getting one back restarts.
+  const IPAddress local_ip = localIP();
+  if (restart_pending || ((uint32_t)local_ip != 0 && local_ip != joined_ip)) {
+    restart();
+  }
+}
+
+bool WiFiUdpTransport::OnInterface(const IPAddress& remote_ip) const {
+  const IPAddress ap_ip = WiFi.softAPIP();
+  const bool from_ap = (uint32_t)ap_ip != 0 && remote_ip[0] == ap_ip[0] &&
+                       remote_ip[1] == ap_ip[1] && remote_ip[2] == ap_ip[2];
+  return from_ap == soft_ap;
+}
+
+void WiFiUdpTransport::stop() {
+  udp_.stop();
+  send_udp_.stop();
+}
+
+int WiFiUdpTransport::parsePacket() {
+  CheckRestart();
+  current_udp = &udp_;
+  while (true) {
+    const int len = udp_.parsePacket();
+    if (len <= 0) {
+      break;
+    }
+    if (OnInterface(udp_.remoteIP())) {
+      return len;
+    }
+    // The other interface's transport handles this one. The next
+    // parsePacket() discards it.
+  }
+  if (!separate_send) {
+    return 0;
+  }
+  // Unicast replies to our Queries only arrive on the socket they were sent
+  // from so need no filtering.
+  current_udp = &send_udp_;
+  return send_udp_.parsePacket();
+}
+
+int WiFiUdpTransport::read(byte* buffer, size_t len) {
+  return current_udp->read(buffer, len);
+}
+
+IPAddress WiFiUdpTransport::remoteIP() {
+  return current_udp->remoteIP();
+}
+
+uint16_t WiFiUdpTransport::remotePort() {
+  return current_udp->remotePort();
+}
+
+IPAddress WiFiUdpTransport::localIP() {
+  return soft_ap ? WiFi.softAPIP() : WiFi.localIP();
+}
+
+bool WiFiUdpTransport::send(const byte* buffer, size_t len) {
+  CheckRestart();
+  WiFiUDP& udp = separate_send ? send_udp_ : udp_;
+  udp.beginPacketMulticast(MDNS_MULTICAST_ADDRESS, MDNS_TARGET_PORT, joined_ip, MDNS_TTL);
+  udp.write(buffer, len);
+  return udp.endPacket();
+}
+
+bool WiFiUdpTransport::sendTo(const byte* buffer, size_t len, IPAddress remote_ip,
+                              uint16_t remote_port) {
+  udp_.beginPacket(remote_ip, remote_port);
+  udp_.write(buffer, len);
+  return udp_.endPacket();
+}
+#endif  // ESP8266
+
+
+void LoopbackTransport::DiscardCurrent() {
+  if (current_len) {
+    memmove(buffer, buffer + current_len + 8, buffer_used - current_len - 8);
+    buffer_used -= current_len + 8;
+    current_len = 0;
+  }
+}
+
+bool LoopbackTransport::inject(const byte* packet, size_t len,
+                               IPAddress remote_ip, uint16_t remote_port) {
+  if (buffer_used + len + 8 > buffer_len) {
+    // Make space by dropping the packet returned by the last parsePacket().
+    // MDns has always read it by now.
+    DiscardCurrent();
+  }
+  if (len > 0xFFFF || buffer_used + len + 8 > buffer_len) {
+    return false;
+  }
+  byte* p_entry = buffer + buffer_used;
+  p_entry[0] = (len & 0xFF00) >> 8;
+  p_entry[1] = len & 0xFF;
+  p_entry[2] = remote_ip[0];
+  p_entry[3] = remote_ip[1];
+  p_entry[4] = remote_ip[2];
+  p_entry[5] = remote_ip[3];
+  p_entry[6] = (remote_port & 0xFF00) >> 8;
+  p_entry[7] = remote_port & 0xFF;
+  memcpy(p_entry + 8, packet, len);
+  buffer_used += len + 8;
+  return true;
+}
+
+int LoopbackTransport::parsePacket() {
+  DiscardCurrent();
+  if (buffer_used == 0) {
+    return 0;
+  }
+  current_len = (buffer[0] << 8) + buffer[1];
+  current_ip = IPAddress(buffer[2], buffer[3], buffer[4], buffer[5]);
+  current_port = (buffer[6] << 8) + buffer[7];
+  current_pos = 0;
+  return current_len;
+}
+
+int LoopbackTransport::read(byte* buffer_, size_t len) {
+  if (len > current_len - current_pos) {
+    len = current_len - current_pos;
+  }
+  memcpy(buffer_, buffer + 8 + current_pos, len);
+  current_pos += len;
+  return len;
+}
+
+bool LoopbackTransport::send(const byte* buffer_, size_t len) {
+  destination_ip = MDNS_MULTICAST_ADDRESS;
+  destination_port = MDNS_TARGET_PORT;
+  if (p_send_function_) {
+    p_send_function_(buffer_, len);
+  }
+  if (loopback) {
+    return inject(buffer_, len, localIP(), MDNS_SOURCE_PORT);
+  }
+  return true;
+}
+
+
+bool LoopbackTransport::sendTo(const byte* buffer_, size_t len, IPAddress remote_ip,
+                               uint16_t remote_port) {
+  destination_ip = remote_ip;
+  destination_port = remote_port;
+  if (p_send_function_) {
+    p_send_function_(buffer_, len);
+  }
+  return true;
+}
+
+
+bool PacketRing::push(const byte* packet, size_t len, IPAddress remote_ip, uint16_t remote_port) {
+  const unsigned int head_now = head.load(std::memory_order_relaxed);
+  if (head_now - tail.load(std::memory_order_acquire) >= slot_count) {
+    dropped_count.store(dropped_count.load(std::memory_order_relaxed) +1,
+                        std::memory_order_relaxed);
+    return false;
+  }
+  if (len > slot_size - MDNS_RING_SLOT_HEADER) {
+    len = slot_size - MDNS_RING_SLOT_HEADER;
+  }
+  memcpy(Slot(head_now) + MDNS_RING_SLOT_HEADER, packet, len);
+  Commit(len, remote_ip, remote_port);
+  return true;
+}
+
+unsigned int PacketRing::capture(const unsigned int max_packets) {
+  if (!transport) {
+    return 0;
+  }
+  unsigned int captured = 0;
+  while (captured < max_packets) {
+    const int len = transport->parsePacket();
+    if (len <= 0) {
+      break;
+    }
+    const unsigned int head_now = head.load(std::memory_order_relaxed);
+    if (head_now - tail.load(std::memory_order_acquire) >= slot_count) {
+      // Keep draining the socket. The next parsePacket() discards this one.
+      dropped_count.store(dropped_count.load(std::memory_order_relaxed) +1,
+                          std::memory_order_relaxed);
+      continue;
+    }
+    const int kept = transport->read(Slot(head_now) + MDNS_RING_SLOT_HEADER,
+                                     slot_size - MDNS_RING_SLOT_HEADER);
+    if (kept > 0) {
+      Commit(kept, transport->remoteIP(), transport->remotePort());
+      captured++;
+    }
+  }
+  return captured;
+}
+
+void PacketRing::Commit(const unsigned int len, IPAddress remote_ip, uint16_t remote_port) {
+  const unsigned int head_now = head.load(std::memory_order_relaxed);
+  byte* p_slot = Slot(head_now);
+  p_slot[0] = (len & 0xFF00) >> 8;
+  p_slot[1] = len & 0xFF;
+  p_slot[2] = remote_ip[0];
+  p_slot[3] = remote_ip[1];
+  p_slot[4] = remote_ip[2];
+  p_slot[5] = remote_ip[3];
+  p_slot[6] = (remote_port & 0xFF00) >> 8;
+  p_slot[7] = remote_port & 0xFF;
+  // The slot must be complete before the consumer can see it.
+  head.store(head_now +1, std::memory_order_release);
+}
+
+int PacketRing::parsePacket() {
+  unsigned int tail_now = tail.load(std::memory_order_relaxed);
+  if (have_current) {
+    // Hand the previous packet's slot back to the producer.
+    tail_now++;
+    tail.store(tail_now, std::memory_order_release);
+    have_current = false;
+  }
+  if (tail_now == head.load(std::memory_order_acquire)) {
+    return 0;
+  }
+  const byte* p_slot = Slot(tail_now);
+  current_len = (p_slot[0] << 8) + p_slot[1];
+  current_ip = IPAddress(p_slot[2], p_slot[3], p_slot[4], p_slot[5]);
+  current_port = (p_slot[6] << 8) + p_slot[7];
+  current_pos = 0;
+  have_current = true;
+  return current_len;
+}
+
+int PacketRing::read(byte* buffer, size_t len) {
+  if (!have_current) {
+    return 0;
+  }
+  if (len > current_len - current_pos) {
+    len = current_len - current_pos;
+  }
+  memcpy(buffer, Slot(tail.load(std::memory_order_relaxed)) + MDNS_RING_SLOT_HEADER + current_pos,
+         len);
+  current_pos += len;
+  return len;
+}
+
+
+#ifndef ARDUINO
+bool PosixUdpTransport::begin() {
+  stop();
+  if (ipv6_interface) {
+    return Begin6();
+  }
+  socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_fd < 0) {
+    return false;
+  }
+
+  // Other mDNS responders on this host will also have port 5353 open.
+  int enable = 1;
+  setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+#ifdef SO_REUSEPORT
+  setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+#endif
+
+  struct sockaddr_in bind_address;
+  memset(&bind_address, 0, sizeof(bind_address));
+  bind_address.sin_family = AF_INET;
+  bind_address.sin_addr.s_addr = htonl(INADDR_ANY);
+  bind_address.sin_port = htons(MDNS_SOURCE_PORT);
+  if (bind(socket_fd, (struct sockaddr*)&bind_address, sizeof(bind_address)) < 0) {
+    stop();
+    return false;
+  }
+
+  struct in_addr interface;
+  interface.s_addr = htonl(((uint32_t)interface_address[0] << 24) |
+                           ((uint32_t)interface_address[1] << 16) |
+                           ((uint32_t)interface_address[2] << 8) |
+                           interface_address[3]);
+
+  struct ip_mreq membership;
+  membership.imr_multiaddr.s_addr = inet_addr("224.0.0.251");
+  membership.imr_interface = interface;
+  if (setsockopt(socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+    stop();
+    return false;
+  }
+  setsockopt(socket_fd, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface));
+
+  unsigned char ttl = MDNS_TTL;
+  setsockopt(socket_fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+  // MDns::loop() polls so never block.
+  fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+bool PosixUdpTransport::Begin6() {
+  socket_fd = socket(AF_INET6, SOCK_DGRAM, 0);
+  if (socket_fd < 0) {
+    return false;
+  }
+
+  // Other mDNS responders on this host will also have port 5353 open.
+  int enable = 1;
+  setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+#ifdef SO_REUSEPORT
+  setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+#endif
+  // IPv4 packets arrive through a separate PosixUdpTransport.
+  setsockopt(socket_fd, IPPROTO_IPV6, IPV6_V6ONLY, &enable, sizeof(enable));
+
+  struct sockaddr_in6 bind_address;
+  memset(&bind_address, 0, sizeof(bind_address));
+  bind_address.sin6_family = AF_INET6;
+  bind_address.sin6_addr = in6addr_any;
+  bind_address.sin6_port = htons(MDNS_SOURCE_PORT);
+  if (bind(socket_fd, (struct sockaddr*)&bind_address, sizeof(bind_address)) < 0) {
+    stop();
+    return false;
+  }
+
+  struct ipv6_mreq membership;
+  inet_pton(AF_INET6, MDNS_MULTICAST_ADDRESS_V6, &membership.ipv6mr_multiaddr);
+  membership.ipv6mr_interface = ipv6_interface;
+  if (setsockopt(socket_fd, IPPROTO_IPV6, IPV6_JOIN_GROUP, &membership, sizeof(membership)) < 0) {
+    stop();
+    return false;
+  }
+  setsockopt(socket_fd, IPPROTO_IPV6, IPV6_MULTICAST_IF, &ipv6_interface, sizeof(ipv6_interface));
+
+  int hops = MDNS_TTL;
+  setsockopt(socket_fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &hops, sizeof(hops));
+
+  // MDns::loop() polls so never block.
+  fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+void PosixUdpTransport::stop() {
+  if (socket_fd >= 0) {
+    close(socket_fd);
+    socket_fd = -1;
+  }
+}
+
+int PosixUdpTransport::parsePacket() {
+  rx_len = 0;
+  rx_pos = 0;
+  if (socket_fd < 0) {
+    return 0;
+  }
+  struct sockaddr_storage from;
+  socklen_t from_len = sizeof(from);
+  const ssize_t len = recvfrom(socket_fd, rx_buffer, sizeof(rx_buffer), 0,
+                               (struct sockaddr*)&from, &from_len);
+  if (len <= 0) {
+    return 0;
+  }
+  if (from.ss_family == AF_INET6) {
+    const struct sockaddr_in6* from6 = (const struct sockaddr_in6*)&from;
+    const uint8_t* address = from6->sin6_addr.s6_addr;
+    if (IN6_IS_ADDR_V4MAPPED(&from6->sin6_addr)) {
+      rx_ip = IPAddress(address[12], address[13], address[14], address[15]);
+    } else {
+      rx_ip = IPAddress(0, 0, 0, 0);
+    }
+    rx_port = ntohs(from6->sin6_port);
+  } else {
+    const struct sockaddr_in* from4 = (const struct sockaddr_in*)&from;
+    const uint32_t from_address = ntohl(from4->sin_addr.s_addr);
+    rx_ip = IPAddress((from_address >> 24) & 0xFF, (from_address >> 16) & 0xFF,
+                      (from_address >> 8) & 0xFF, from_address & 0xFF);
+    rx_port = ntohs(from4->sin_port);
+  }
+  rx_len = len;
+  return rx_len;
+}
+
+int PosixUdpTransport::read(byte* buffer, size_t len) {
+  if (len > rx_len - rx_pos) {
+    len = rx_len - rx_pos;
+  }
+  memcpy(buffer, rx_buffer + rx_pos, len);
+  rx_pos += len;
+  return len;
+}
+
+bool PosixUdpTransport::send(const byte* buffer, size_t len) {
+  if (socket_fd < 0) {
+    return false;
+  }
+  if (ipv6_interface) {
+    struct sockaddr_in6 to6;
+    memset(&to6, 0, sizeof(to6));
+    to6.sin6_family = AF_INET6;
+    inet_pton(AF_INET6, MDNS_MULTICAST_ADDRESS_V6, &to6.sin6_addr);
+    to6.sin6_port = htons(MDNS_TARGET_PORT);
+    to6.sin6_scope_id = ipv6_interface;
+    return sendto(socket_fd, buffer, len, 0, (struct sockaddr*)&to6, sizeof(to6)) == (ssize_t)len;
+  }
+  struct sockaddr_in to;
+  memset(&to, 0, sizeof(to));
+  to.sin_family = AF_INET;
+  to.sin_addr.s_addr = inet_addr("224.0.0.251");
+  to.sin_port = htons(MDNS_TARGET_PORT);
+  return sendto(socket_fd, buffer, len, 0, (struct sockaddr*)&to, sizeof(to)) == (ssize_t)len;
+}
+
+bool PosixUdpTransport::sendTo(const byte* buffer, size_t len, IPAddress remote_ip,
+                               uint16_t remote_port) {
+  if (socket_fd < 0 || ipv6_interface) {
+    // remoteIP() does not hold full IPv6 addresses so there is nowhere to send.
+    return false;
+  }
+  struct sockaddr_in to;
+  memset(&to, 0, sizeof(to));
+  to.sin_family = AF_INET;
+  to.sin_addr.s_addr = htonl(((uint32_t)remote_ip[0] << 24) | ((uint32_t)remote_ip[1] << 16) |
+                             ((uint32_t)remote_ip[2] << 8) | remote_ip[3]);
+  to.sin_port = htons(remote_port);
+  return sendto(socket_fd, buffer, len, 0, (struct sockaddr*)&to, sizeof(to)) == (ssize_t)len;
+}
+
+
+// Link layer header types used by PcapTransport.
+#define PCAP_LINKTYPE_ETHERNET  1
+#define PCAP_LINKTYPE_RAW       101
+#define PCAP_LINKTYPE_LINUX_SLL 113
+#define PCAP_LINKTYPE_IPV4      228
+#define PCAP_LINKTYPE_IPV6      229
+
+bool PcapTransport::begin() {
+  stop();
+  file = fopen(filename, "rb");
+  if (!file) {
+    return false;
+  }
+  return rewind();
+}
+
+void PcapTransport::stop() {
+  if (file) {
+    fclose(file);
+    file = NULL;
+  }
+}
+
+bool PcapTransport::rewind() {
+  if (!file) {
+    return false;
+  }
+  fseek(file, 0, SEEK_SET);
+  byte header[24];
+  if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+    return false;
+  }
+  // Magic number for microsecond or nanosecond resolution captures in
+  // either byte order.
+  if (header[0] == 0xD4 && header[1] == 0xC3 && header[2] == 0xB2 && header[3] == 0xA1) {
+    swapped = false;
+  } else if (header[0] == 0x4D && header[1] == 0x3C && header[2] == 0xB2 && header[3] == 0xA1) {
+    swapped = false;
+  } else if (header[0] == 0xA1 && header[1] == 0xB2 && header[2] == 0xC3 && header[3] == 0xD4) {
+    swapped = true;
+  } else if (header[0] == 0xA1 && header[1] == 0xB2 && header[2] == 0x3C && header[3] == 0x4D) {
+    swapped = true;
+  } else {
+    return false;
+  }
+  link_type = ReadUint32(header + 20) & 0xFFFF;
+  return true;
+}
+
+uint32_t PcapTransport::ReadUint32(const byte* p) const {
+  // The file header says which byte order the capture was written in.
+  if (swapped) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+  }
+  return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+int PcapTransport::parsePacket() {
+  rx_len = 0;
+  rx_pos = 0;
+  if (!file) {
+    return 0;
+  }
+
+  // Skip captured frames until one contains an mDNS packet.
+  while (true) {
+    byte record_header[16];
+    if (fread(record_header, 1, sizeof(record_header), file) != sizeof(record_header)) {
+      return 0;
+    }
+    const uint32_t captured_len = ReadUint32(record_header + 8);
+    if (captured_len > sizeof(rx_buffer)) {
+      fseek(file, captured_len, SEEK_CUR);
+      continue;
+    }
+    if (fread(rx_buffer, 1, captured_len, file) != captured_len) {
+      return 0;
+    }
+
+    // Link layer.
+    size_t pos = 0;
+    unsigned int ether_type = 0;
+    switch (link_type) {
+      case PCAP_LINKTYPE_ETHERNET:
+        if (captured_len < 14) { continue; }
+        ether_type = (rx_buffer[12] << 8) + rx_buffer[13];
+        pos = 14;
+        if (ether_type == 0x8100 && captured_len >= 18) {
+          // 802.1Q VLAN tag.
+          ether_type = (rx_buffer[16] << 8) + rx_buffer[17];
+          pos = 18;
+        }
+        break;
+      case PCAP_LINKTYPE_LINUX_SLL:
+        if (captured_len < 16) { continue; }
+        ether_type = (rx_buffer[14] << 8) + rx_buffer[15];
+        pos = 16;
+        break;
+      case PCAP_LINKTYPE_RAW:
+      case PCAP_LINKTYPE_IPV4:
+      case PCAP_LINKTYPE_IPV6:
+        if (captured_len < 1) { continue; }
+        ether_type = ((rx_buffer[0] >> 4) == 6) ? 0x86DD : 0x0800;
+        break;
+      default:
+        return 0;
+    }
+
+    // Network layer.
+    if (ether_type == 0x0800) {
+      if (pos + 20 > captured_len || rx_buffer[pos + 9] != 17) { continue; }  // Not UDP.
+      rx_ip = IPAddress(rx_buffer[pos + 12], rx_buffer[pos + 13],
+                        rx_buffer[pos + 14], rx_buffer[pos + 15]);
+      pos += (rx_buffer[pos] & 0x0F) * 4;
+    } else if (ether_type == 0x86DD) {
+      if (pos + 40 > captured_len || rx_buffer[pos + 6] != 17) { continue; }  // Not UDP.
+      rx_ip = IPAddress();
+      pos += 40;
+    } else {
+      continue;
+    }
+
+    // Transport layer.
+    if (pos + 8 > captured_len) { continue; }
+    const unsigned int source_port = (rx_buffer[pos] << 8) + rx_buffer[pos + 1];
+    const unsigned int destination_port = (rx_buffer[pos + 2] << 8) + rx_buffer[pos + 3];
+    if (source_port != MDNS_SOURCE_PORT && destination_port != MDNS_TARGET_PORT) {
+      continue;
+    }
+    rx_port = source_port;
+    rx_offset = pos + 8;
+    rx_len = captured_len - rx_offset;
+    if (rx_len == 0) {
+      continue;
+    }
+    return rx_len;
+  }
+}
+
+int PcapTransport::read(byte* buffer, size_t len) {
+  if (len > rx_len - rx_pos) {
+    len = rx_len - rx_pos;
+  }
+  memcpy(buffer, rx_buffer + rx_offset + rx_pos, len);
+  rx_pos += len;
+  return len;
+}
+#endif  // ARDUINO
+
+} // namespace mdns
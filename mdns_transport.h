@@ -0,0 +1,421 @@
+#ifndef MDNS_TRANSPORT_H
+#define MDNS_TRANSPORT_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "mdns.h"
+
+#ifdef ESP8266
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#endif
+
+#ifndef ARDUINO
+#include <stdio.h>
+#endif
+
+// The mDNS multicast group.
+#define MDNS_MULTICAST_ADDRESS IPAddress(224, 0, 0, 251)
+
+// The IPv6 mDNS multicast group. (RFC 6762 3)
+#define MDNS_MULTICAST_ADDRESS_V6 "ff02::fb"
+
+// Largest datagram the host (non Arduino) transports will receive.
+#define MDNS_HOST_MAX_DATAGRAM 9000
+
+// Bytes at the start of each PacketRing slot used for the packet's length,
+// source address and source port.
+#define MDNS_RING_SLOT_HEADER 8
+
+namespace mdns {
+
+// Interface between MDns and the network.
+// MDns only sends and receives packets through one of these so the parser and
+// packet builder can be run against something other than the ESP8266 WiFi
+// stack. eg: Fed with packets from memory or a capture file.
+class Transport {
+ public:
+  virtual ~Transport() {}
+
+  // Open the socket and join the mDNS multicast group.
+  virtual bool begin() = 0;
+
+  // Close the socket.
+  virtual void stop() = 0;
+
+  // Close and reopen the socket. Call when the network interface comes back
+  // up or changes address, as multicast group membership does not survive
+  // that. Sockets otherwise stay open for the life of the Transport.
+  virtual bool restart() {
+    stop();
+    return begin();
+  }
+
+  // Check for an incoming packet.
+  // Returns the size of the packet or 0 if nothing is waiting.
+  virtual int parsePacket() = 0;
+
+  // Copy up to len bytes of the packet found by parsePacket() into buffer.
+  // Returns the number of bytes copied.
+  virtual int read(byte* buffer, size_t len) = 0;
+
+  // Address and port the packet found by parsePacket() was sent from.
+  virtual IPAddress remoteIP() = 0;
+  virtual uint16_t remotePort() = 0;
+
+  // Address our own packets are sent from.
+  virtual IPAddress localIP() = 0;
+
+  // Send a packet to the mDNS multicast group.
+  virtual bool send(const byte* buffer, size_t len) = 0;
+
+  // Send a packet to one host. Transports which can't return false.
+  virtual bool sendTo(const byte* buffer, size_t len, IPAddress remote_ip, uint16_t remote_port) {
+    return false;
+  }
+
+  // True if packets arrive over IPv6. remoteIP() then can't tell most senders
+  // apart, so MDns doesn't merge their packets and a Responder answers them by
+  // multicast.
+  virtual bool isIPv6() { return false; }
+};
+
+#ifdef ESP8266
+// Transport using one of the ESP8266 WiFi interfaces.
+// In STA+AP mode use one for each interface. Pass the first to the MDns
+// constructor and the other to MDns::addInterface(). Both sockets see every
+// packet so each only keeps those whose source address is on its side: the
+// SoftAP's /24 subnet for the SoftAP, anything else for the station.
+//
+// The socket is opened once by begin(). It is reopened by restart() when the
+// station gets an IP address (WiFi reconnects included) or the interface's
+// address changes, so the multicast group is joined on the right interface.
+class WiFiUdpTransport : public Transport {
+ public:
+  // Args:
+  //   soft_ap_ : Use the SoftAP interface rather than the station interface.
+  //   separate_send_ : Send multicast packets from a second socket on a
+  //                    random port rather than from port 5353. Other hosts
+  //                    then treat our Queries as one-shot Queries and answer
+  //                    by unicast to that socket, which is read alongside the
+  //                    multicast one. (RFC 6762 5.1) Responses must come from
+  //                    port 5353 so don't use with a Responder.
+  WiFiUdpTransport(const bool soft_ap_ = false, const bool separate_send_ = false) :
+    current_udp(&udp_),
+    soft_ap(soft_ap_),
+    separate_send(separate_send_),
+    restart_pending(false)
+    { }
+
+  bool begin();
+  void stop();
+  int parsePacket();
+  int read(byte* buffer, size_t len);
+  IPAddress remoteIP();
+  uint16_t remotePort();
+  IPAddress localIP();
+  bool send(const byte* buffer, size_t len);
+  bool sendTo(const byte* buffer, size_t len, IPAddress remote_ip, uint16_t remote_port);
+
+ private:
+  // True if a packet from remote_ip belongs to this interface.
+  bool OnInterface(const IPAddress& remote_ip) const;
+
+  // restart() if an interface event asked for it or the address changed.
+  void CheckRestart();
+
+  // A UDP instance to let us send and receive packets over UDP.
+  WiFiUDP udp_;
+
+  // Sends multicast packets and receives the replies if separate_send.
+  WiFiUDP send_udp_;
+
+  // The socket the packet found by parsePacket() arrived on.
+  WiFiUDP* current_udp;
+
+  bool soft_ap;
+  bool separate_send;
+
+  // Address the multicast group was joined on.
+  IPAddress joined_ip;
+
+  // Set from the WiFi event callback. Acted on from loop().
+  volatile bool restart_pending;
+  WiFiEventHandler got_ip_handler;
+};
+#endif  // ESP8266
+
+// Transport which keeps packets in memory rather than using the network.
+// Packets passed to inject() are handed to MDns in the order they arrived.
+// Useful for testing and benchmarking the parser without radio hardware.
+class LoopbackTransport : public Transport {
+ public:
+  // Args:
+  //   buffer_ : Storage for packets that have been injected but not yet read.
+  //   buffer_len_ : Size of buffer_.
+  LoopbackTransport(byte* buffer_, size_t buffer_len_) :
+    buffer(buffer_),
+    buffer_len(buffer_len_),
+    buffer_used(0),
+    current_len(0),
+    current_pos(0),
+    local_ip(127, 0, 0, 1),
+    destination_port(0),
+    loopback(false)
+    { }
+
+  // Queue a packet to be received.
+  // Returns false if there is not enough space left in buffer.
+  bool inject(const byte* packet, size_t len,
+              IPAddress remote_ip = IPAddress(127, 0, 0, 1),
+              uint16_t remote_port = MDNS_SOURCE_PORT);
+
+  // Register a callback which fires for every packet sent.
+  void onSend(std::function<void(const byte*, size_t)> p_send_function) {
+    p_send_function_ = p_send_function;
+  }
+
+  // If set, packets sent are also queued to be received, the same as a host
+  // that has multicast loopback enabled.
+  void setLoopback(bool loopback_) { loopback = loopback_; }
+
+  // Address returned by localIP(). Default 127.0.0.1.
+  void setLocalIP(IPAddress local_ip_) { local_ip = local_ip_; }
+
+  bool begin() { return true; }
+  void stop() {}
+  int parsePacket();
+  int read(byte* buffer, size_t len);
+  IPAddress remoteIP() { return current_ip; }
+  uint16_t remotePort() { return current_port; }
+  IPAddress localIP() { return local_ip; }
+  bool send(const byte* buffer, size_t len);
+
+  // Unicast packets go to the onSend() callback with the destination in
+  // lastDestination(). They are not looped back.
+  bool sendTo(const byte* buffer, size_t len, IPAddress remote_ip, uint16_t remote_port);
+
+  // Destination of the last packet sent. The multicast group for send().
+  IPAddress lastDestinationIP() const { return destination_ip; }
+  uint16_t lastDestinationPort() const { return destination_port; }
+
+ private:
+  // Remove the packet returned by the last parsePacket() from buffer.
+  void DiscardCurrent();
+
+  // Queued packets. Each is stored as:
+  //   2 byte length, 4 byte source address, 2 byte source port, data.
+  byte* buffer;
+  size_t buffer_len;
+  size_t buffer_used;
+
+  // The packet most recently returned by parsePacket().
+  // It's kept at the start of buffer until the next call to parsePacket() or
+  // until inject() needs the space.
+  size_t current_len;
+  size_t current_pos;
+  IPAddress current_ip;
+  uint16_t current_port;
+
+  IPAddress local_ip;
+  IPAddress destination_ip;
+  uint16_t destination_port;
+  bool loopback;
+  std::function<void(const byte*, size_t)> p_send_function_;
+};
+
+// Fixed size queue of received packets which decouples receiving them from
+// parsing them. A slow callback then can't stop packets being read from the
+// network, where they would otherwise be dropped once the UDP stack's queue
+// fills.
+// The network side adds packets with capture(), which drains another
+// Transport, or with push(), eg: from an asynchronous UDP callback. MDns uses
+// the PacketRing as its Transport and parses the queued packets from loop().
+// Sending goes straight to the other Transport.
+//
+// There must be a single producer (capture() or push()) and a single consumer
+// (the MDns). They may run in different threads or in interrupt and main loop
+// context. The two sides only share the head and tail indexes, which are
+// atomics, so no locking is needed.
+class PacketRing : public Transport {
+ public:
+  // Args:
+  //   transport_ : Used by capture() and for sending. May be NULL if packets
+  //                only arrive by push().
+  //   storage_ : slot_count_ * slot_size_ bytes.
+  //   slot_count_ : Most packets queued at once.
+  //   slot_size_ : Longest packet kept plus MDNS_RING_SLOT_HEADER. Longer
+  //                packets are truncated.
+  PacketRing(Transport* transport_, byte* storage_, unsigned int slot_count_,
+             unsigned int slot_size_) :
+    transport(transport_),
+    storage(storage_),
+    slot_count(slot_count_),
+    slot_size(slot_size_),
+    head(0),
+    tail(0),
+    dropped_count(0),
+    current_len(0),
+    current_pos(0),
+    current_port(0),
+    have_current(false)
+    { }
+
+  // Producer side. Queue a packet.
+  // Returns false, and counts the packet as dropped, if the ring is full.
+  bool push(const byte* packet, size_t len, IPAddress remote_ip, uint16_t remote_port);
+
+  // Producer side. Move up to max_packets waiting packets from transport_
+  // into the ring. Packets which arrive while the ring is full are dropped.
+  // Returns the number of packets queued.
+  unsigned int capture(const unsigned int max_packets = 0xFFFF);
+
+  // Packets queued and not yet parsed.
+  unsigned int pending() const { return head.load() - tail.load(); }
+
+  // Packets dropped because the ring was full.
+  unsigned int dropped() const { return dropped_count.load(); }
+
+  // Transport interface. Consumer side.
+  bool begin() { return transport ? transport->begin() : true; }
+  void stop() { if (transport) { transport->stop(); } }
+  int parsePacket();
+  int read(byte* buffer, size_t len);
+  IPAddress remoteIP() { return current_ip; }
+  uint16_t remotePort() { return current_port; }
+  IPAddress localIP() { return transport ? transport->localIP() : IPAddress(); }
+  bool send(const byte* buffer, size_t len) { return transport ? transport->send(buffer, len) : false; }
+  bool sendTo(const byte* buffer, size_t len, IPAddress remote_ip, uint16_t remote_port) {
+    return transport ? transport->sendTo(buffer, len, remote_ip, remote_port) : false;
+  }
+  bool isIPv6() { return transport ? transport->isIPv6() : false; }
+
+ private:
+  byte* Slot(const unsigned int index) const { return storage + (index % slot_count) * slot_size; }
+
+  // Publish the slot at head after its contents have been written.
+  void Commit(const unsigned int len, IPAddress remote_ip, uint16_t remote_port);
+
+  Transport* transport;
+  byte* storage;
+  unsigned int slot_count;
+  unsigned int slot_size;
+
+  // Count of packets ever added (head) and ever parsed (tail). The producer
+  // only writes head and dropped_count. The consumer only writes tail.
+  // Neither needs an atomic read-modify-write, which the ESP8266 lacks.
+  std::atomic<unsigned int> head;
+  std::atomic<unsigned int> tail;
+  std::atomic<unsigned int> dropped_count;
+
+  // The packet most recently returned by parsePacket(). Its slot is released
+  // by the next call to parsePacket().
+  size_t current_len;
+  size_t current_pos;
+  IPAddress current_ip;
+  uint16_t current_port;
+  bool have_current;
+};
+
+#ifndef ARDUINO
+// Transport using a POSIX UDP socket joined to the mDNS multicast group.
+// Only available on host (non Arduino) builds.
+class PosixUdpTransport : public Transport {
+ public:
+  // Args:
+  //   interface_address_ : Address of the interface to join the multicast group
+  //                        on. Leave unset to let the OS pick one.
+  //   ipv6_interface_ : If not 0, use IPv6 and the ff02::fb group on the
+  //                     interface with this index. (See if_nametoindex().)
+  //                     interface_address_ is then only returned by localIP().
+  //                     remoteIP() is 0.0.0.0 for senders without an IPv4
+  //                     mapped address.
+  PosixUdpTransport(IPAddress interface_address_ = IPAddress(),
+                    const unsigned int ipv6_interface_ = 0) :
+    interface_address(interface_address_),
+    ipv6_interface(ipv6_interface_),
+    socket_fd(-1),
+    rx_len(0),
+    rx_pos(0),
+    rx_port(0)
+    { }
+  ~PosixUdpTransport() { stop(); }
+
+  bool begin();
+  void stop();
+  int parsePacket();
+  int read(byte* buffer, size_t len);
+  IPAddress remoteIP() { return rx_ip; }
+  uint16_t remotePort() { return rx_port; }
+  IPAddress localIP() { return interface_address; }
+  bool send(const byte* buffer, size_t len);
+  bool sendTo(const byte* buffer, size_t len, IPAddress remote_ip, uint16_t remote_port);
+  bool isIPv6() { return ipv6_interface != 0; }
+
+ private:
+  // begin() for IPv6.
+  bool Begin6();
+
+  IPAddress interface_address;
+  unsigned int ipv6_interface;
+  int socket_fd;
+
+  byte rx_buffer[MDNS_HOST_MAX_DATAGRAM];
+  size_t rx_len;
+  size_t rx_pos;
+  IPAddress rx_ip;
+  uint16_t rx_port;
+};
+
+// Transport which replays the mDNS (UDP port 5353) packets in a pcap capture
+// file. Packets sent are discarded.
+// Only available on host (non Arduino) builds.
+class PcapTransport : public Transport {
+ public:
+  // Args:
+  //   filename_ : Capture file in the classic libpcap format with Ethernet,
+  //               raw IP or Linux cooked link layer headers.
+  PcapTransport(const char* filename_) :
+    filename(filename_),
+    file(NULL),
+    link_type(0),
+    swapped(false),
+    rx_len(0),
+    rx_pos(0),
+    rx_offset(0),
+    rx_port(0)
+    { }
+  ~PcapTransport() { stop(); }
+
+  bool begin();
+  void stop();
+  int parsePacket();
+  int read(byte* buffer, size_t len);
+  IPAddress remoteIP() { return rx_ip; }
+  uint16_t remotePort() { return rx_port; }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+  bool send(const byte* buffer, size_t len) { return true; }
+
+  // Start replaying from the first packet in the file again.
+  bool rewind();
+
+ private:
+  uint32_t ReadUint32(const byte* p) const;
+
+  const char* filename;
+  FILE* file;
+  uint32_t link_type;
+  bool swapped;
+
+  byte rx_buffer[MDNS_HOST_MAX_DATAGRAM + 128];
+  size_t rx_len;
+  size_t rx_pos;
+  size_t rx_offset;
+  IPAddress rx_ip;
+  uint16_t rx_port;
+};
+#endif  // ARDUINO
+
+} // namespace mdns
+
+#endif  // MDNS_TRANSPORT_H
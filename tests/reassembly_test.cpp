@@ -0,0 +1,169 @@
+// Tests for holding truncated Queries until their Known-Answers arrive.
+// See MDns::setReassemblyBuffer().
+
+#include <Arduino.h>
+#include <mdns.h>
+#include <mdns_transport.h>
+
+#include <stdio.h>
+
+#define CHECK(condition) \
+  if (!(condition)) { \
+    fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+    return false; \
+  }
+
+// Query for "_ipp.local" PTR with the TC bit set. 28 bytes.
+static const byte truncated_query[] = {
+  0x00, 0x00, 0x02, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x04, '_', 'i', 'p', 'p', 0x05, 'l', 'o', 'c', 'a', 'l', 0x00,
+  0x00, 0x0C, 0x00, 0x01
+};
+
+// The rest of its Known-Answers: 3 "_ipp.local" PTR records. 90 bytes.
+static const byte continuation[] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00,
+  0x04, '_', 'i', 'p', 'p', 0x05, 'l', 'o', 'c', 'a', 'l', 0x00,
+  0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x04, 0x01, 'a', 0xC0, 0x0C,
+  0x04, '_', 'i', 'p', 'p', 0x05, 'l', 'o', 'c', 'a', 'l', 0x00,
+  0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x04, 0x01, 'b', 0xC0, 0x0C,
+  0x04, '_', 'i', 'p', 'p', 0x05, 'l', 'o', 'c', 'a', 'l', 0x00,
+  0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x04, 0x01, 'c', 0xC0, 0x0C
+};
+
+// A Known-Answer for "_http.local" PTR continuing truncated_query. Its first
+// name is at the same offset as truncated_query's.
+static const byte other_continuation[] = {
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+  0x05, '_', 'h', 't', 't', 'p', 0x05, 'l', 'o', 'c', 'a', 'l', 0x00,
+  0x00, 0x0C, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x04, 0x01, 'a', 0xC0, 0x0C
+};
+
+// Every record reaches the callbacks whether or not the continuation fits in
+// the reassembly buffer.
+static bool TestContinuation(const unsigned int reassembly_size) {
+  static_assert(sizeof(truncated_query) == 28, "truncated_query");
+  static_assert(sizeof(continuation) == 90, "continuation");
+
+  byte transport_buffer[1024];
+  mdns::LoopbackTransport transport(transport_buffer, sizeof(transport_buffer));
+  unsigned int query_count = 0;
+  unsigned int answer_count = 0;
+  byte packet_buffer[MAX_PACKET_SIZE];
+  mdns::MDns mdns(&transport, NULL,
+                  [&](const mdns::Query* query) { query_count += query->valid; },
+                  [&](const mdns::Answer* answer) { answer_count += answer->valid; },
+                  packet_buffer, sizeof(packet_buffer));
+  byte reassembly_buffer[600];
+  mdns.setReassemblyBuffer(reassembly_buffer, reassembly_size);
+
+  const IPAddress source(10, 0, 0, 9);
+  CHECK(transport.inject(truncated_query, sizeof(truncated_query), source));
+  CHECK(mdns.loop());
+  CHECK(transport.inject(continuation, sizeof(continuation), source));
+  CHECK(mdns.loop());
+  CHECK(query_count == 1);
+  CHECK(answer_count == 3);
+  return true;
+}
+
+// Listener which checks that one name id never stands for two names within
+// a Query, as Responder relies on.
+class NameIdListener : public mdns::Listener {
+ public:
+  NameIdListener() : record_count(0), consistent(true) { }
+
+  void onPacket(mdns::MDns* mdns) {
+    for (unsigned int i = 0; i < MDNS_NAME_TABLE_SIZE; i++) {
+      hashes[i] = 0;
+    }
+  }
+
+  void onRecord(mdns::MDns* mdns, const mdns::RecordView* view) {
+    record_count++;
+    const unsigned int name_id = view->nameId();
+    if (name_id == MDNS_NAME_ID_NONE) {
+      return;
+    }
+    if (name_id >= MDNS_NAME_TABLE_SIZE) {
+      consistent = false;
+      return;
+    }
+    if (hashes[name_id] != 0 && hashes[name_id] != view->nameHash()) {
+      consistent = false;
+    }
+    hashes[name_id] = view->nameHash();
+  }
+
+  unsigned int record_count;
+  bool consistent;
+
+ private:
+  uint32_t hashes[MDNS_NAME_TABLE_SIZE];
+};
+
+// Names in different held packets don't share an id.
+static bool TestHeldNameIds() {
+  byte transport_buffer[1024];
+  mdns::LoopbackTransport transport(transport_buffer, sizeof(transport_buffer));
+  byte packet_buffer[MAX_PACKET_SIZE];
+  mdns::MDns mdns(&transport, NULL, NULL, NULL, packet_buffer, sizeof(packet_buffer));
+  byte reassembly_buffer[600];
+  mdns.setReassemblyBuffer(reassembly_buffer, sizeof(reassembly_buffer));
+  NameIdListener listener;
+  mdns.addListener(&listener);
+
+  const IPAddress source(10, 0, 0, 9);
+  CHECK(transport.inject(truncated_query, sizeof(truncated_query), source));
+  CHECK(mdns.loop());
+  CHECK(transport.inject(other_continuation, sizeof(other_continuation), source));
+  CHECK(mdns.loop());
+  CHECK(listener.record_count == 2);
+  CHECK(listener.consistent);
+  return true;
+}
+
+// Transport which reports packets arriving over IPv6, like a
+// PosixUdpTransport with an ipv6_interface.
+class IPv6LoopbackTransport : public mdns::LoopbackTransport {
+ public:
+  IPv6LoopbackTransport(byte* buffer_, size_t buffer_len_) :
+    mdns::LoopbackTransport(buffer_, buffer_len_) { }
+  bool isIPv6() { return true; }
+};
+
+// Senders on an IPv6 interface can't be told apart so nothing is held.
+static bool TestIPv6NotHeld() {
+  byte transport_buffer[1024];
+  IPv6LoopbackTransport transport(transport_buffer, sizeof(transport_buffer));
+  unsigned int query_count = 0;
+  unsigned int answer_count = 0;
+  byte packet_buffer[MAX_PACKET_SIZE];
+  mdns::MDns mdns(&transport, NULL,
+                  [&](const mdns::Query* query) { query_count += query->valid; },
+                  [&](const mdns::Answer* answer) { answer_count += answer->valid; },
+                  packet_buffer, sizeof(packet_buffer));
+  byte reassembly_buffer[600];
+  mdns.setReassemblyBuffer(reassembly_buffer, sizeof(reassembly_buffer));
+
+  const IPAddress source(0, 0, 0, 0);
+  CHECK(transport.inject(truncated_query, sizeof(truncated_query), source));
+  CHECK(mdns.loop());
+  CHECK(query_count == 1);
+  CHECK(transport.inject(continuation, sizeof(continuation), source));
+  CHECK(mdns.loop());
+  CHECK(answer_count == 3);
+  return true;
+}
+
+int main() {
+  bool success = true;
+  // Room to hold both packets.
+  success = TestContinuation(600) && success;
+  // The continuation doesn't fit so the held Query is released first.
+  success = TestContinuation(60) && success;
+  success = TestHeldNameIds() && success;
+  success = TestIPv6NotHeld() && success;
+  printf(success ? "PASS\n" : "FAIL\n");
+  return success ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// Tests for dropping ResponseScheduler answers other hosts already have.
+// (RFC 6762 7.1 and 7.4)
+
+#include <Arduino.h>
+#include <mdns.h>
+#include <mdns_scheduler.h>
+#include <mdns_transport.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define CHECK(condition) \
+  if (!(condition)) { \
+    fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+    return false; \
+  }
+
+#define ANSWER_TTL 120
+
+static const byte dev_name[] = {0x03, 'd', 'e', 'v', 0x05, 'l', 'o', 'c', 'a', 'l', 0x00};
+static const byte dev_address[] = {10, 0, 0, 5};
+
+// Build a packet with a Question for "dev.local" A if question is set and
+// the "dev.local" A record with TTL ttl in the Answer section unless ttl is 0.
+// Returns its length.
+static unsigned int BuildPacket(byte* buffer, const bool response, const bool question,
+                                const uint32_t ttl) {
+  memset(buffer, 0, 12);
+  buffer[2] = response ? 0x84 : 0x00;
+  buffer[5] = question;
+  buffer[7] = (ttl > 0);
+  unsigned int len = 12;
+  if (question) {
+    memcpy(buffer + len, dev_name, sizeof(dev_name));
+    len += sizeof(dev_name);
+    const byte question_fields[] = {0x00, MDNS_TYPE_A, 0x00, 0x01};
+    memcpy(buffer + len, question_fields, sizeof(question_fields));
+    len += sizeof(question_fields);
+  }
+  if (ttl > 0) {
+    memcpy(buffer + len, dev_name, sizeof(dev_name));
+    len += sizeof(dev_name);
+    const byte answer_fields[] = {0x00, MDNS_TYPE_A, 0x00, 0x01,
+                                  (byte)(ttl >> 24), (byte)(ttl >> 16), (byte)(ttl >> 8), (byte)ttl,
+                                  0x00, sizeof(dev_address)};
+    memcpy(buffer + len, answer_fields, sizeof(answer_fields));
+    len += sizeof(answer_fields);
+    memcpy(buffer + len, dev_address, sizeof(dev_address));
+    len += sizeof(dev_address);
+  }
+  return len;
+}
+
+class SchedulerTest {
+ public:
+  SchedulerTest() :
+    transport(transport_buffer, sizeof(transport_buffer)),
+    mdns(&transport, NULL,
+         [this](const mdns::Query* query) {
+           if (query->valid) {
+             scheduler.Schedule(MDNS_SECTION_ANSWER, "dev.local", MDNS_TYPE_A, 1, true,
+                                ANSWER_TTL, dev_address, sizeof(dev_address), 1000);
+           }
+         },
+         NULL, packet_buffer, sizeof(packet_buffer)) {
+    transport.setLocalIP(IPAddress(10, 0, 0, 5));
+    mdns.addListener(&scheduler);
+  }
+
+  // Deliver a packet built by BuildPacket() from source. Returns the number
+  // of records still queued.
+  unsigned int Receive(const IPAddress& source, const bool response, const bool question,
+                       const uint32_t ttl) {
+    byte packet[64];
+    transport.inject(packet, BuildPacket(packet, response, question, ttl), source);
+    mdns.loop();
+    return scheduler.pending();
+  }
+
+ private:
+  byte transport_buffer[1024];
+  byte packet_buffer[MAX_PACKET_SIZE];
+  mdns::LoopbackTransport transport;
+  mdns::ResponseScheduler scheduler;
+  mdns::MDns mdns;
+};
+
+static const IPAddress host_a(10, 0, 0, 2);
+static const IPAddress host_b(10, 0, 0, 3);
+
+// A Known-Answer only stops the answer to the host which listed it.
+static bool TestKnownAnswer() {
+  SchedulerTest test;
+  CHECK(test.Receive(host_a, false, true, 0) == 1);
+  CHECK(test.Receive(host_b, false, false, ANSWER_TTL) == 1);
+  CHECK(test.Receive(host_a, false, false, ANSWER_TTL) == 0);
+
+  // Two hosts ask. It's dropped once both list it.
+  CHECK(test.Receive(host_a, false, true, 0) == 1);
+  CHECK(test.Receive(host_b, false, true, 0) == 1);
+  CHECK(test.Receive(host_a, false, false, ANSWER_TTL) == 1);
+  CHECK(test.Receive(host_b, false, false, ANSWER_TTL / 2) == 0);
+
+  // Known-Answers with less than half the TTL don't count.
+  CHECK(test.Receive(host_a, false, true, ANSWER_TTL / 2 -1) == 1);
+  return true;
+}
+
+// Another host's answer stops ours if its TTL is at least ours.
+static bool TestDuplicateAnswer() {
+  SchedulerTest test;
+  CHECK(test.Receive(host_a, false, true, 0) == 1);
+  CHECK(test.Receive(host_b, true, false, ANSWER_TTL / 2) == 1);
+  CHECK(test.Receive(host_b, true, false, ANSWER_TTL) == 0);
+  return true;
+}
+
+int main() {
+  bool success = true;
+  success = TestKnownAnswer() && success;
+  success = TestDuplicateAnswer() && success;
+  printf(success ? "PASS\n" : "FAIL\n");
+  return success ? 0 : 1;
+}